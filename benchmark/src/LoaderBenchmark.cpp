@@ -0,0 +1,850 @@
+#include "LoaderBenchmark.h"
+#include "FolderScanner.h"
+#include "FrameCache.h"
+#include "FrameList.h"
+#include "FramePrefetcher.h"
+#include "FrameStats.h"
+#include "PixelConvert.h"
+#include "Resampler.h"
+#include "TextureUploader.h"
+#include "ColorAdjust.h"
+#include <fcntl.h>
+#include <random>
+#include <unistd.h>
+
+namespace {
+    struct KnownResolution {
+        const char* name;
+        int width;
+        int height;
+    };
+    const KnownResolution KNOWN_RESOLUTIONS[] = {
+        {"720p", 1280, 720},
+        {"1080p", 1920, 1080},
+        {"4k", 3840, 2160},
+        {"8k", 7680, 4320},
+    };
+
+    // Most a resampled sample may be off the double precision reference
+    const int MAX_RESAMPLE_ERROR = 1;
+
+    double percentile(vector<double> values, double fraction) {
+        if (values.empty()) {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        size_t rank = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+        return values[rank];
+    }
+
+    vector<string> splitList(const string& list) {
+        return ofSplitString(ofToLower(list), ",", true, true);
+    }
+}
+
+//--------------------------------------------------------------
+void LoaderBenchmark::printUsage(){
+    std::cerr << "usage: benchmark [options]\n"
+              << "  --formats jpg,png,tif         image formats to test\n"
+              << "  --resolutions 720p,1080p,4k   any of 720p, 1080p, 4k, 8k or all\n"
+              << "  --patterns sequential,reverse,pingpong,random,scrub\n"
+              << "  --threads 1,2,4,0             decode threads for the playback patterns, 0 = one per core (default)\n"
+              << "  --scrub-width 320             decode width for the scrub pattern (JPEGs only, needs libjpeg-turbo)\n"
+              << "  --frames 48                   frames per generated sequence\n"
+              << "  --plays 3                     passes through the sequence per playback pattern\n"
+              << "  --dir data/benchmark          where sequences are generated\n"
+              << "  --regenerate                  rewrite sequences even if they exist\n"
+              << "  --cold                        evict sequences from the page cache before each run (Linux)\n"
+              << "  --layers 1,2,4                play that many sequences at once, on a shared and on separate decode pools\n"
+              << "  --upload                      time texture uploads (pixel buffers vs direct) instead of loading\n"
+              << "  --convert                     check and time the pixel conversion kernels instead of loading\n"
+              << "  --resample                    check and time the resampling kernels, down to 1080p and 720p, instead of loading\n"
+              << "  --color                       check the output color shader against the CPU reference instead of loading\n"
+              << "Results are printed to stdout as JSON.\n";
+}
+
+//--------------------------------------------------------------
+bool LoaderBenchmark::parseArguments(const vector<string>& arguments){
+    vector<string> resolutionNames = {"720p", "1080p", "4k"};
+    directory = ofToDataPath("benchmark", true);
+
+    for (size_t i = 0; i < arguments.size(); i++) {
+        const string& argument = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+        if (argument == "--formats" && hasValue) {
+            formats = splitList(arguments[++i]);
+        } else if (argument == "--resolutions" && hasValue) {
+            resolutionNames = splitList(arguments[++i]);
+        } else if (argument == "--patterns" && hasValue) {
+            patterns = splitList(arguments[++i]);
+        } else if (argument == "--frames" && hasValue) {
+            numFrames = std::max(2, ofToInt(arguments[++i]));
+        } else if (argument == "--plays" && hasValue) {
+            numPlays = std::max(1, ofToInt(arguments[++i]));
+        } else if (argument == "--threads" && hasValue) {
+            threadCounts.clear();
+            for (const string& count : splitList(arguments[++i])) {
+                threadCounts.push_back(std::max(0, ofToInt(count)));
+            }
+        } else if (argument == "--layers" && hasValue) {
+            layerCounts.clear();
+            for (const string& count : splitList(arguments[++i])) {
+                layerCounts.push_back(std::max(1, ofToInt(count)));
+            }
+        } else if (argument == "--scrub-width" && hasValue) {
+            scrubWidth = std::max(1, ofToInt(arguments[++i]));
+        } else if (argument == "--dir" && hasValue) {
+            directory = ofFilePath::getAbsolutePath(arguments[++i], false);
+        } else if (argument == "--regenerate") {
+            regenerate = true;
+        } else if (argument == "--cold") {
+            cold = true;
+        } else if (argument == "--upload") {
+            upload = true;
+        } else if (argument == "--convert") {
+            convert = true;
+        } else if (argument == "--resample") {
+            resample = true;
+        } else if (argument == "--color") {
+            color = true;
+        } else {
+            std::cerr << "Unknown argument: " << argument << "\n";
+            return false;
+        }
+    }
+
+    if (resolutionNames.size() == 1 && resolutionNames[0] == "all") {
+        resolutionNames.clear();
+        for (const auto& known : KNOWN_RESOLUTIONS) {
+            resolutionNames.push_back(known.name);
+        }
+    }
+    for (const string& name : resolutionNames) {
+        auto known = std::find_if(std::begin(KNOWN_RESOLUTIONS), std::end(KNOWN_RESOLUTIONS),
+                                  [&](const KnownResolution& resolution){ return name == resolution.name; });
+        if (known == std::end(KNOWN_RESOLUTIONS)) {
+            std::cerr << "Unknown resolution: " << name << "\n";
+            return false;
+        }
+        resolutions.push_back({known->name, known->width, known->height});
+    }
+    for (const string& format : formats) {
+        if (format != "jpg" && format != "png" && format != "tif") {
+            std::cerr << "Unknown format: " << format << "\n";
+            return false;
+        }
+    }
+    for (const string& pattern : patterns) {
+        if (pattern != "sequential" && pattern != "reverse" && pattern != "pingpong" && pattern != "random" && pattern != "scrub") {
+            std::cerr << "Unknown pattern: " << pattern << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+string LoaderBenchmark::getSequenceDirectory(const string& format, const Resolution& resolution) const {
+    return ofFilePath::join(directory, format + "_" + resolution.name);
+}
+
+//--------------------------------------------------------------
+void LoaderBenchmark::fillSyntheticFrame(ofPixels& pixels, int frame){
+    // Gradients, a moving bar and some grain, so codecs see something like
+    // real footage instead of a flat color that compresses to nothing
+    int width = pixels.getWidth();
+    int height = pixels.getHeight();
+    unsigned char* data = pixels.getData();
+    uint32_t noise = 0x9E3779B9u * (frame + 1);
+    int barX = (frame * width / 48) % width;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            noise = noise * 1664525u + 1013904223u;
+            int grain = (noise >> 28) - 8;
+            bool bar = std::abs(x - barX) < width / 32;
+            unsigned char* pixel = data + (y * width + x) * 3;
+            pixel[0] = ofClamp(x * 255 / width + grain + (bar ? 60 : 0), 0, 255);
+            pixel[1] = ofClamp(y * 255 / height + grain, 0, 255);
+            pixel[2] = ofClamp(((x + y + frame * 8) & 255) / 2 + 64 + grain, 0, 255);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+bool LoaderBenchmark::generateSequence(const string& format, const Resolution& resolution){
+    string sequenceDirectory = getSequenceDirectory(format, resolution);
+    ofDirectory existing(sequenceDirectory);
+    if (!regenerate && existing.exists() && existing.listDir() == (size_t)numFrames) {
+        return true;
+    }
+    if (existing.exists()) {
+        existing.remove(true);
+    }
+    ofDirectory::createDirectory(sequenceDirectory, false, true);
+
+    std::cerr << "Generating " << numFrames << " " << resolution.name << " " << format << " frames in " << sequenceDirectory << "\n";
+    ofPixels pixels;
+    pixels.allocate(resolution.width, resolution.height, OF_PIXELS_RGB);
+    for (int frame = 0; frame < numFrames; frame++) {
+        fillSyntheticFrame(pixels, frame);
+        string path = ofFilePath::join(sequenceDirectory, "frame_" + ofToString(frame + 1, 6, '0') + "." + format);
+        if (!ofSaveImage(pixels, path, OF_IMAGE_QUALITY_HIGH)) {
+            std::cerr << "Could not write " << path << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void LoaderBenchmark::dropFromPageCache(const string& sequenceDirectory) const {
+#ifdef TARGET_LINUX
+    ofDirectory dir(sequenceDirectory);
+    dir.listDir();
+    for (size_t i = 0; i < dir.size(); i++) {
+        int fd = open(dir.getPath(i).c_str(), O_RDONLY);
+        if (fd >= 0) {
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+#else
+    static bool warned = false;
+    if (!warned) {
+        std::cerr << "--cold needs Linux; run 'sudo purge' between runs on macOS instead\n";
+        warned = true;
+    }
+#endif
+}
+
+//--------------------------------------------------------------
+LoaderBenchmark::Result LoaderBenchmark::runPlayback(const string& sequenceDirectory, const string& pattern, int numThreads){
+    // The same setup ofApp plays folders with. The cache budget is kept at zero
+    // so every pass decodes again instead of measuring cache hits.
+    FrameCache cache;
+    cache.setBudget(0);
+    FramePrefetcher prefetcher;
+    prefetcher.setup(ringSize, cache, numThreads);
+
+    vector<string> names = FolderScanner::getSortedNames(FolderScanner::scan(sequenceDirectory, {}));
+    auto frameList = make_shared<FrameList>(sequenceDirectory, names);
+    prefetcher.setFrameList(frameList);
+
+    PlaybackCursor cursor;
+    cursor.rangeStart = 0;
+    cursor.rangeEnd = frameList->size() - 1;
+    cursor.loopMode = pattern == "pingpong" ? PING_PONG : LOOP;
+    cursor.direction = pattern == "reverse" ? BACKWARD : FORWARD;
+    cursor.index = cursor.direction == FORWARD ? cursor.rangeStart : cursor.rangeEnd;
+    prefetcher.setPlayhead(cursor);
+
+    Result result;
+    result.pattern = pattern;
+    result.threads = prefetcher.getNumThreads();
+    result.frames = frameList->size() * numPlays;
+
+    // Play as fast as frames become ready; each wait is what a player running
+    // at that rate would have stalled for
+    uint64_t start = ofGetElapsedTimeMicros();
+    for (int i = 0; i < result.frames; i++) {
+        PlaybackCursor next = cursor;
+        next.step();
+
+        uint64_t requested = ofGetElapsedTimeMicros();
+        shared_ptr<const ofPixels> frame;
+        while (!prefetcher.takeFrame(next.index, frame)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        result.waitMillis.push_back((ofGetElapsedTimeMicros() - requested) / 1000.0);
+
+        cursor = next;
+        prefetcher.setPlayhead(cursor);
+    }
+    result.seconds = (ofGetElapsedTimeMicros() - start) / 1000000.0;
+
+    prefetcher.close();
+    return result;
+}
+
+//--------------------------------------------------------------
+LoaderBenchmark::LayersResult LoaderBenchmark::runLayers(const string& sequenceDirectory, int numLayers, bool sharedPool){
+    // The app's layers share its DecodePool; separate pools of one thread per core each
+    // are what running a copy of the app per sequence amounts to
+    FrameCache cache;
+    cache.setBudget(0);
+    DecodePool pool;
+    if (sharedPool) {
+        pool.setup();
+    }
+
+    vector<string> names = FolderScanner::getSortedNames(FolderScanner::scan(sequenceDirectory, {}));
+    auto frameList = make_shared<FrameList>(sequenceDirectory, names);
+
+    vector<unique_ptr<FramePrefetcher>> prefetchers;
+    vector<PlaybackCursor> cursors(numLayers);
+    for (int i = 0; i < numLayers; i++) {
+        prefetchers.push_back(make_unique<FramePrefetcher>());
+        if (sharedPool) {
+            prefetchers[i]->setup(ringSize, cache, pool);
+        } else {
+            prefetchers[i]->setup(ringSize, cache);
+        }
+        prefetchers[i]->setFrameList(frameList);
+        // Spread over the sequence, so the layers don't all want the same frames
+        cursors[i].rangeStart = 0;
+        cursors[i].rangeEnd = frameList->size() - 1;
+        cursors[i].index = i * frameList->size() / numLayers;
+        prefetchers[i]->setPlayhead(cursors[i]);
+    }
+
+    LayersResult result;
+    result.pool = sharedPool ? "shared" : "separate";
+    result.layers = numLayers;
+    result.threads = sharedPool ? pool.getNumThreads() : prefetchers[0]->getNumThreads() * numLayers;
+    result.framesPerLayer = frameList->size() * numPlays;
+
+    // Each layer plays as fast as its frames become ready
+    vector<int> played(numLayers, 0);
+    vector<uint64_t> finished(numLayers, 0);
+    int numFinished = 0;
+    uint64_t start = ofGetElapsedTimeMicros();
+    while (numFinished < numLayers) {
+        bool any = false;
+        for (int i = 0; i < numLayers; i++) {
+            if (played[i] == result.framesPerLayer) {
+                continue;
+            }
+            PlaybackCursor next = cursors[i];
+            next.step();
+            shared_ptr<const ofPixels> frame;
+            if (!prefetchers[i]->takeFrame(next.index, frame)) {
+                continue;
+            }
+            any = true;
+            cursors[i] = next;
+            prefetchers[i]->setPlayhead(next);
+            if (++played[i] == result.framesPerLayer) {
+                finished[i] = ofGetElapsedTimeMicros();
+                numFinished++;
+            }
+        }
+        if (!any) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    result.seconds = (ofGetElapsedTimeMicros() - start) / 1000000.0;
+    for (int i = 0; i < numLayers; i++) {
+        result.layerFps.push_back(result.framesPerLayer * 1000000.0 / std::max<uint64_t>(1, finished[i] - start));
+    }
+
+    prefetchers.clear();
+    return result;
+}
+
+//--------------------------------------------------------------
+LoaderBenchmark::Result LoaderBenchmark::runRandomSeek(const string& sequenceDirectory, int minWidth){
+    // Scrubbing to arbitrary frames: nothing to prefetch, each load is paid in full.
+    // With minWidth, JPEGs decode reduced the way the app's scrub previews do.
+    FrameCache cache;
+    cache.setBudget(0);
+    vector<string> names = FolderScanner::getSortedNames(FolderScanner::scan(sequenceDirectory, {}));
+    FrameList frameList(sequenceDirectory, names);
+
+    Result result;
+    result.pattern = minWidth > 0 ? "scrub" : "random";
+    result.frames = frameList.size() * numPlays;
+
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int> pick(0, frameList.size() - 1);
+    uint64_t start = ofGetElapsedTimeMicros();
+    for (int i = 0; i < result.frames; i++) {
+        string path = frameList.getPath(pick(random));
+        uint64_t requested = ofGetElapsedTimeMicros();
+        if (!cache.load(path, minWidth, 0)) {
+            std::cerr << "Could not load " << path << "\n";
+        }
+        result.waitMillis.push_back((ofGetElapsedTimeMicros() - requested) / 1000.0);
+    }
+    result.seconds = (ofGetElapsedTimeMicros() - start) / 1000000.0;
+    return result;
+}
+
+//--------------------------------------------------------------
+LoaderBenchmark::UploadResult LoaderBenchmark::runUpload(const Resolution& resolution, bool usePixelBuffers){
+    // Two alternating frames in the format decoded JPEGs arrive in, so every
+    // upload really changes the texture
+    vector<ofPixels> frames(2);
+    for (size_t i = 0; i < frames.size(); i++) {
+        frames[i].allocate(resolution.width, resolution.height, OF_PIXELS_RGB);
+        fillSyntheticFrame(frames[i], i);
+    }
+
+    UploadResult result;
+    result.resolution = resolution;
+    result.method = usePixelBuffers ? "pbo" : "direct";
+    result.frames = numFrames * numPlays;
+
+    TextureUploader uploader;
+    uploader.setup(3);
+    ofTexture texture;
+    glFinish();
+
+    uint64_t start = ofGetElapsedTimeMicros();
+    for (int i = 0; i < result.frames; i++) {
+        const ofPixels& pixels = frames[i % frames.size()];
+        uint64_t requested = ofGetElapsedTimeMicros();
+        if (usePixelBuffers) {
+            uploader.upload(pixels);
+        } else {
+            if (!texture.isAllocated()) {
+                texture.allocate(pixels);
+            }
+            texture.loadData(pixels);
+        }
+        uint64_t submitted = ofGetElapsedTimeMicros();
+
+        // The app polls once per refresh and keeps drawing the old frame meanwhile;
+        // here the wait is taken right away to see how long the upload took to land
+        if (usePixelBuffers) {
+            uploader.finish();
+        } else {
+            glFinish();
+        }
+        uint64_t ready = ofGetElapsedTimeMicros();
+        result.submitMillis.push_back((submitted - requested) / 1000.0);
+        result.readyMillis.push_back((ready - requested) / 1000.0);
+    }
+    result.seconds = (ofGetElapsedTimeMicros() - start) / 1000000.0;
+
+    // The uploader stores RGB frames as four channels, so compare against the widened source
+    ofPixels readBack;
+    (usePixelBuffers ? uploader.getTexture() : texture).readToPixels(readBack);
+    ofPixels expected = frames[(result.frames - 1) % frames.size()];
+    if (readBack.getNumChannels() == 4) {
+        ofPixels widened;
+        widened.allocate(expected.getWidth(), expected.getHeight(), OF_PIXELS_RGBA);
+        PixelConvert::toFourChannels(expected.getData(), expected.getNumChannels(), widened.getData(),
+                                     expected.getWidth() * expected.getHeight(), PixelConvert::RGBA);
+        expected = widened;
+    }
+    result.verified = readBack.size() == expected.size() &&
+                      memcmp(readBack.getData(), expected.getData(), expected.size()) == 0;
+    if (!result.verified) {
+        std::cerr << "Uploaded texture doesn't match its source pixels\n";
+    }
+    return result;
+}
+
+//--------------------------------------------------------------
+bool LoaderBenchmark::runConvert(const Resolution& resolution){
+    // Every conversion a frame can take on its way to the GPU, each run with every
+    // kernel set the CPU has. Output must match the scalar kernels byte for byte.
+    struct Case {
+        const char* name;
+        int channels;
+        bool wide;
+        bool premultiply;
+        bool colorMatrix;  // in place on the source instead of a conversion
+    };
+    const Case cases[] = {
+        {"grey8_to_bgra", 1, false, false, false},
+        {"rgb8_to_bgra", 3, false, false, false},
+        {"rgba8_to_bgra", 4, false, false, false},
+        {"rgba8_premultiply", 4, false, true, false},
+        {"rgb16_to_bgra", 3, true, false, false},
+        {"rgba16_to_bgra_premultiply", 4, true, true, false},
+        {"rgb8_color_matrix", 3, false, false, true},
+        {"rgba8_color_matrix", 4, false, false, true},
+    };
+    ColorAdjust::Settings colorSettings;
+    colorSettings.brightness = 0.1f;
+    colorSettings.contrast = 1.3f;
+    colorSettings.saturation = 0.6f;
+    float colorMatrix[12];
+    ColorAdjust::getMatrix(colorSettings, colorMatrix);
+
+    size_t numPixels = (size_t)resolution.width * resolution.height;
+    std::mt19937 random(1234);
+    vector<uint8_t> narrowSource(numPixels * 4);
+    vector<uint16_t> wideSource(numPixels * 4);
+    for (auto& sample : narrowSource) {
+        sample = random();
+    }
+    for (auto& sample : wideSource) {
+        sample = random();
+    }
+    vector<uint8_t> reference(numPixels * 4);
+    vector<uint8_t> output(numPixels * 4);
+
+    PixelConvert::Implementation best = PixelConvert::getImplementation();
+    bool exact = true;
+    for (const Case& test : cases) {
+        double scalarMillis = 0;
+        for (int implementation = PixelConvert::SCALAR; implementation <= PixelConvert::NEON; implementation++) {
+            if (!PixelConvert::setImplementation((PixelConvert::Implementation)implementation)) {
+                continue;
+            }
+            vector<uint8_t>& target = implementation == PixelConvert::SCALAR ? reference : output;
+            vector<double> millis;
+            for (int play = 0; play < std::max(numPlays, 3); play++) {
+                if (test.colorMatrix) {
+                    std::copy(narrowSource.begin(), narrowSource.begin() + numPixels * test.channels, target.begin());
+                }
+                uint64_t start = ofGetElapsedTimeMicros();
+                if (test.colorMatrix) {
+                    PixelConvert::colorMatrix(target.data(), test.channels, numPixels, colorMatrix);
+                } else if (test.wide) {
+                    PixelConvert::toFourChannels(wideSource.data(), test.channels, target.data(), numPixels, PixelConvert::BGRA, test.premultiply);
+                } else {
+                    PixelConvert::toFourChannels(narrowSource.data(), test.channels, target.data(), numPixels, PixelConvert::BGRA, test.premultiply);
+                }
+                millis.push_back((ofGetElapsedTimeMicros() - start) / 1000.0);
+            }
+            double p50 = percentile(millis, 0.5);
+            if (implementation == PixelConvert::SCALAR) {
+                scalarMillis = p50;
+            }
+            bool matches = target == reference;
+            exact = exact && matches;
+
+            std::cout << std::fixed << std::setprecision(3)
+                      << "{\"convert\":\"" << test.name << "\""
+                      << ",\"implementation\":\"" << PixelConvert::getName((PixelConvert::Implementation)implementation) << "\""
+                      << ",\"resolution\":\"" << resolution.name << "\""
+                      << ",\"width\":" << resolution.width
+                      << ",\"height\":" << resolution.height
+                      << ",\"p50_ms\":" << p50
+                      << ",\"mpixels_per_s\":" << (p50 > 0 ? numPixels / (p50 * 1000.0) : 0)
+                      << ",\"speedup\":" << (p50 > 0 ? scalarMillis / p50 : 0)
+                      << ",\"exact\":" << (matches ? "true" : "false")
+                      << "}" << std::endl;
+        }
+    }
+    PixelConvert::setImplementation(best);
+    if (!exact) {
+        std::cerr << "A SIMD kernel doesn't match the scalar one\n";
+    }
+    return exact;
+}
+
+//--------------------------------------------------------------
+bool LoaderBenchmark::runResample(const Resolution& resolution){
+    // A frame resampled on a loader thread to the sizes the app's outputs come in,
+    // with every kernel set the CPU has. Output must match the scalar kernels byte for
+    // byte and stay within MAX_RESAMPLE_ERROR of the double precision reference.
+    ofPixels frame;
+    frame.allocate(resolution.width, resolution.height, OF_PIXELS_RGB);
+    fillSyntheticFrame(frame, 0);
+    size_t numPixels = (size_t)resolution.width * resolution.height;
+    vector<uint8_t> rgba(numPixels * 4);
+    PixelConvert::toFourChannels(frame.getData(), 3, rgba.data(), numPixels, PixelConvert::RGBA);
+
+    PixelConvert::Implementation best = PixelConvert::getImplementation();
+    bool exact = true;
+    for (const KnownResolution& target : {KNOWN_RESOLUTIONS[1], KNOWN_RESOLUTIONS[0]}) {
+        int width, height;
+        Resampler::getFitSize(resolution.width, resolution.height, target.width, target.height, true, width, height);
+        if (width >= resolution.width || height >= resolution.height) {
+            continue;
+        }
+        size_t outputPixels = (size_t)width * height;
+        for (int channels : {3, 4}) {
+            const uint8_t* source = channels == 3 ? frame.getData() : rgba.data();
+            for (Resampler::Filter filter : {Resampler::BOX, Resampler::LANCZOS3}) {
+                vector<uint8_t> ideal(outputPixels * channels);
+                Resampler::resizeReference(source, resolution.width, resolution.height, channels, ideal.data(), width, height, filter);
+                int maxError = 0;
+                double squaredError = 0;
+
+                vector<uint8_t> reference(outputPixels * channels);
+                vector<uint8_t> output(outputPixels * channels);
+                double scalarMillis = 0;
+                for (int implementation = PixelConvert::SCALAR; implementation <= PixelConvert::NEON; implementation++) {
+                    if (!PixelConvert::setImplementation((PixelConvert::Implementation)implementation)) {
+                        continue;
+                    }
+                    vector<uint8_t>& result = implementation == PixelConvert::SCALAR ? reference : output;
+                    vector<double> millis;
+                    for (int play = 0; play < std::max(numPlays, 3); play++) {
+                        uint64_t start = ofGetElapsedTimeMicros();
+                        Resampler::resize(source, resolution.width, resolution.height, channels, result.data(), width, height, filter);
+                        millis.push_back((ofGetElapsedTimeMicros() - start) / 1000.0);
+                    }
+                    double p50 = percentile(millis, 0.5);
+                    if (implementation == PixelConvert::SCALAR) {
+                        scalarMillis = p50;
+                        for (size_t i = 0; i < result.size(); i++) {
+                            int error = std::abs(result[i] - ideal[i]);
+                            maxError = std::max(maxError, error);
+                            squaredError += error * error;
+                        }
+                    }
+                    bool matches = result == reference;
+                    exact = exact && matches && maxError <= MAX_RESAMPLE_ERROR;
+                    double meanSquaredError = squaredError / result.size();
+
+                    std::cout << std::fixed << std::setprecision(3)
+                              << "{\"resample\":\"" << Resampler::getName(filter) << "\""
+                              << ",\"implementation\":\"" << PixelConvert::getName((PixelConvert::Implementation)implementation) << "\""
+                              << ",\"resolution\":\"" << resolution.name << "\""
+                              << ",\"output\":\"" << target.name << "\""
+                              << ",\"channels\":" << channels
+                              << ",\"width\":" << width
+                              << ",\"height\":" << height
+                              << ",\"p50_ms\":" << p50
+                              << ",\"mpixels_per_s\":" << (p50 > 0 ? numPixels / (p50 * 1000.0) : 0)
+                              << ",\"speedup\":" << (p50 > 0 ? scalarMillis / p50 : 0)
+                              << ",\"exact\":" << (matches ? "true" : "false")
+                              << ",\"max_error\":" << maxError
+                              << ",\"psnr_db\":" << (meanSquaredError > 0 ? 10 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0)
+                              << ",\"upload_bytes\":" << outputPixels * 4
+                              << ",\"full_upload_bytes\":" << numPixels * 4
+                              << "}" << std::endl;
+                }
+            }
+        }
+    }
+    PixelConvert::setImplementation(best);
+    if (!exact) {
+        std::cerr << "A resampling kernel doesn't match the scalar one or the reference\n";
+    }
+    return exact;
+}
+
+//--------------------------------------------------------------
+bool LoaderBenchmark::runColor(const Resolution& resolution){
+    // A synthetic frame goes through the output color shader into an FBO of its own size,
+    // is read back and compared with ColorAdjust::apply() on the same pixels. They only
+    // differ in rounding, so no sample may be off by more than one level.
+    ofPixels frame;
+    frame.allocate(resolution.width, resolution.height, OF_PIXELS_RGB);
+    fillSyntheticFrame(frame, 0);
+    ofPixels source;
+    source.allocate(resolution.width, resolution.height, OF_PIXELS_RGBA);
+    PixelConvert::toFourChannels(frame.getData(), 3, source.getData(), frame.getWidth() * frame.getHeight(), PixelConvert::RGBA);
+
+    ofTexture texture;
+    texture.allocate(source);
+    texture.loadData(source);
+    texture.setTextureMinMagFilter(GL_NEAREST, GL_NEAREST);
+    ofFbo fbo;
+    fbo.allocate(resolution.width, resolution.height, GL_RGBA);
+    ColorAdjust colorAdjust;
+    if (!colorAdjust.setup()) {
+        return false;
+    }
+
+    const float settingsList[][3] = {{0.2f, 1, 1}, {-0.3f, 1.5f, 0.5f}, {0.1f, 0.7f, 2}, {0, 2, 0}, {0, 1, 1.5f}};
+    bool verified = true;
+    for (const auto& values : settingsList) {
+        ColorAdjust::Settings settings;
+        settings.brightness = values[0];
+        settings.contrast = values[1];
+        settings.saturation = values[2];
+
+        fbo.begin();
+        ofClear(0, 0, 0, 255);
+        colorAdjust.draw(texture, 0, 0, resolution.width, resolution.height, settings);
+        fbo.end();
+        ofPixels gpu;
+        fbo.readToPixels(gpu);
+
+        ofPixels cpu = source;
+        uint64_t start = ofGetElapsedTimeMicros();
+        ColorAdjust::apply(cpu, settings);
+        double cpuMillis = (ofGetElapsedTimeMicros() - start) / 1000.0;
+
+        int maxDifference = gpu.size() == cpu.size() ? 0 : 255;
+        for (size_t i = 0; i < cpu.size() && maxDifference < 255; i++) {
+            maxDifference = std::max(maxDifference, std::abs(gpu[i] - cpu[i]));
+        }
+        bool matches = maxDifference <= 1;
+        verified = verified && matches;
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "{\"color\":\"b" << settings.brightness << "_c" << settings.contrast << "_s" << settings.saturation << "\""
+                  << ",\"resolution\":\"" << resolution.name << "\""
+                  << ",\"width\":" << resolution.width
+                  << ",\"height\":" << resolution.height
+                  << ",\"renderer\":\"" << (const char*)glGetString(GL_RENDERER) << "\""
+                  << ",\"cpu_ms\":" << cpuMillis
+                  << ",\"cpu_implementation\":\"" << PixelConvert::getName(PixelConvert::getImplementation()) << "\""
+                  << ",\"max_diff\":" << maxDifference
+                  << ",\"verified\":" << (matches ? "true" : "false")
+                  << "}" << std::endl;
+    }
+    if (!verified) {
+        std::cerr << "The color shader doesn't match the CPU reference\n";
+    }
+    return verified;
+}
+
+//--------------------------------------------------------------
+bool LoaderBenchmark::run(){
+    if (convert) {
+        bool exact = true;
+        for (const Resolution& resolution : resolutions) {
+            exact = runConvert(resolution) && exact;
+        }
+        return exact;
+    }
+    if (resample) {
+        bool exact = true;
+        for (const Resolution& resolution : resolutions) {
+            exact = runResample(resolution) && exact;
+        }
+        return exact;
+    }
+    if (color) {
+        bool verified = true;
+        for (const Resolution& resolution : resolutions) {
+            std::cerr << resolution.name << " color...\n";
+            verified = runColor(resolution) && verified;
+        }
+        return verified;
+    }
+    if (upload) {
+        bool verified = true;
+        for (const Resolution& resolution : resolutions) {
+            for (bool usePixelBuffers : {true, false}) {
+                std::cerr << resolution.name << (usePixelBuffers ? " pbo" : " direct") << " upload...\n";
+                UploadResult result = runUpload(resolution, usePixelBuffers);
+                writeUploadResult(result);
+                verified = verified && result.verified;
+            }
+        }
+        return verified;
+    }
+
+    for (const Resolution& resolution : resolutions) {
+        for (const string& format : formats) {
+            if (!generateSequence(format, resolution)) {
+                return false;
+            }
+            string sequenceDirectory = getSequenceDirectory(format, resolution);
+
+            uint64_t totalBytes = 0;
+            ofDirectory dir(sequenceDirectory);
+            dir.listDir();
+            for (size_t i = 0; i < dir.size(); i++) {
+                totalBytes += dir.getFile(i).getSize();
+            }
+
+            if (!layerCounts.empty()) {
+                for (int numLayers : layerCounts) {
+                    for (bool sharedPool : {true, false}) {
+                        std::cerr << resolution.name << " " << format << " " << numLayers << " layers, "
+                                  << (sharedPool ? "shared" : "separate") << " pool...\n";
+                        if (cold) {
+                            dropFromPageCache(sequenceDirectory);
+                        }
+                        LayersResult result = runLayers(sequenceDirectory, numLayers, sharedPool);
+                        result.format = format;
+                        result.resolution = resolution;
+                        writeLayersResult(result);
+                    }
+                }
+                continue;
+            }
+
+            for (const string& pattern : patterns) {
+                // Seeks load on the calling thread, so only playback repeats per thread count
+                bool seek = pattern == "random" || pattern == "scrub";
+                for (size_t t = 0; t < (seek ? 1 : threadCounts.size()); t++) {
+                    std::cerr << resolution.name << " " << format << " " << pattern;
+                    if (!seek && threadCounts.size() > 1) {
+                        std::cerr << " x" << threadCounts[t];
+                    }
+                    std::cerr << "...\n";
+                    if (cold) {
+                        dropFromPageCache(sequenceDirectory);
+                    }
+                    FrameStats::get().reset();
+
+                    Result result;
+                    if (seek) {
+                        result = runRandomSeek(sequenceDirectory, pattern == "scrub" ? scrubWidth : 0);
+                    } else {
+                        result = runPlayback(sequenceDirectory, pattern, threadCounts[t]);
+                    }
+                    result.format = format;
+                    result.resolution = resolution;
+                    result.averageFileBytes = dir.size() > 0 ? totalBytes / (double)dir.size() : 0;
+                    writeResult(result);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void LoaderBenchmark::writeResult(const Result& result) const {
+    // One JSON object per line as each run finishes, so long runs can be
+    // followed live and piped into a file or jq
+    FrameStats::Summary read = FrameStats::get().getSummary(FrameStats::FILE_READ);
+    FrameStats::Summary decode = FrameStats::get().getSummary(FrameStats::DECODE);
+    std::cout << std::fixed << std::setprecision(3)
+              << "{\"format\":\"" << result.format << "\""
+              << ",\"resolution\":\"" << result.resolution.name << "\""
+              << ",\"width\":" << result.resolution.width
+              << ",\"height\":" << result.resolution.height
+              << ",\"pattern\":\"" << result.pattern << "\""
+              << ",\"frames\":" << result.frames
+              << ",\"threads\":" << result.threads
+              << ",\"cores\":" << std::thread::hardware_concurrency()
+              << ",\"cold\":" << (cold ? "true" : "false")
+              << ",\"avg_file_mb\":" << result.averageFileBytes / (1024.0 * 1024.0)
+              << ",\"fps\":" << (result.seconds > 0 ? result.frames / result.seconds : 0)
+              << ",\"wait_p50_ms\":" << percentile(result.waitMillis, 0.5)
+              << ",\"wait_p99_ms\":" << percentile(result.waitMillis, 0.99)
+              << ",\"wait_max_ms\":" << percentile(result.waitMillis, 1.0)
+              << ",\"read_p50_ms\":" << read.p50Millis
+              << ",\"read_p99_ms\":" << read.p99Millis
+              << ",\"decode_p50_ms\":" << decode.p50Millis
+              << ",\"decode_p99_ms\":" << decode.p99Millis
+              << "}" << std::endl;
+}
+
+//--------------------------------------------------------------
+void LoaderBenchmark::writeLayersResult(const LayersResult& result) const {
+    double total = 0;
+    for (double fps : result.layerFps) {
+        total += fps;
+    }
+    std::cout << std::fixed << std::setprecision(3)
+              << "{\"layers\":" << result.layers
+              << ",\"pool\":\"" << result.pool << "\""
+              << ",\"format\":\"" << result.format << "\""
+              << ",\"resolution\":\"" << result.resolution.name << "\""
+              << ",\"frames_per_layer\":" << result.framesPerLayer
+              << ",\"threads\":" << result.threads
+              << ",\"cores\":" << std::thread::hardware_concurrency()
+              << ",\"cold\":" << (cold ? "true" : "false")
+              << ",\"seconds\":" << result.seconds
+              << ",\"fps_total\":" << total
+              << ",\"fps_min_layer\":" << percentile(result.layerFps, 0)
+              << ",\"fps_max_layer\":" << percentile(result.layerFps, 1.0)
+              << "}" << std::endl;
+}
+
+//--------------------------------------------------------------
+void LoaderBenchmark::writeUploadResult(const UploadResult& result) const {
+    double megabytes = result.frames * result.resolution.width * result.resolution.height * 3.0 / (1024.0 * 1024.0);
+    std::cout << std::fixed << std::setprecision(3)
+              << "{\"upload\":\"" << result.method << "\""
+              << ",\"resolution\":\"" << result.resolution.name << "\""
+              << ",\"width\":" << result.resolution.width
+              << ",\"height\":" << result.resolution.height
+              << ",\"frames\":" << result.frames
+              << ",\"renderer\":\"" << (const char*)glGetString(GL_RENDERER) << "\""
+              << ",\"fps\":" << (result.seconds > 0 ? result.frames / result.seconds : 0)
+              << ",\"mb_per_s\":" << (result.seconds > 0 ? megabytes / result.seconds : 0)
+              << ",\"submit_p50_ms\":" << percentile(result.submitMillis, 0.5)
+              << ",\"submit_p99_ms\":" << percentile(result.submitMillis, 0.99)
+              << ",\"ready_p50_ms\":" << percentile(result.readyMillis, 0.5)
+              << ",\"ready_p99_ms\":" << percentile(result.readyMillis, 0.99)
+              << ",\"verified\":" << (result.verified ? "true" : "false")
+              << "}" << std::endl;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "ofMain.h"
+#include "PlaybackCursor.h"
+
+// Measures the frame loading path the app plays from: FramePrefetcher decoding
+// through FrameCache for sequential, reverse and ping-pong playback, and plain
+// FrameCache loads for random seeks at full and at scrubbing size. Synthetic
+// JPEG/PNG/TIFF sequences are generated once per resolution and reused by later runs.
+//
+// With --layers it plays several sequences at once the way the app's layers do,
+// on one shared DecodePool and on a pool per layer, and reports how the decode
+// throughput is split between them.
+//
+// With --convert it checks the PixelConvert SIMD kernels bit for bit against the
+// scalar ones and times both, and with --resample the same for the Resampler
+// kernels, which are also held against a double precision reference. With --upload it instead times TextureUploader
+// against plain ofTexture uploads, and with --color it checks the output colour
+// shader against ColorAdjust's CPU reference. Both need a GL context, so main()
+// opens a hidden window first (Mesa llvmpipe under Xvfb is enough on Linux).
+//
+// Results go to stdout as one JSON object per run and line; progress goes to stderr.
+class LoaderBenchmark {
+public:
+	static void printUsage();
+	bool parseArguments(const vector<string>& arguments);
+	bool run();
+	bool needsGL() const { return upload || color; }
+	
+private:
+	struct Resolution {
+		string name;
+		int width;
+		int height;
+	};
+	
+	struct Result {
+		string format;
+		Resolution resolution;
+		string pattern;
+		int threads = 1;           // decode threads the prefetcher ran with
+		int frames = 0;
+		double seconds = 0;
+		double averageFileBytes = 0;
+		vector<double> waitMillis;  // per frame: how long the player waited for it
+	};
+	
+	struct LayersResult {
+		string format;
+		Resolution resolution;
+		string pool;               // "shared" or "separate"
+		int layers = 0;
+		int threads = 0;           // decode threads in total
+		int framesPerLayer = 0;
+		double seconds = 0;        // until the last layer played all its frames
+		vector<double> layerFps;   // per layer, over the time it took to play its frames
+	};
+	
+	struct UploadResult {
+		Resolution resolution;
+		string method;
+		int frames = 0;
+		double seconds = 0;
+		vector<double> submitMillis;  // per frame: how long the render thread was blocked
+		vector<double> readyMillis;   // per frame: until the texture was complete on the GPU
+		bool verified = false;        // the last texture read back equal to its source pixels
+	};
+	
+	string getSequenceDirectory(const string& format, const Resolution& resolution) const;
+	bool generateSequence(const string& format, const Resolution& resolution);
+	static void fillSyntheticFrame(ofPixels& pixels, int frame);
+	void dropFromPageCache(const string& directory) const;
+	
+	Result runPlayback(const string& directory, const string& pattern, int numThreads);
+	Result runRandomSeek(const string& directory, int minWidth);
+	void writeResult(const Result& result) const;
+	LayersResult runLayers(const string& directory, int numLayers, bool sharedPool);
+	void writeLayersResult(const LayersResult& result) const;
+	UploadResult runUpload(const Resolution& resolution, bool usePixelBuffers);
+	void writeUploadResult(const UploadResult& result) const;
+	bool runConvert(const Resolution& resolution);
+	bool runResample(const Resolution& resolution);
+	bool runColor(const Resolution& resolution);
+	
+	vector<string> formats = {"jpg", "png", "tif"};
+	vector<Resolution> resolutions;
+	vector<string> patterns = {"sequential", "reverse", "pingpong", "random", "scrub"};
+	int numFrames = 48;
+	int numPlays = 3;          // times each playback pattern goes through the sequence
+	int ringSize = 8;          // matches ofApp::PREFETCH_RING_SIZE
+	vector<int> threadCounts = {0};  // decode threads per playback run; 0 = one per core, like the app
+	vector<int> layerCounts;   // sequences played at once; empty unless --layers
+	int scrubWidth = 320;      // matches ofApp's default scrubbing quality
+	bool cold = false;
+	bool regenerate = false;
+	bool upload = false;
+	bool convert = false;
+	bool resample = false;
+	bool color = false;
+	string directory;
+};
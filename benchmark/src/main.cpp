@@ -0,0 +1,25 @@
+#include "ofMain.h"
+#include "LoaderBenchmark.h"
+
+//========================================================================
+int main(int argc, char* argv[]){
+    ofInit();
+    LoaderBenchmark benchmark;
+    if (!benchmark.parseArguments(vector<string>(argv + 1, argv + argc))) {
+        LoaderBenchmark::printUsage();
+        return 1;
+    }
+    
+    if (benchmark.needsGL()) {
+        // Upload runs need a context of the same GL version the app uses; the
+        // window itself is never shown. Loading runs don't touch GL and need no window.
+        ofGLFWWindowSettings settings;
+        settings.setGLVersion(3, 2);
+        settings.setSize(64, 64);
+        settings.visible = false;
+        ofCreateWindow(settings);
+    }
+    // Notices and warnings would go to stdout with the results, so only errors are logged
+    ofSetLogLevel(OF_LOG_ERROR);
+    return benchmark.run() ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// Reference reader for the app's shared memory output, and a way to check it from a
+// render node: attaches to /dev/shm/sequencestreamer-<output> and prints, once a second,
+// the frames received, how late they arrived after being rendered, and how many were
+// dropped or overwritten while being read. Needs only SharedFrameRing.h/.cpp:
+//
+//   c++ -std=c++17 -O2 -I../src main.cpp ../src/SharedFrameRing.cpp -o shmclient
+//   ./shmclient [main|1080p|720p] [--seconds N]
+
+#include "SharedFrameRing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    double getPercentile(std::vector<double> values, double percentile) {
+        if (values.empty()) {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, (size_t)(percentile * values.size()))];
+    }
+
+    // Touches every row the way a consumer copying or uploading the frame would
+    uint32_t readFrame(const SharedFrame& frame) {
+        uint32_t sum = 0;
+        for (uint32_t y = 0; y < frame.height; y++) {
+            const uint8_t* row = frame.pixels + (size_t)y * frame.stride;
+            for (uint32_t x = 0; x < frame.stride; x += 64) {
+                sum += row[x];
+            }
+        }
+        return sum;
+    }
+}
+
+//========================================================================
+int main(int argc, char* argv[]){
+    std::string output = "main";
+    double seconds = 0;  // 0 = until interrupted
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            output = argv[i];
+        } else {
+            fprintf(stderr, "usage: shmclient [main|1080p|720p] [--seconds N]\n");
+            return 1;
+        }
+    }
+    std::string name = "sequencestreamer-" + output;
+
+    SharedFrameReader reader;
+    uint64_t start = SharedFrameRing::getTimeMicros();
+    uint64_t reportTime = start;
+    uint64_t totalFrames = 0, totalDropped = 0, totalTorn = 0;
+    uint64_t frames = 0, torn = 0, droppedAtReport = 0;
+    std::vector<double> latencyMillis;
+    uint32_t width = 0, height = 0;
+    bool waiting = false;
+
+    while (seconds <= 0 || SharedFrameRing::getTimeMicros() - start < seconds * 1000000) {
+        if (!reader.isOpen() || reader.isClosed()) {
+            // Not started yet, quit, or reopened the segment for a larger output size
+            if (reader.isOpen()) {
+                totalDropped += reader.getNumDropped() - droppedAtReport;
+            }
+            droppedAtReport = 0;
+            if (!reader.open(name)) {
+                if (!waiting) {
+                    fprintf(stderr, "Waiting for /dev/shm/%s\n", name.c_str());
+                    waiting = true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            waiting = false;
+            fprintf(stderr, "Reading /dev/shm/%s\n", name.c_str());
+        }
+
+        SharedFrame frame;
+        if (reader.wait(100) && reader.acquire(frame)) {
+            readFrame(frame);
+            if (reader.isIntact(frame)) {
+                latencyMillis.push_back((SharedFrameRing::getTimeMicros() - frame.timestampMicros) / 1000.0);
+                width = frame.width;
+                height = frame.height;
+                frames++;
+            } else {
+                torn++;
+            }
+        }
+
+        uint64_t now = SharedFrameRing::getTimeMicros();
+        if (now - reportTime >= 1000000) {
+            uint64_t dropped = reader.isOpen() ? reader.getNumDropped() - droppedAtReport : 0;
+            droppedAtReport += dropped;
+            printf("%ux%u  %.1f fps  latency p50 %.2f ms  p99 %.2f ms  max %.2f ms  dropped %llu  torn %llu\n",
+                   width, height, frames * 1000000.0 / (now - reportTime),
+                   getPercentile(latencyMillis, 0.5), getPercentile(latencyMillis, 0.99), getPercentile(latencyMillis, 1),
+                   (unsigned long long)dropped, (unsigned long long)torn);
+            fflush(stdout);
+            totalFrames += frames;
+            totalDropped += dropped;
+            totalTorn += torn;
+            frames = 0;
+            torn = 0;
+            latencyMillis.clear();
+            reportTime = now;
+        }
+    }
+    printf("total %llu frames  dropped %llu  torn %llu\n",
+           (unsigned long long)totalFrames, (unsigned long long)totalDropped, (unsigned long long)totalTorn);
+    return 0;
+}
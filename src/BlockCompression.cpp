@@ -0,0 +1,307 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    inline uint16_t packRgb565(int r, int g, int b) {
+        return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+    }
+    
+    inline void unpackRgb565(uint16_t c, uint8_t* rgb) {
+        int r = (c >> 11) & 31;
+        int g = (c >> 5) & 63;
+        int b = c & 31;
+        rgb[0] = (uint8_t)((r << 3) | (r >> 2));
+        rgb[1] = (uint8_t)((g << 2) | (g >> 4));
+        rgb[2] = (uint8_t)((b << 3) | (b >> 2));
+    }
+    
+    // Copy a 4x4 block, replicating the last row/column past the image edge
+    void fetchBlock(const uint8_t* rgba, int width, int height, int bx, int by, uint8_t block[64]) {
+        for (int y = 0; y < 4; y++) {
+            int sy = std::min(by * 4 + y, height - 1);
+            for (int x = 0; x < 4; x++) {
+                int sx = std::min(bx * 4 + x, width - 1);
+                memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+            }
+        }
+    }
+    
+    void encodeColorBlock(const uint8_t block[64], uint8_t* out) {
+        // Endpoints are the extremes of the pixels projected onto the principal
+        // axis of the block's colors, which follows gradients in any direction
+        float mean[3] = {0, 0, 0};
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 3; c++) {
+                mean[c] += block[i * 4 + c];
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            mean[c] /= 16.0f;
+        }
+        
+        float covariance[6] = {0, 0, 0, 0, 0, 0};  // rr rg rb gg gb bb
+        for (int i = 0; i < 16; i++) {
+            float r = block[i * 4 + 0] - mean[0];
+            float g = block[i * 4 + 1] - mean[1];
+            float b = block[i * 4 + 2] - mean[2];
+            covariance[0] += r * r;
+            covariance[1] += r * g;
+            covariance[2] += r * b;
+            covariance[3] += g * g;
+            covariance[4] += g * b;
+            covariance[5] += b * b;
+        }
+        
+        // A few power iterations are plenty for a 3x3 matrix
+        float axis[3] = {1, 1, 1};
+        for (int iteration = 0; iteration < 4; iteration++) {
+            float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+            float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+            float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+            float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+            if (length < 1e-6f) {
+                break;
+            }
+            axis[0] = x / length;
+            axis[1] = y / length;
+            axis[2] = z / length;
+        }
+        
+        int minIndex = 0;
+        int maxIndex = 0;
+        float minProjection = 1e30f;
+        float maxProjection = -1e30f;
+        for (int i = 0; i < 16; i++) {
+            float projection = block[i * 4 + 0] * axis[0] + block[i * 4 + 1] * axis[1] + block[i * 4 + 2] * axis[2];
+            if (projection < minProjection) {
+                minProjection = projection;
+                minIndex = i;
+            }
+            if (projection > maxProjection) {
+                maxProjection = projection;
+                maxIndex = i;
+            }
+        }
+        
+        int minColor[3];
+        int maxColor[3];
+        for (int c = 0; c < 3; c++) {
+            minColor[c] = block[minIndex * 4 + c];
+            maxColor[c] = block[maxIndex * 4 + c];
+        }
+        
+        uint16_t color0 = packRgb565(maxColor[0], maxColor[1], maxColor[2]);
+        uint16_t color1 = packRgb565(minColor[0], minColor[1], minColor[2]);
+        
+        if (color0 == color1) {
+            // Flat block: every index points at color0
+            out[0] = color0 & 0xff;
+            out[1] = color0 >> 8;
+            out[2] = color1 & 0xff;
+            out[3] = color1 >> 8;
+            memset(out + 4, 0, 4);
+            return;
+        }
+        // color0 > color1 selects the four-color mode
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+        
+        // Palette as the decoder will reconstruct it
+        uint8_t palette[4][3];
+        unpackRgb565(color0, palette[0]);
+        unpackRgb565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+        
+        uint32_t indices = 0;
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            int bestDistance = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dr = block[i * 4 + 0] - palette[p][0];
+                int dg = block[i * 4 + 1] - palette[p][1];
+                int db = block[i * 4 + 2] - palette[p][2];
+                int distance = dr * dr + dg * dg + db * db;
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+        
+        out[0] = color0 & 0xff;
+        out[1] = color0 >> 8;
+        out[2] = color1 & 0xff;
+        out[3] = color1 >> 8;
+        out[4] = indices & 0xff;
+        out[5] = (indices >> 8) & 0xff;
+        out[6] = (indices >> 16) & 0xff;
+        out[7] = indices >> 24;
+    }
+    
+    void encodeAlphaBlock(const uint8_t block[64], uint8_t* out) {
+        int minAlpha = 255;
+        int maxAlpha = 0;
+        for (int i = 0; i < 16; i++) {
+            minAlpha = std::min(minAlpha, (int)block[i * 4 + 3]);
+            maxAlpha = std::max(maxAlpha, (int)block[i * 4 + 3]);
+        }
+        
+        out[0] = (uint8_t)maxAlpha;
+        out[1] = (uint8_t)minAlpha;
+        if (maxAlpha == minAlpha) {
+            memset(out + 2, 0, 6);
+            return;
+        }
+        
+        // alpha0 > alpha1 selects the eight-value ramp
+        int palette[8];
+        palette[0] = maxAlpha;
+        palette[1] = minAlpha;
+        for (int i = 1; i < 7; i++) {
+            palette[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+        }
+        
+        uint64_t indices = 0;
+        for (int i = 0; i < 16; i++) {
+            int alpha = block[i * 4 + 3];
+            int best = 0;
+            int bestDistance = 256;
+            for (int p = 0; p < 8; p++) {
+                int distance = std::abs(alpha - palette[p]);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+        for (int i = 0; i < 6; i++) {
+            out[2 + i] = (uint8_t)(indices >> (i * 8));
+        }
+    }
+    
+    void decodeColorBlock(const uint8_t* in, uint8_t block[64]) {
+        uint16_t color0 = in[0] | (in[1] << 8);
+        uint16_t color1 = in[2] | (in[3] << 8);
+        uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+        
+        uint8_t palette[4][4];
+        unpackRgb565(color0, palette[0]);
+        unpackRgb565(color1, palette[1]);
+        palette[0][3] = palette[1][3] = palette[2][3] = 255;
+        if (color0 > color1) {
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+                palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+            }
+            palette[3][3] = 255;
+        } else {
+            // Three-color mode with transparent black
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c]) / 2);
+                palette[3][c] = 0;
+            }
+            palette[3][3] = 0;
+        }
+        
+        for (int i = 0; i < 16; i++) {
+            memcpy(block + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+        }
+    }
+    
+    void decodeAlphaBlock(const uint8_t* in, uint8_t block[64]) {
+        int alpha0 = in[0];
+        int alpha1 = in[1];
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++) {
+            indices |= (uint64_t)in[2 + i] << (i * 8);
+        }
+        
+        int palette[8];
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        if (alpha0 > alpha1) {
+            for (int i = 1; i < 7; i++) {
+                palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+            }
+        } else {
+            for (int i = 1; i < 5; i++) {
+                palette[i + 1] = ((5 - i) * alpha0 + i * alpha1) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        
+        for (int i = 0; i < 16; i++) {
+            block[i * 4 + 3] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+        }
+    }
+}
+
+//--------------------------------------------------------------
+size_t BlockCompression::getCompressedSize(int width, int height, Format format){
+    size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * (format == BC1 ? 8 : 16);
+}
+
+//--------------------------------------------------------------
+bool BlockCompression::hasAlpha(const uint8_t* rgba, int width, int height){
+    size_t pixels = (size_t)width * height;
+    for (size_t i = 0; i < pixels; i++) {
+        if (rgba[i * 4 + 3] != 255) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//--------------------------------------------------------------
+void BlockCompression::encode(const uint8_t* rgba, int width, int height, Format format, uint8_t* blocks){
+    int blocksWide = (width + 3) / 4;
+    int blocksHigh = (height + 3) / 4;
+    size_t blockBytes = (format == BC1) ? 8 : 16;
+    uint8_t block[64];
+    
+    for (int by = 0; by < blocksHigh; by++) {
+        for (int bx = 0; bx < blocksWide; bx++) {
+            uint8_t* out = blocks + ((size_t)by * blocksWide + bx) * blockBytes;
+            fetchBlock(rgba, width, height, bx, by, block);
+            if (format == BC3) {
+                encodeAlphaBlock(block, out);
+                out += 8;
+            }
+            encodeColorBlock(block, out);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void BlockCompression::decode(const uint8_t* blocks, int width, int height, Format format, uint8_t* rgba){
+    int blocksWide = (width + 3) / 4;
+    int blocksHigh = (height + 3) / 4;
+    size_t blockBytes = (format == BC1) ? 8 : 16;
+    uint8_t block[64];
+    
+    for (int by = 0; by < blocksHigh; by++) {
+        for (int bx = 0; bx < blocksWide; bx++) {
+            const uint8_t* in = blocks + ((size_t)by * blocksWide + bx) * blockBytes;
+            decodeColorBlock(in + (format == BC3 ? 8 : 0), block);
+            if (format == BC3) {
+                decodeAlphaBlock(in, block);
+            }
+            
+            // Write back only the pixels that fall inside the image
+            for (int y = 0; y < 4 && by * 4 + y < height; y++) {
+                int columns = std::min(4, width - bx * 4);
+                memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4) * 4, block + y * 16, columns * 4);
+            }
+        }
+    }
+}
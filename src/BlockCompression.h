@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Plain C++ encoder/decoder for the BC1 (DXT1) and BC3 (DXT5) GPU texture formats.
+// Frames stored this way upload as compressed textures: BC1 is 8 bytes and BC3 is
+// 16 bytes per 4x4 block, against 64 bytes of raw RGBA. No openFrameworks or GL
+// dependency, so round trips can be checked and benchmarked headless.
+class BlockCompression {
+public:
+	enum Format {
+		BC1,  // opaque RGB, 4 bpp
+		BC3   // RGB plus interpolated alpha, 8 bpp
+	};
+	
+	// Bytes needed for a width x height image; edges are padded to whole blocks
+	static size_t getCompressedSize(int width, int height, Format format);
+	
+	// True if any pixel of an RGBA image is not fully opaque (i.e. BC3 is needed)
+	static bool hasAlpha(const uint8_t* rgba, int width, int height);
+	
+	// rgba is tightly packed 8-bit RGBA; blocks must hold getCompressedSize() bytes
+	static void encode(const uint8_t* rgba, int width, int height, Format format, uint8_t* blocks);
+	static void decode(const uint8_t* blocks, int width, int height, Format format, uint8_t* rgba);
+};
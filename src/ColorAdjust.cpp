@@ -0,0 +1,122 @@
+#include "ColorAdjust.h"
+#include "PixelConvert.h"
+
+namespace {
+    // Rec. 709 luma, the weights sRGB material is mastered with
+    const float LUMA[3] = {0.2126f, 0.7152f, 0.0722f};
+
+    // GLSL 150 to match the 3.2 core context from main.cpp; the attribute and uniform
+    // names are the ones openFrameworks' programmable renderer fills in
+    const char* VERTEX_SHADER = R"(#version 150
+uniform mat4 modelViewProjectionMatrix;
+uniform mat4 textureMatrix;
+in vec4 position;
+in vec2 texcoord;
+out vec2 texCoordVarying;
+void main() {
+    texCoordVarying = (textureMatrix * vec4(texcoord, 0.0, 1.0)).xy;
+    gl_Position = modelViewProjectionMatrix * position;
+}
+)";
+
+    // SAMPLER is replaced with the sampler type of the texture target
+    const char* FRAGMENT_SHADER = R"(#version 150
+uniform SAMPLER tex0;
+uniform mat3 colorMatrix;
+uniform vec3 colorOffset;
+in vec2 texCoordVarying;
+out vec4 outputColor;
+void main() {
+    vec4 color = texture(tex0, texCoordVarying);
+    outputColor = vec4(clamp(colorMatrix * color.rgb + colorOffset, 0.0, 1.0), color.a);
+}
+)";
+
+    bool compile(ofShader& shader, const string& sampler) {
+        string fragment = FRAGMENT_SHADER;
+        fragment.replace(fragment.find("SAMPLER"), 7, sampler);
+        return shader.setupShaderFromSource(GL_VERTEX_SHADER, VERTEX_SHADER) &&
+               shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragment) &&
+               shader.bindDefaults() &&
+               shader.linkProgram();
+    }
+}
+
+//--------------------------------------------------------------
+bool ColorAdjust::Settings::isIdentity() const {
+    return brightness == 0 && contrast == 1 && saturation == 1;
+}
+
+//--------------------------------------------------------------
+void ColorAdjust::getMatrix(const Settings& settings, float matrix[12]){
+    // c' = mix(luma(c2), c2, saturation) with c2 = (c + brightness - 0.5) * contrast + 0.5.
+    // Luma weights sum to one, so the grey offset passes through the saturation mix unchanged.
+    float k = settings.contrast;
+    float s = settings.saturation;
+    float offset = (k * (settings.brightness - 0.5f) + 0.5f) * 255;
+    for (int c = 0; c < 3; c++) {
+        for (int j = 0; j < 3; j++) {
+            matrix[c * 4 + j] = k * ((c == j ? s : 0) + (1 - s) * LUMA[j]);
+        }
+        matrix[c * 4 + 3] = offset;
+    }
+}
+
+//--------------------------------------------------------------
+bool ColorAdjust::apply(ofPixels& pixels, const Settings& settings){
+    int channels = pixels.getNumChannels();
+    if (channels != 1 && channels != 3 && channels != 4) {
+        return false;
+    }
+    if (settings.isIdentity()) {
+        return true;
+    }
+    float matrix[12];
+    getMatrix(settings, matrix);
+    size_t count = (size_t)pixels.getWidth() * pixels.getHeight();
+
+    if (channels == 1) {
+        // r = g = b, so each row reduces to its weight sum; a table covers all 256 values
+        float gain = matrix[0] + matrix[1] + matrix[2];
+        uint8_t table[256];
+        for (int v = 0; v < 256; v++) {
+            table[v] = (uint8_t)ofClamp(std::round(gain * v + matrix[3]), 0, 255);
+        }
+        unsigned char* data = pixels.getData();
+        for (size_t i = 0; i < count; i++) {
+            data[i] = table[data[i]];
+        }
+        return true;
+    }
+    PixelConvert::colorMatrix(pixels.getData(), channels, count, matrix);
+    return true;
+}
+
+//--------------------------------------------------------------
+bool ColorAdjust::setup(){
+    bool loaded = compile(rectangleShader, "sampler2DRect") && compile(shader2D, "sampler2D");
+    if (!loaded) {
+        ofLogError("ColorAdjust") << "Could not compile the colour shaders, adjustments are disabled";
+    }
+    return loaded;
+}
+
+//--------------------------------------------------------------
+void ColorAdjust::draw(const ofTexture& texture, float x, float y, float width, float height, const Settings& settings) const {
+    const ofShader& shader = texture.getTextureData().textureTarget == GL_TEXTURE_RECTANGLE_ARB ? rectangleShader : shader2D;
+    if (settings.isIdentity() || !shader.isLoaded()) {
+        texture.draw(x, y, width, height);
+        return;
+    }
+
+    float matrix[12];
+    getMatrix(settings, matrix);
+    shader.begin();
+    // glm::mat3 takes columns; the shader works in 0-1 units
+    shader.setUniformMatrix3f("colorMatrix", glm::mat3(matrix[0], matrix[4], matrix[8],
+                                                       matrix[1], matrix[5], matrix[9],
+                                                       matrix[2], matrix[6], matrix[10]));
+    shader.setUniform3f("colorOffset", matrix[3] / 255, matrix[7] / 255, matrix[11] / 255);
+    texture.draw(x, y, width, height);
+    shader.end();
+}
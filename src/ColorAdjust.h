@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Brightness, contrast and saturation for the output. On the GPU it is a shader bound
+// while a frame texture is drawn into OutputGraph's chain, so it costs no CPU
+// time; apply() is the same transform on the CPU for frames that never reach the GPU,
+// and the reference the shader's output is checked against.
+//
+// Both sides go through one 3x4 colour matrix: brightness is added, contrast scales
+// around mid grey and saturation mixes towards Rec. 709 luma. The CPU path uses
+// PixelConvert's fixed-point kernels and lands within one level of the shader.
+class ColorAdjust {
+public:
+	struct Settings {
+		float brightness = 0;  // -1 to 1, added to every channel
+		float contrast = 1;    // 0 to 2, around mid grey
+		float saturation = 1;  // 0 (grey) to 2
+
+		bool isIdentity() const;
+	};
+
+	// Row-major 3x4, applied to (r, g, b, 1) with samples and offsets in 0-255 units
+	static void getMatrix(const Settings& settings, float matrix[12]);
+
+	// In place on 8-bit RGB or RGBA pixels (alpha untouched); grey pixels only get
+	// brightness and contrast. Returns false for other formats.
+	static bool apply(ofPixels& pixels, const Settings& settings);
+
+	// Compiles the shaders; needs the GL context
+	bool setup();
+
+	// Draws texture with settings applied. Identity settings, or shaders that failed
+	// to compile, draw it plainly.
+	void draw(const ofTexture& texture, float x, float y, float width, float height, const Settings& settings) const;
+
+private:
+	ofShader rectangleShader;  // for ARB rectangle textures, which the uploader makes by default
+	ofShader shader2D;         // for GL_TEXTURE_2D, which compressed pack frames use
+};
@@ -0,0 +1,94 @@
+#include "DecodePool.h"
+#include "FramePrefetcher.h"
+
+//--------------------------------------------------------------
+DecodePool::~DecodePool(){
+    close();
+}
+
+//--------------------------------------------------------------
+void DecodePool::setup(int numThreads){
+    close();
+    if (numThreads <= 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    running = true;
+    for (int i = 0; i < numThreads; i++) {
+        workers.emplace_back(&DecodePool::decodeLoop, this);
+    }
+}
+
+//--------------------------------------------------------------
+void DecodePool::close(){
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+        condition.notify_all();
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+//--------------------------------------------------------------
+int DecodePool::getNumClients(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return clients.size();
+}
+
+//--------------------------------------------------------------
+void DecodePool::attach(FramePrefetcher* client){
+    clients.push_back(client);
+}
+
+//--------------------------------------------------------------
+void DecodePool::detach(FramePrefetcher* client, std::unique_lock<std::mutex>& lock){
+    clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+    nextClient = 0;
+    // A worker holding one of its frames still writes the result back into it
+    finished.wait(lock, [&]() { return client->decoding.empty(); });
+}
+
+//--------------------------------------------------------------
+FramePrefetcher* DecodePool::chooseClient(){
+    FramePrefetcher* chosen = nullptr;
+    size_t chosenPosition = 0;
+    for (size_t i = 0; i < clients.size(); i++) {
+        size_t position = (nextClient + i) % clients.size();
+        FramePrefetcher* candidate = clients[position];
+        if (candidate->hasJobs() && (!chosen || candidate->decoding.size() < chosen->decoding.size())) {
+            chosen = candidate;
+            chosenPosition = position;
+        }
+    }
+    if (chosen) {
+        nextClient = (chosenPosition + 1) % clients.size();
+    }
+    return chosen;
+}
+
+//--------------------------------------------------------------
+void DecodePool::decodeLoop(){
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (running) {
+        FramePrefetcher* client = chooseClient();
+        FramePrefetcher::Job job;
+        if (!client || !client->takeJob(job)) {
+            condition.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        shared_ptr<const ofPixels> pixels = client->decode(job);
+        lock.lock();
+
+        client->finishJob(job, pixels);
+        if (client->decoding.empty()) {
+            finished.notify_all();
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ofMain.h"
+#include <condition_variable>
+
+class FramePrefetcher;
+
+// Decode threads shared by every FramePrefetcher attached to them, so several
+// sequences playing at once use one thread per core between them instead of one
+// per core each, and don't fight over the disk with more reads in flight than
+// there are threads.
+//
+// Players with frames to decode take turns: an idle worker goes to the one with
+// the fewest decodes in flight, ties broken round-robin, and then takes that
+// player's nearest missing frame. A player with a long backlog can't hold every
+// worker while another one's next frame waits, and one that is idle leaves its
+// share to the rest.
+//
+// The pool must outlive the prefetchers attached to it.
+class DecodePool {
+public:
+	~DecodePool();
+	
+	// numThreads 0 uses one decode thread per core
+	void setup(int numThreads = 0);
+	void close();
+	
+	int getNumThreads() const { return workers.size(); }
+	int getNumClients();
+	
+private:
+	friend class FramePrefetcher;
+	
+	void attach(FramePrefetcher* client);
+	// Waits for the client's decodes in flight; called with the mutex held
+	void detach(FramePrefetcher* client, std::unique_lock<std::mutex>& lock);
+	FramePrefetcher* chooseClient();
+	void decodeLoop();
+	
+	vector<std::thread> workers;
+	vector<FramePrefetcher*> clients;
+	size_t nextClient = 0;  // first in line when clients tie
+	bool running = false;
+	
+	// Also guards the state of every attached client, so choosing between them is one lock
+	std::mutex mutex;
+	std::condition_variable condition;  // work was queued
+	std::condition_variable finished;   // a client's last decode in flight finished
+};
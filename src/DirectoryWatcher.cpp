@@ -0,0 +1,407 @@
+#include "DirectoryWatcher.h"
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef TARGET_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+namespace {
+    // Rewrite the saved index at most this often while files keep arriving
+    const float INDEX_WRITE_INTERVAL = 10.0f;
+    
+    // Let a burst of events (a copy of a whole folder, a camera writing) settle
+    // into one snapshot instead of publishing per file
+    const int COALESCE_MILLIS = 50;
+    
+    // How often files that may still be being written are checked again
+    const int SETTLE_MILLIS = 10;
+    
+    // Polling interval in live tail mode, where there are no file system events
+    const float LIVE_TAIL_POLL_INTERVAL = 0.05f;
+}
+
+//--------------------------------------------------------------
+DirectoryWatcher::~DirectoryWatcher(){
+    close();
+}
+
+//--------------------------------------------------------------
+void DirectoryWatcher::watch(const string& dir, float interval){
+    close();
+    directory = ofFilePath::removeTrailingSlash(dir);
+    pollInterval = interval;
+    files.clear();
+    settling.clear();
+    lastScanTime = 0;
+    indexDirty = false;
+    replacedCount = 0;
+    std::atomic_store(&frameList, shared_ptr<const FrameList>());
+    startThread();
+}
+
+//--------------------------------------------------------------
+void DirectoryWatcher::close(){
+    if (isThreadRunning()) {
+        stopThread();
+        eventCondition.notify_all();
+    }
+    waitForThread(false);
+}
+
+//--------------------------------------------------------------
+void DirectoryWatcher::setLiveTail(bool enabled){
+    liveTail = enabled;
+    eventCondition.notify_all();
+}
+
+//--------------------------------------------------------------
+shared_ptr<const FrameList> DirectoryWatcher::getFrameList() const {
+    return std::atomic_load(&frameList);
+}
+
+//--------------------------------------------------------------
+void DirectoryWatcher::publish(const Changes& changes){
+    if (changes.rescan) {
+        // The files scan() keeps may have been rewritten since they were recorded,
+        // while the app was closed or while events were lost; those count as replaced
+        files = FolderScanner::scan(directory, files);
+        vector<string> modified = FolderScanner::findModified(directory, files);
+        FolderScanner::statFiles(directory, modified, files);
+        replacedCount += modified.size();
+        indexDirty = true;
+    } else {
+        for (const string& name : changes.removed) {
+            files.erase(name);
+        }
+        vector<string> changed(changes.added.begin(), changes.added.end());
+        changed.insert(changed.end(), changes.modified.begin(), changes.modified.end());
+        FolderScanner::statFiles(directory, changed, files);
+        indexDirty |= !changes.empty();
+    }
+    replacedCount += changes.modified.size();
+    
+    vector<string> names = FolderScanner::getSortedNames(files);
+    
+    // A rescan that found what the index already said needs no new snapshot
+    shared_ptr<const FrameList> previous = std::atomic_load(&frameList);
+    if (previous && previous->getReplacedCount() == replacedCount && previous->size() == names.size()) {
+        bool same = true;
+        for (size_t i = 0; i < names.size() && same; i++) {
+            same = previous->getName(i) == names[i];
+        }
+        if (same) {
+            return;
+        }
+    }
+    
+    std::atomic_store(&frameList, shared_ptr<const FrameList>(make_shared<FrameList>(directory, std::move(names), replacedCount)));
+}
+
+//--------------------------------------------------------------
+void DirectoryWatcher::writeIndex(){
+    FolderScanner::writeIndex(directory, files);
+    indexDirty = false;
+    lastIndexWrite = ofGetElapsedTimef();
+}
+
+//--------------------------------------------------------------
+bool DirectoryWatcher::startBackend(){
+#ifdef TARGET_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        return false;
+    }
+    // Files count as added once they are closed after writing or moved in, so
+    // half-written frames are not picked up
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF;
+    if (inotify_add_watch(inotifyFd, directory.c_str(), mask) < 0) {
+        ::close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+    return true;
+#elif defined(TARGET_OSX)
+    char resolved[PATH_MAX];
+    eventDirectory = ofFilePath::addTrailingSlash(realpath(directory.c_str(), resolved) ? resolved : directory);
+    
+    FSEventStreamContext context = {0, this, nullptr, nullptr, nullptr};
+    CFStringRef path = CFStringCreateWithCString(nullptr, directory.c_str(), kCFStringEncodingUTF8);
+    CFArrayRef paths = CFArrayCreate(nullptr, (const void**)&path, 1, &kCFTypeArrayCallBacks);
+    eventStream = FSEventStreamCreate(nullptr, &DirectoryWatcher::onFileSystemEvent, &context, paths,
+                                      kFSEventStreamEventIdSinceNow, COALESCE_MILLIS / 1000.0,
+                                      kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagNoDefer);
+    CFRelease(paths);
+    CFRelease(path);
+    if (!eventStream) {
+        return false;
+    }
+    eventQueue = dispatch_queue_create("SequenceStreamer.DirectoryWatcher", DISPATCH_QUEUE_SERIAL);
+    FSEventStreamSetDispatchQueue(eventStream, eventQueue);
+    if (!FSEventStreamStart(eventStream)) {
+        stopBackend();
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+//--------------------------------------------------------------
+void DirectoryWatcher::stopBackend(){
+#ifdef TARGET_LINUX
+    if (inotifyFd >= 0) {
+        ::close(inotifyFd);
+        inotifyFd = -1;
+    }
+#elif defined(TARGET_OSX)
+    if (eventStream) {
+        FSEventStreamStop(eventStream);
+        FSEventStreamInvalidate(eventStream);
+        FSEventStreamRelease(eventStream);
+        eventStream = nullptr;
+    }
+    if (eventQueue) {
+        dispatch_release(eventQueue);
+        eventQueue = nullptr;
+    }
+#endif
+}
+
+#ifdef TARGET_OSX
+//--------------------------------------------------------------
+void DirectoryWatcher::onFileSystemEvent(ConstFSEventStreamRef stream, void* info, size_t count, void* paths,
+                                         const FSEventStreamEventFlags flags[], const FSEventStreamEventId ids[]){
+    DirectoryWatcher* watcher = (DirectoryWatcher*)info;
+    char** eventPaths = (char**)paths;
+    
+    std::unique_lock<std::mutex> lock(watcher->eventMutex);
+    for (size_t i = 0; i < count; i++) {
+        if (flags[i] & (kFSEventStreamEventFlagMustScanSubDirs | kFSEventStreamEventFlagRootChanged)) {
+            watcher->pendingChanges.rescan = true;
+            continue;
+        }
+        string path = eventPaths[i];
+        if (ofFilePath::getEnclosingDirectory(path, false) != watcher->eventDirectory) {
+            continue;  // something in a subfolder
+        }
+        string name = ofFilePath::getFileName(path);
+        if (!FrameList::isImageFile(name)) {
+            continue;
+        }
+        
+        // FSEvents merges flags per path, so check what is on disk now
+        struct stat fileInfo;
+        bool exists = stat(path.c_str(), &fileInfo) == 0;
+        if (!exists) {
+            watcher->pendingChanges.removed.insert(name);
+            watcher->pendingChanges.added.erase(name);
+        } else if (flags[i] & (kFSEventStreamEventFlagItemCreated | kFSEventStreamEventFlagItemRenamed)) {
+            watcher->pendingChanges.added.insert(name);
+            watcher->pendingChanges.removed.erase(name);
+        }
+        if (exists && (flags[i] & kFSEventStreamEventFlagItemModified)) {
+            watcher->pendingChanges.modified.insert(name);
+        }
+    }
+    watcher->eventCondition.notify_all();
+}
+#endif
+
+//--------------------------------------------------------------
+void DirectoryWatcher::waitForChanges(Changes& changes){
+#ifdef TARGET_LINUX
+    if (inotifyFd >= 0) {
+        // Wake up regularly so stopThread() is noticed
+        struct pollfd descriptor = {inotifyFd, POLLIN, 0};
+        if (poll(&descriptor, 1, 100) <= 0) {
+            return;
+        }
+        
+        alignas(struct inotify_event) char buffer[16384];
+        for (int pass = 0; ; pass++) {
+            ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                if ((pass > 0 && changes.empty()) || liveTail) {
+                    return;
+                }
+                // Give the rest of a burst a moment to arrive
+                if (poll(&descriptor, 1, COALESCE_MILLIS) <= 0) {
+                    return;
+                }
+                continue;
+            }
+            for (char* p = buffer; p < buffer + length;) {
+                struct inotify_event* event = (struct inotify_event*)p;
+                p += sizeof(struct inotify_event) + event->len;
+                
+                if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    changes.rescan = true;
+                    continue;
+                }
+                if (event->len == 0 || (event->mask & IN_ISDIR)) {
+                    continue;
+                }
+                string name = event->name;
+                if (!FrameList::isImageFile(name)) {
+                    continue;
+                }
+                
+                if (event->mask & (IN_MOVED_FROM | IN_DELETE)) {
+                    changes.removed.insert(name);
+                    changes.added.erase(name);
+                } else if (event->mask & IN_MOVED_TO) {
+                    changes.added.insert(name);
+                    changes.removed.erase(name);
+                } else if (event->mask & IN_CLOSE_WRITE) {
+                    // Rewriting a file we already list means it was replaced
+                    if (files.count(name) && !changes.added.count(name)) {
+                        changes.modified.insert(name);
+                    } else {
+                        changes.added.insert(name);
+                    }
+                }
+            }
+        }
+    }
+#endif
+    
+#ifdef TARGET_OSX
+    if (eventStream) {
+        std::unique_lock<std::mutex> lock(eventMutex);
+        eventCondition.wait_for(lock, std::chrono::milliseconds(getWaitMillis(100)));
+        changes = std::move(pendingChanges);
+        pendingChanges = Changes();
+        lock.unlock();
+        // Drop adds for names we already list; their content changes arrive as modified
+        for (auto it = changes.added.begin(); it != changes.added.end();) {
+            it = files.count(*it) ? changes.added.erase(it) : std::next(it);
+        }
+        settleChanges(changes);
+        return;
+    }
+#endif
+    
+    // Polling fallback: rescan and compare mtime and size
+    float interval = liveTail ? std::min(pollInterval, LIVE_TAIL_POLL_INTERVAL) : pollInterval;
+    std::unique_lock<std::mutex> lock(eventMutex);
+    eventCondition.wait_for(lock, std::chrono::milliseconds(getWaitMillis(interval * 1000)));
+    lock.unlock();
+    if (!isThreadRunning()) {
+        return;
+    }
+    // Woken early only to check on files that are settling
+    float now = ofGetElapsedTimef();
+    if (now - lastScanTime < interval) {
+        settleChanges(changes);
+        return;
+    }
+    lastScanTime = now;
+    
+    FolderScanner::FileMap current;
+    FolderScanner::statFiles(directory, FolderScanner::listImageFiles(directory), current);
+    for (const auto& file : current) {
+        auto previous = files.find(file.first);
+        if (previous == files.end()) {
+            changes.added.insert(file.first);
+        } else if (previous->second.mtime != file.second.mtime || previous->second.size != file.second.size) {
+            changes.modified.insert(file.first);
+        }
+    }
+    for (const auto& file : files) {
+        if (!current.count(file.first)) {
+            changes.removed.insert(file.first);
+        }
+    }
+    settleChanges(changes);
+}
+
+//--------------------------------------------------------------
+void DirectoryWatcher::settleChanges(Changes& changes){
+    // Keeps a recorded size for files seen again while settling, so polling that
+    // reports them every time doesn't restart the wait
+    for (std::set<string>* names : {&changes.added, &changes.modified}) {
+        for (const string& name : *names) {
+            settling.emplace(name, -1);
+        }
+        names->clear();
+    }
+    for (const string& name : changes.removed) {
+        settling.erase(name);
+    }
+    
+    for (auto it = settling.begin(); it != settling.end();) {
+        string path = directory + "/" + it->first;
+        struct stat fileInfo;
+        if (stat(path.c_str(), &fileInfo) != 0) {
+            it = settling.erase(it);
+            continue;
+        }
+        // Finished: the same size as last time, and a whole image by its trailer
+        if (fileInfo.st_size > 0 && fileInfo.st_size == it->second && FolderScanner::hasImageEnd(path)) {
+            if (files.count(it->first)) {
+                changes.modified.insert(it->first);
+            } else {
+                changes.added.insert(it->first);
+            }
+            it = settling.erase(it);
+        } else {
+            it->second = fileInfo.st_size;
+            ++it;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+int DirectoryWatcher::getWaitMillis(int millis) const {
+    // Files that are settling get checked again soon
+    return settling.empty() ? millis : std::min(millis, SETTLE_MILLIS);
+}
+
+//--------------------------------------------------------------
+void DirectoryWatcher::threadedFunction(){
+    // Start listening before the first scan so nothing written in between is missed
+    bool eventDriven = startBackend();
+    if (!eventDriven) {
+        ofLogNotice("DirectoryWatcher") << "No file system events for " << directory << ", polling every " << pollInterval << "s";
+    }
+    
+    // Show what the index remembers right away, then catch up with the folder;
+    // only files the index doesn't know or that changed since get a header read
+    if (FolderScanner::readIndex(directory, files)) {
+        publish(Changes());
+        ofLogNotice("DirectoryWatcher") << "Loaded index for " << directory << ": " << files.size() << " images";
+    }
+    
+    Changes initial;
+    initial.rescan = true;
+    publish(initial);
+    shared_ptr<const FrameList> list = getFrameList();
+    ofLogNotice("DirectoryWatcher") << "Watching " << directory << ": " << files.size() << " images in "
+                                    << (list ? list->getNumRuns() : 0) << " runs, "
+                                    << (list ? list->getMemoryUsage() / 1024 : 0) << " KB";
+    
+    while (isThreadRunning()) {
+        Changes changes;
+        waitForChanges(changes);
+        if (!changes.empty()) {
+            ofLogVerbose("DirectoryWatcher") << directory << ": +" << changes.added.size() << " -" << changes.removed.size()
+                                             << " ~" << changes.modified.size() << (changes.rescan ? " (rescan)" : "");
+            publish(changes);
+        }
+        // Keep the index close to the folder without rewriting it for every file
+        if (indexDirty && ofGetElapsedTimef() - lastIndexWrite > INDEX_WRITE_INTERVAL) {
+            writeIndex();
+        }
+    }
+    
+    stopBackend();
+    if (indexDirty) {
+        writeIndex();
+    }
+}
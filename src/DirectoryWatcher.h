@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ofMain.h"
+#include "FrameList.h"
+#include "FolderScanner.h"
+#include <condition_variable>
+#include <set>
+
+#ifdef TARGET_OSX
+#include <CoreServices/CoreServices.h>
+#endif
+
+// Watches a sequence folder on a worker thread and publishes a new FrameList
+// whenever image files are added, removed, renamed or rewritten.
+//
+// The folder's saved index is published first, then the folder itself is scanned.
+// Changes come from inotify on Linux and FSEvents on macOS; anywhere else the
+// worker falls back to rescanning every pollInterval and comparing mtime/size.
+// Deltas are applied to the worker's own sorted name list and published as an
+// immutable snapshot with an atomic pointer swap, so the render thread never
+// blocks on the file system: it just compares getFrameList() with what it has.
+//
+// inotify reports a file once the writer closes it. FSEvents and polling see files
+// while they are still being written, so those are held back until their size
+// stops changing and they end like a finished image (see FolderScanner::hasImageEnd).
+class DirectoryWatcher : public ofThread {
+public:
+	~DirectoryWatcher();
+	
+	void watch(const string& directory, float pollInterval = 2.0f);
+	void close();
+	
+	// For a folder a camera is writing into: publish every finished file as soon as
+	// it is seen instead of letting a burst of them settle first, and poll often
+	void setLiveTail(bool liveTail);
+	
+	// Latest snapshot; nullptr until the first scan of a new folder finishes
+	shared_ptr<const FrameList> getFrameList() const;
+	
+protected:
+	void threadedFunction() override;
+	
+private:
+	struct Changes {
+		std::set<string> added;
+		std::set<string> removed;
+		std::set<string> modified;
+		bool rescan = false;  // the event queue overflowed or the folder moved
+		bool empty() const { return added.empty() && removed.empty() && modified.empty() && !rescan; }
+	};
+	
+	void publish(const Changes& changes);
+	void writeIndex();
+	void waitForChanges(Changes& changes);
+	// Moves added and modified files into settling; moves those that finished back
+	void settleChanges(Changes& changes);
+	int getWaitMillis(int millis) const;
+	bool startBackend();
+	void stopBackend();
+	
+	string directory;
+	float pollInterval = 2.0f;
+	FolderScanner::FileMap files;  // worker-owned view of the folder
+	bool indexDirty = false;       // files changed since the index was last written
+	float lastIndexWrite = 0;
+	uint64_t replacedCount = 0;
+	shared_ptr<const FrameList> frameList;
+	std::map<string, int64_t> settling;  // files that may still be being written, by name: size when last checked
+	std::atomic<bool> liveTail{false};
+	float lastScanTime = 0;  // Of the polling fallback
+	
+	// Backend state
+	int inotifyFd = -1;
+#ifdef TARGET_OSX
+	FSEventStreamRef eventStream = nullptr;
+	string eventDirectory;  // directory with symlinks resolved, as FSEvents reports paths
+	dispatch_queue_t eventQueue = nullptr;
+	static void onFileSystemEvent(ConstFSEventStreamRef stream, void* info, size_t count, void* paths,
+	                              const FSEventStreamEventFlags flags[], const FSEventStreamEventId ids[]);
+#endif
+	std::mutex eventMutex;  // guards pendingChanges, filled by the FSEvents queue
+	Changes pendingChanges;
+	std::condition_variable eventCondition;
+};
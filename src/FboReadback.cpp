@@ -0,0 +1,96 @@
+#include "FboReadback.h"
+
+//--------------------------------------------------------------
+FboReadback::~FboReadback(){
+    clear();
+}
+
+//--------------------------------------------------------------
+void FboReadback::setup(int numBuffers){
+    clear();
+    buffers.resize(std::max(1, numBuffers));
+}
+
+//--------------------------------------------------------------
+void FboReadback::clear(){
+    unmap();
+    for (Buffer& buffer : buffers) {
+        deleteFence(buffer);
+    }
+    buffers.clear();
+    pending.clear();
+    next = 0;
+}
+
+//--------------------------------------------------------------
+bool FboReadback::begin(const ofFbo& fbo, uint64_t timestampMicros){
+    if (buffers.empty() || isFull() || next == mapped || !fbo.isAllocated()) {
+        return false;
+    }
+
+    Buffer& buffer = buffers[next];
+    int index = next;
+    next = (next + 1) % buffers.size();
+    buffer.width = fbo.getWidth();
+    buffer.height = fbo.getHeight();
+    buffer.timestampMicros = timestampMicros;
+    // Reallocating orphans storage an earlier readback may still be using
+    buffer.buffer.allocate((size_t)buffer.width * buffer.height * 4, GL_STREAM_READ);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo.getId());
+    buffer.buffer.bind(GL_PIXEL_PACK_BUFFER);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, buffer.width, buffer.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    buffer.buffer.unbind(GL_PIXEL_PACK_BUFFER);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Submit now so the copy runs while the rest of the frame is being built
+    glFlush();
+    pending.push_back(index);
+    return true;
+}
+
+//--------------------------------------------------------------
+bool FboReadback::map(Frame& frame, bool wait){
+    if (pending.empty() || mapped >= 0) {
+        return false;
+    }
+    Buffer& buffer = buffers[pending.front()];
+    GLenum result;
+    do {
+        result = glClientWaitSync(buffer.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+    } while (wait && result == GL_TIMEOUT_EXPIRED);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    deleteFence(buffer);
+
+    mapped = pending.front();
+    pending.pop_front();
+    frame.pixels = (const unsigned char*)buffer.buffer.mapRange(0, (size_t)buffer.width * buffer.height * 4, GL_MAP_READ_BIT);
+    if (!frame.pixels) {
+        mapped = -1;
+        return false;
+    }
+    frame.width = buffer.width;
+    frame.height = buffer.height;
+    frame.timestampMicros = buffer.timestampMicros;
+    return true;
+}
+
+//--------------------------------------------------------------
+void FboReadback::unmap(){
+    if (mapped >= 0) {
+        buffers[mapped].buffer.unmap();
+        mapped = -1;
+    }
+}
+
+//--------------------------------------------------------------
+void FboReadback::deleteFence(Buffer& buffer){
+    if (buffer.fence) {
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ofMain.h"
+#include <deque>
+
+// Reads FBOs back to the CPU without stalling the render thread: begin() queues a
+// glReadPixels into a pixel buffer and fences it, and map() hands out the oldest
+// readback once its fence has signalled, usually a frame later. Pixels are 8-bit RGBA,
+// rows top to bottom the way openFrameworks renders into FBOs.
+// Must be used from the thread that owns the GL context.
+class FboReadback {
+public:
+	struct Frame {
+		const unsigned char* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+		uint64_t timestampMicros = 0;  // As given to begin()
+	};
+
+	~FboReadback();
+
+	// numBuffers readbacks can be in flight at once
+	void setup(int numBuffers = 2);
+	void clear();
+
+	// Starts reading fbo back. Returns false when all buffers are in flight; map() the oldest first.
+	bool begin(const ofFbo& fbo, uint64_t timestampMicros);
+	bool isFull() const { return pending.size() == buffers.size(); }
+
+	// Maps the oldest readback if it's complete, or once it is when wait is set.
+	// The pixels stay valid until unmap(), which must come before the next map().
+	bool map(Frame& frame, bool wait = false);
+	void unmap();
+
+private:
+	struct Buffer {
+		ofBufferObject buffer;
+		GLsync fence = nullptr;
+		int width = 0;
+		int height = 0;
+		uint64_t timestampMicros = 0;
+	};
+
+	static void deleteFence(Buffer& buffer);
+
+	vector<Buffer> buffers;
+	std::deque<int> pending;  // In flight, oldest first
+	int next = 0;
+	int mapped = -1;
+};
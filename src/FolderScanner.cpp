@@ -0,0 +1,419 @@
+#include "FolderScanner.h"
+#include "FrameList.h"
+#include <atomic>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef TARGET_LINUX
+#include <sys/syscall.h>
+#endif
+
+namespace {
+    const char INDEX_MAGIC[8] = {'S', 'S', 'I', 'N', 'D', 'E', 'X', 0};
+    const uint32_t INDEX_VERSION = 1;
+    const int MAX_STAT_THREADS = 8;
+    const size_t FILES_PER_STAT_THREAD = 256;  // below this, extra threads cost more than they save
+
+    uint16_t readBigEndian16(const unsigned char* p) { return (p[0] << 8) | p[1]; }
+    uint32_t readBigEndian32(const unsigned char* p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+    bool readJpegSize(FILE* file, uint32_t& width, uint32_t& height) {
+        // Walk the markers up to the first start-of-frame; EXIF thumbnails
+        // are skipped over by their segment length rather than read
+        unsigned char bytes[7];
+        while (true) {
+            int c = fgetc(file);
+            if (c == EOF) {
+                return false;
+            }
+            if (c != 0xFF) {
+                continue;
+            }
+            int marker;
+            do {
+                marker = fgetc(file);
+            } while (marker == 0xFF);
+            if (marker == EOF || marker == 0xD9 || marker == 0xDA) {
+                return false;
+            }
+            if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {
+                continue;  // no payload
+            }
+            if (fread(bytes, 1, 2, file) != 2) {
+                return false;
+            }
+            uint16_t length = readBigEndian16(bytes);
+            bool startOfFrame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+            if (startOfFrame) {
+                if (fread(bytes, 1, 5, file) != 5) {
+                    return false;
+                }
+                height = readBigEndian16(bytes + 1);
+                width = readBigEndian16(bytes + 3);
+                return width > 0 && height > 0;
+            }
+            if (length < 2 || fseek(file, length - 2, SEEK_CUR) != 0) {
+                return false;
+            }
+        }
+    }
+
+    bool readTiffSize(FILE* file, bool littleEndian, uint32_t& width, uint32_t& height) {
+        auto read16 = [littleEndian](const unsigned char* p) -> uint32_t {
+            return littleEndian ? (p[0] | (p[1] << 8)) : readBigEndian16(p);
+        };
+        auto read32 = [littleEndian](const unsigned char* p) -> uint32_t {
+            return littleEndian ? (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)) : readBigEndian32(p);
+        };
+
+        unsigned char bytes[12];
+        if (fread(bytes, 1, 4, file) != 4 || fseek(file, read32(bytes), SEEK_SET) != 0 || fread(bytes, 1, 2, file) != 2) {
+            return false;
+        }
+        uint32_t count = read16(bytes);
+        for (uint32_t i = 0; i < count && fread(bytes, 1, 12, file) == 12; i++) {
+            uint32_t tag = read16(bytes);
+            uint32_t type = read16(bytes + 2);
+            uint32_t value = type == 3 ? read16(bytes + 8) : read32(bytes + 8);  // SHORT or LONG
+            if (tag == 256) {
+                width = value;
+            } else if (tag == 257) {
+                height = value;
+            }
+        }
+        return width > 0 && height > 0;
+    }
+
+    bool statFile(const string& path, FolderScanner::FileInfo& info, bool readSize) {
+        struct stat fileStat;
+        if (stat(path.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+            return false;
+        }
+#ifdef __APPLE__
+        info.mtime = (int64_t)fileStat.st_mtimespec.tv_sec * 1000000000 + fileStat.st_mtimespec.tv_nsec;
+#else
+        info.mtime = (int64_t)fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+#endif
+        info.size = fileStat.st_size;
+        if (readSize) {
+            FolderScanner::readImageSize(path, info.width, info.height);
+        }
+        return true;
+    }
+
+    // Runs work(i) for every i below count, each thread taking the next one; stat and
+    // header reads are mostly waiting on the disk, so this helps even on a single spindle
+    template<typename Work>
+    void runParallel(size_t count, Work work) {
+        std::atomic<size_t> next(0);
+        auto loop = [&](){
+            for (size_t i = next++; i < count; i = next++) {
+                work(i);
+            }
+        };
+
+        int numThreads = std::min<size_t>({(size_t)MAX_STAT_THREADS,
+                                           (size_t)std::max(1u, std::thread::hardware_concurrency()),
+                                           count / FILES_PER_STAT_THREAD + 1});
+        vector<std::thread> threads;
+        for (int i = 1; i < numThreads; i++) {
+            threads.emplace_back(loop);
+        }
+        loop();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+//--------------------------------------------------------------
+vector<string> FolderScanner::listImageFiles(const string& directory){
+    vector<string> names;
+#ifdef TARGET_LINUX
+    // getdents64 hands over a megabyte of entries per call instead of one per readdir()
+    struct LinuxDirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        ofLogWarning("FolderScanner") << "Could not open " << directory;
+        return names;
+    }
+    vector<char> buffer(1 << 20);
+    long length;
+    while ((length = syscall(SYS_getdents64, fd, buffer.data(), buffer.size())) > 0) {
+        for (long offset = 0; offset < length;) {
+            LinuxDirent64* entry = (LinuxDirent64*)(buffer.data() + offset);
+            offset += entry->d_reclen;
+            if (entry->d_type == DT_DIR) {
+                continue;
+            }
+            string name = entry->d_name;
+            if (FrameList::isImageFile(name)) {
+                names.push_back(std::move(name));
+            }
+        }
+    }
+    ::close(fd);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        ofLogWarning("FolderScanner") << "Could not open " << directory;
+        return names;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_type == DT_DIR) {
+            continue;
+        }
+        string name = entry->d_name;
+        if (FrameList::isImageFile(name)) {
+            names.push_back(std::move(name));
+        }
+    }
+    closedir(dir);
+#endif
+    return names;
+}
+
+//--------------------------------------------------------------
+FolderScanner::FileMap FolderScanner::scan(const string& directory, const FileMap& known){
+    vector<string> names = listImageFiles(directory);
+
+    FileMap files;
+    files.reserve(names.size());
+    vector<string> unknown;
+    for (string& name : names) {
+        auto it = known.find(name);
+        if (it != known.end() && it->second.isKnown()) {
+            files.emplace(std::move(name), it->second);
+        } else {
+            unknown.push_back(std::move(name));
+        }
+    }
+    statFiles(directory, unknown, files);
+    return files;
+}
+
+//--------------------------------------------------------------
+void FolderScanner::statFiles(const string& directory, const vector<string>& names, FileMap& files){
+    if (names.empty()) {
+        return;
+    }
+
+    vector<FileInfo> infos(names.size());
+    vector<char> found(names.size(), 0);
+    runParallel(names.size(), [&](size_t i){
+        found[i] = statFile(directory + "/" + names[i], infos[i], true);
+    });
+
+    for (size_t i = 0; i < names.size(); i++) {
+        if (found[i]) {
+            files[names[i]] = infos[i];
+        } else {
+            files.erase(names[i]);  // gone again before we got to it
+        }
+    }
+}
+
+//--------------------------------------------------------------
+vector<string> FolderScanner::findModified(const string& directory, const FileMap& files){
+    vector<const FileMap::value_type*> entries;
+    entries.reserve(files.size());
+    for (const auto& file : files) {
+        entries.push_back(&file);
+    }
+
+    // Only a stat each; headers are read for the files that changed, by statFiles()
+    vector<char> modified(entries.size(), 0);
+    runParallel(entries.size(), [&](size_t i){
+        FileInfo info;
+        modified[i] = statFile(directory + "/" + entries[i]->first, info, false) &&
+                      (info.mtime != entries[i]->second.mtime || info.size != entries[i]->second.size);
+    });
+
+    vector<string> names;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (modified[i]) {
+            names.push_back(entries[i]->first);
+        }
+    }
+    return names;
+}
+
+//--------------------------------------------------------------
+vector<string> FolderScanner::getSortedNames(const FileMap& files){
+    vector<string> names;
+    names.reserve(files.size());
+    for (const auto& file : files) {
+        names.push_back(file.first);
+    }
+    std::sort(names.begin(), names.end(), FrameList::naturalLess);
+    return names;
+}
+
+//--------------------------------------------------------------
+string FolderScanner::getIndexPath(const string& directory){
+    // One index per source directory, named after a hash of its path like the proxy cache
+    std::stringstream name;
+    name << std::hex << std::hash<string>()(directory) << ".ssindex";
+    return ofToDataPath(ofFilePath::join("indexes", name.str()), true);
+}
+
+//--------------------------------------------------------------
+bool FolderScanner::readIndex(const string& directory, FileMap& files){
+    ofBuffer buffer = ofBufferFromFile(getIndexPath(directory), true);
+    const unsigned char* p = (const unsigned char*)buffer.getData();
+    const unsigned char* end = p + buffer.size();
+
+    auto take = [&](void* out, size_t size){
+        if ((size_t)(end - p) < size) {
+            return false;
+        }
+        memcpy(out, p, size);
+        p += size;
+        return true;
+    };
+
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint16_t directoryLength;
+    if (!take(magic, sizeof(magic)) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 ||
+        !take(&version, sizeof(version)) || version != INDEX_VERSION ||
+        !take(&directoryLength, sizeof(directoryLength)) || (size_t)(end - p) < directoryLength) {
+        return false;
+    }
+    // Guard against another folder with the same hash
+    if (string((const char*)p, directoryLength) != directory) {
+        return false;
+    }
+    p += directoryLength;
+    if (!take(&count, sizeof(count))) {
+        return false;
+    }
+
+    files.clear();
+    files.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t nameLength;
+        FileInfo info;
+        if (!take(&nameLength, sizeof(nameLength)) || (size_t)(end - p) < nameLength) {
+            return false;
+        }
+        string name((const char*)p, nameLength);
+        p += nameLength;
+        if (!take(&info.size, sizeof(info.size)) || !take(&info.mtime, sizeof(info.mtime)) ||
+            !take(&info.width, sizeof(info.width)) || !take(&info.height, sizeof(info.height))) {
+            return false;
+        }
+        files.emplace(std::move(name), info);
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+bool FolderScanner::writeIndex(const string& directory, const FileMap& files){
+    string path = getIndexPath(directory);
+    ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(path, false), false, true);
+
+    ofBuffer buffer;
+    auto put = [&](const void* data, size_t size){
+        buffer.append((const char*)data, size);
+    };
+    uint16_t directoryLength = directory.size();
+    uint32_t count = files.size();
+    put(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    put(&INDEX_VERSION, sizeof(INDEX_VERSION));
+    put(&directoryLength, sizeof(directoryLength));
+    put(directory.data(), directoryLength);
+    put(&count, sizeof(count));
+    for (const auto& file : files) {
+        uint16_t nameLength = file.first.size();
+        put(&nameLength, sizeof(nameLength));
+        put(file.first.data(), nameLength);
+        put(&file.second.size, sizeof(file.second.size));
+        put(&file.second.mtime, sizeof(file.second.mtime));
+        put(&file.second.width, sizeof(file.second.width));
+        put(&file.second.height, sizeof(file.second.height));
+    }
+
+    // Write next to the index and rename, so a crash never leaves half an index
+    string tempPath = path + ".tmp";
+    if (!ofBufferToFile(tempPath, buffer, true) || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        ofLogWarning("FolderScanner") << "Could not write index " << path;
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+bool FolderScanner::readImageSize(const string& path, uint32_t& width, uint32_t& height){
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    unsigned char signature[8];
+    bool found = false;
+    width = 0;
+    height = 0;
+    if (fread(signature, 1, sizeof(signature), file) == sizeof(signature)) {
+        if (signature[0] == 0xFF && signature[1] == 0xD8) {
+            fseek(file, 2, SEEK_SET);
+            found = readJpegSize(file, width, height);
+        } else if (memcmp(signature, "\x89PNG\r\n\x1a\n", 8) == 0) {
+            // IHDR is always the first chunk
+            unsigned char header[16];
+            if (fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header + 4, "IHDR", 4) == 0) {
+                width = readBigEndian32(header + 8);
+                height = readBigEndian32(header + 12);
+                found = width > 0 && height > 0;
+            }
+        } else if (memcmp(signature, "II*\0", 4) == 0 || memcmp(signature, "MM\0*", 4) == 0) {
+            fseek(file, 4, SEEK_SET);
+            found = readTiffSize(file, signature[0] == 'I', width, height);
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+//--------------------------------------------------------------
+bool FolderScanner::hasImageEnd(const string& path){
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    unsigned char signature[8];
+    unsigned char tail[32];
+    size_t tailLength = 0;
+    bool complete = false;
+    if (fread(signature, 1, sizeof(signature), file) == sizeof(signature) && fseek(file, 0, SEEK_END) == 0) {
+        long size = ftell(file);
+        tailLength = std::min<long>(sizeof(tail), size);
+        if (fseek(file, size - tailLength, SEEK_SET) != 0 || fread(tail, 1, tailLength, file) != tailLength) {
+            tailLength = 0;
+        }
+        if (signature[0] == 0xFF && signature[1] == 0xD8) {
+            // Some cameras pad the file after the marker
+            size_t end = tailLength;
+            while (end > 0 && (tail[end - 1] == 0x00 || tail[end - 1] == 0xFF)) {
+                end--;
+            }
+            complete = end >= 2 && tail[end - 2] == 0xFF && tail[end - 1] == 0xD9;
+        } else if (memcmp(signature, "\x89PNG\r\n\x1a\n", 8) == 0) {
+            complete = tailLength >= 12 && memcmp(tail + tailLength - 12, "\0\0\0\0IEND\xAE\x42\x60\x82", 12) == 0;
+        } else {
+            complete = tailLength > 0;
+        }
+    }
+    fclose(file);
+    return complete;
+}
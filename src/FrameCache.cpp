@@ -0,0 +1,250 @@
+#include "FrameCache.h"
+#include "FrameStats.h"
+#include "PixelConvert.h"
+#include "ScaledJpegDecoder.h"
+#include <sys/stat.h>
+
+namespace {
+    // Resampling costs more than uploading a frame a little larger than needed
+    // and letting the GPU scale it the rest of the way
+    const double MIN_RESAMPLE_SAVING = 0.25;
+
+    // 16-bit PNGs and TIFFs are decoded at full depth and narrowed by PixelConvert,
+    // which rounds and is vectorized, instead of by the image library's converter
+    bool hasSixteenBitSamples(const ofBuffer& buffer) {
+        const unsigned char* data = (const unsigned char*)buffer.getData();
+        size_t size = buffer.size();
+        if (size > 24 && memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) {
+            return data[24] == 16;  // IHDR bit depth
+        }
+        if (size < 8 || (memcmp(data, "II*\0", 4) != 0 && memcmp(data, "MM\0*", 4) != 0)) {
+            return false;
+        }
+        
+        // TIFF: find BitsPerSample (tag 258) in the first directory
+        bool littleEndian = data[0] == 'I';
+        auto read16 = [&](size_t offset) -> uint32_t {
+            return littleEndian ? data[offset] | (data[offset + 1] << 8) : (data[offset] << 8) | data[offset + 1];
+        };
+        auto read32 = [&](size_t offset) -> uint32_t {
+            return littleEndian ? read16(offset) | (read16(offset + 2) << 16) : (read16(offset) << 16) | read16(offset + 2);
+        };
+        size_t directory = read32(4);
+        if (directory + 2 > size) {
+            return false;
+        }
+        uint32_t numEntries = read16(directory);
+        for (uint32_t i = 0; i < numEntries; i++) {
+            size_t entry = directory + 2 + i * 12;
+            if (entry + 12 > size) {
+                return false;
+            }
+            if (read16(entry) == 258) {
+                // One value per sample; up to two fit in the entry, more are stored elsewhere
+                size_t value = read32(entry + 4) <= 2 ? entry + 8 : read32(entry + 8);
+                return value + 2 <= size && read16(value) == 16;
+            }
+        }
+        return false;
+    }
+}
+
+//--------------------------------------------------------------
+FrameCache::FileStamp FrameCache::getFileStamp(const string& path){
+    FileStamp stamp;
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0) {
+#ifdef __APPLE__
+        stamp.mtime = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+        stamp.mtime = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+        stamp.size = info.st_size;
+    }
+    return stamp;
+}
+
+//--------------------------------------------------------------
+shared_ptr<const ofPixels> FrameCache::load(const string& path){
+    int minWidth, minHeight;
+    bool fit;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        minWidth = decodeWidth;
+        minHeight = decodeHeight;
+        fit = decodeFit;
+    }
+    return load(path, minWidth, minHeight, fit, Resampler::LANCZOS3);
+}
+
+//--------------------------------------------------------------
+shared_ptr<const ofPixels> FrameCache::load(const string& path, int minWidth, int minHeight){
+    return load(path, minWidth, minHeight, false, Resampler::BOX);
+}
+
+//--------------------------------------------------------------
+shared_ptr<const ofPixels> FrameCache::load(const string& path, int minWidth, int minHeight, bool fit, Resampler::Filter filter){
+    FileStamp stamp = getFileStamp(path);
+    
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it != entries.end()) {
+            if (it->second.stamp == stamp && it->second.covers(minWidth, minHeight, fit)) {
+                lru.splice(lru.begin(), lru, it->second.lruPosition);
+                hits++;
+                return it->second.pixels;
+            }
+            // File was replaced on disk since we decoded it, or it is needed larger
+            erase(it);
+        }
+    }
+    
+    // Decode without holding the lock so other threads keep hitting the cache
+    misses++;
+    // Read and decode separately so the stats can tell a slow disk from a slow codec
+    ofBuffer buffer;
+    {
+        FrameStats::Scope timer(FrameStats::FILE_READ);
+        buffer = ofBufferFromFile(path, true);
+    }
+    auto pixels = make_shared<ofPixels>();
+    bool scaled = false;
+    bool resampled = false;
+    {
+        // Resampling counts as decoding: it is part of what a frame costs before it can go out
+        FrameStats::Scope timer(FrameStats::DECODE);
+        if (!decode(buffer, *pixels, minWidth, minHeight, scaled)) {
+            return nullptr;
+        }
+        resampled = resample(*pixels, minWidth, minHeight, fit, filter);
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it != entries.end()) {
+        // Another thread decoded the same file meanwhile; keep the newer stamp
+        erase(it);
+    }
+    
+    Entry& entry = entries[path];
+    entry.pixels = pixels;
+    entry.stamp = stamp;
+    entry.bytes = pixels->getTotalBytes();
+    entry.minWidth = scaled || resampled ? minWidth : 0;
+    entry.minHeight = scaled || resampled ? minHeight : 0;
+    entry.fitted = resampled && fit;
+    lru.push_front(path);
+    entry.lruPosition = lru.begin();
+    bytesUsed += entry.bytes;
+    evictToBudget();
+    
+    return pixels;
+}
+
+//--------------------------------------------------------------
+bool FrameCache::decode(const ofBuffer& buffer, ofPixels& pixels, int minWidth, int minHeight, bool& scaled){
+    if (buffer.size() == 0) {
+        return false;
+    }
+    // JPEGs go through libjpeg-turbo when it is installed, shrunk in the DCT if a
+    // smaller size will do; everything else (and any JPEG it rejects) through FreeImage
+    int scale = ScaledJpegDecoder::decode(buffer, pixels, minWidth, minHeight);
+    if (scale > 0) {
+        scaled = scale > 1;
+        return true;
+    }
+    scaled = false;
+    if (hasSixteenBitSamples(buffer)) {
+        ofShortPixels wide;
+        if (!ofLoadImage(wide, buffer)) {
+            return false;
+        }
+        pixels.allocate(wide.getWidth(), wide.getHeight(), wide.getNumChannels());
+        PixelConvert::narrow(wide.getData(), pixels.getData(), wide.size());
+        return true;
+    }
+    return ofLoadImage(pixels, buffer);
+}
+
+//--------------------------------------------------------------
+bool FrameCache::resample(ofPixels& pixels, int minWidth, int minHeight, bool fit, Resampler::Filter filter){
+    int width = pixels.getWidth();
+    int height = pixels.getHeight();
+    int channels = pixels.getNumChannels();
+    int targetWidth, targetHeight;
+    Resampler::getFitSize(width, height, minWidth, minHeight, fit, targetWidth, targetHeight);
+    if (channels < 1 || channels > 4 || (double)targetWidth * targetHeight > (double)width * height * (1 - MIN_RESAMPLE_SAVING)) {
+        return false;
+    }
+    ofPixels resized;
+    resized.allocate(targetWidth, targetHeight, channels);
+    Resampler::resize(pixels.getData(), width, height, channels, resized.getData(), targetWidth, targetHeight, filter);
+    pixels = std::move(resized);
+    return true;
+}
+
+//--------------------------------------------------------------
+void FrameCache::setDecodeSize(int width, int height, bool fit){
+    std::unique_lock<std::mutex> lock(mutex);
+    decodeWidth = std::max(0, width);
+    decodeHeight = std::max(0, height);
+    decodeFit = fit;
+}
+
+//--------------------------------------------------------------
+void FrameCache::evictToBudget(){
+    // Always keep the frame we just inserted, even if it alone exceeds the budget
+    while (bytesUsed > budget && lru.size() > 1) {
+        erase(entries.find(lru.back()));
+    }
+}
+
+//--------------------------------------------------------------
+void FrameCache::erase(std::unordered_map<string, Entry>::iterator it){
+    bytesUsed -= it->second.bytes;
+    lru.erase(it->second.lruPosition);
+    entries.erase(it);
+}
+
+//--------------------------------------------------------------
+void FrameCache::setBudget(uint64_t bytes){
+    std::unique_lock<std::mutex> lock(mutex);
+    budget = bytes;
+    evictToBudget();
+}
+
+//--------------------------------------------------------------
+void FrameCache::invalidate(const string& path){
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it != entries.end()) {
+        erase(it);
+    }
+}
+
+//--------------------------------------------------------------
+void FrameCache::clear(){
+    std::unique_lock<std::mutex> lock(mutex);
+    entries.clear();
+    lru.clear();
+    bytesUsed = 0;
+}
+
+//--------------------------------------------------------------
+uint64_t FrameCache::getBudget(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return budget;
+}
+
+//--------------------------------------------------------------
+uint64_t FrameCache::getBytesUsed(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return bytesUsed;
+}
+
+//--------------------------------------------------------------
+size_t FrameCache::getNumFrames(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return entries.size();
+}
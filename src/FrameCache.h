@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ofMain.h"
+#include <list>
+#include <unordered_map>
+#include "Resampler.h"
+
+// Decoded-frame cache that sits in front of every image load.
+// Frames are keyed by path and validated against the file's mtime and size,
+// so a replaced file is decoded again. Least recently used frames are evicted
+// once the decoded bytes exceed the RAM budget. Safe to use from any thread.
+class FrameCache {
+public:
+	// Decoded pixels for path, decoding on a miss. Returns nullptr if the file can't be decoded.
+	// JPEGs are decoded only as large as the decode size needs (see ScaledJpegDecoder), and
+	// frames still well over it are resampled down to it with Lanczos-3 (see Resampler), on
+	// the calling thread, so they take less cache memory and upload bandwidth.
+	shared_ptr<const ofPixels> load(const string& path);
+	// Same with an explicit minimum size, resampled with a box filter since these are previews
+	// and reduced quality; 0 leaves that side unconstrained, 0 x 0 is full size
+	shared_ptr<const ofPixels> load(const string& path, int minWidth, int minHeight);
+	
+	// Smallest size frames from load(path) need, e.g. the output size; 0 x 0 for full size.
+	// With fit they only need to fit inside it, as outputs that keep the aspect ratio draw them.
+	void setDecodeSize(int width, int height, bool fit = false);
+	void setBudget(uint64_t bytes);
+	void invalidate(const string& path);
+	void clear();
+	
+	uint64_t getBudget();
+	uint64_t getBytesUsed();
+	uint64_t getHits() const { return hits; }
+	uint64_t getMisses() const { return misses; }
+	size_t getNumFrames();
+	
+private:
+	struct FileStamp {
+		int64_t mtime = 0;  // nanoseconds
+		int64_t size = -1;
+		bool operator==(const FileStamp& other) const { return mtime == other.mtime && size == other.size; }
+	};
+	
+	struct Entry {
+		shared_ptr<const ofPixels> pixels;
+		FileStamp stamp;
+		uint64_t bytes = 0;
+		int minWidth = 0;   // the size it was decoded down towards; 0 x 0 if it is full size
+		int minHeight = 0;
+		bool fitted = false;  // resampled to fit inside minWidth x minHeight rather than cover it
+		std::list<string>::iterator lruPosition;
+		
+		bool covers(int width, int height, bool fit) const {
+			return (minWidth == 0 && minHeight == 0) ||
+			       ((width > 0 || height > 0) && minWidth >= width && minHeight >= height && (fit || !fitted));
+		}
+	};
+	
+	static FileStamp getFileStamp(const string& path);
+	shared_ptr<const ofPixels> load(const string& path, int minWidth, int minHeight, bool fit, Resampler::Filter filter);
+	static bool decode(const ofBuffer& buffer, ofPixels& pixels, int minWidth, int minHeight, bool& scaled);
+	// Shrinks pixels to the size they need if that saves enough to be worth a pass. True if it did.
+	static bool resample(ofPixels& pixels, int minWidth, int minHeight, bool fit, Resampler::Filter filter);
+	void evictToBudget();
+	void erase(std::unordered_map<string, Entry>::iterator it);
+	
+	std::mutex mutex;
+	std::unordered_map<string, Entry> entries;
+	std::list<string> lru;  // front = most recently used
+	uint64_t budget = 2048ull * 1024 * 1024;
+	uint64_t bytesUsed = 0;
+	int decodeWidth = 0;
+	int decodeHeight = 0;
+	bool decodeFit = false;
+	std::atomic<uint64_t> hits{0};
+	std::atomic<uint64_t> misses{0};
+};
@@ -0,0 +1,206 @@
+#include "FrameList.h"
+
+//--------------------------------------------------------------
+FrameList::FrameList(const string& dir, const vector<string>& names, uint64_t replaced)
+: directory(ofFilePath::removeTrailingSlash(dir))
+, replacedCount(replaced){
+    for (const string& name : names) {
+        appendName(name);
+    }
+    
+    buckets.resize((numFrames >> BUCKET_SHIFT) + 1);
+    uint32_t run = 0;
+    for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+        size_t index = bucket << BUCKET_SHIFT;
+        while (run + 1 < runs.size() && runs[run].start + runs[run].count <= index) {
+            run++;
+        }
+        buckets[bucket] = run;
+    }
+}
+
+//--------------------------------------------------------------
+uint32_t FrameList::addToArena(const char* text, size_t length){
+    uint32_t offset = arena.size();
+    arena.append(text, length);
+    return offset;
+}
+
+//--------------------------------------------------------------
+void FrameList::appendName(const string& name){
+    // The frame number is the last digit run; anything that overflows 64 bits
+    // or doesn't fit the 16 bit lengths is kept as a whole name
+    size_t digitsEnd = name.size();
+    while (digitsEnd > 0 && !isdigit((unsigned char)name[digitsEnd - 1])) {
+        digitsEnd--;
+    }
+    size_t digitsStart = digitsEnd;
+    while (digitsStart > 0 && isdigit((unsigned char)name[digitsStart - 1])) {
+        digitsStart--;
+    }
+    size_t width = digitsEnd - digitsStart;
+    bool numbered = width > 0 && width <= 19 && name.size() <= UINT16_MAX;
+    
+    uint64_t number = 0;
+    for (size_t i = digitsStart; numbered && i < digitsEnd; i++) {
+        number = number * 10 + (name[i] - '0');
+    }
+    
+    if (numbered && !runs.empty()) {
+        Run& last = runs.back();
+        if (last.width == width && last.firstNumber + last.count == number &&
+            last.prefixLength == digitsStart && last.suffixLength == name.size() - digitsEnd &&
+            arena.compare(last.prefixOffset, last.prefixLength, name, 0, digitsStart) == 0 &&
+            arena.compare(last.suffixOffset, last.suffixLength, name, digitsEnd, string::npos) == 0) {
+            last.count++;
+            numFrames++;
+            return;
+        }
+    }
+    
+    Run run;
+    run.start = numFrames;
+    run.count = 1;
+    if (numbered) {
+        // A gap in the numbering starts a new run with the same prefix and suffix; share them
+        const Run* previous = runs.empty() ? nullptr : &runs.back();
+        if (previous && previous->width > 0 && previous->prefixLength == digitsStart &&
+            arena.compare(previous->prefixOffset, previous->prefixLength, name, 0, digitsStart) == 0) {
+            run.prefixOffset = previous->prefixOffset;
+        } else {
+            run.prefixOffset = addToArena(name.data(), digitsStart);
+        }
+        if (previous && previous->width > 0 && previous->suffixLength == name.size() - digitsEnd &&
+            arena.compare(previous->suffixOffset, previous->suffixLength, name, digitsEnd, string::npos) == 0) {
+            run.suffixOffset = previous->suffixOffset;
+        } else {
+            run.suffixOffset = addToArena(name.data() + digitsEnd, name.size() - digitsEnd);
+        }
+        run.prefixLength = digitsStart;
+        run.suffixLength = name.size() - digitsEnd;
+        run.width = width;
+        run.firstNumber = number;
+    } else {
+        run.prefixOffset = addToArena(name.data(), name.size());
+        run.prefixLength = std::min<size_t>(name.size(), UINT16_MAX);
+    }
+    runs.push_back(run);
+    numFrames++;
+}
+
+//--------------------------------------------------------------
+const FrameList::Run& FrameList::findRun(size_t index) const {
+    // The bucket lands on or just before the run; at most a bucket's worth of
+    // single-frame runs lie between
+    uint32_t run = buckets[index >> BUCKET_SHIFT];
+    while (runs[run].start + runs[run].count <= index) {
+        run++;
+    }
+    return runs[run];
+}
+
+//--------------------------------------------------------------
+string FrameList::getName(size_t index) const {
+    const Run& run = findRun(index);
+    string name;
+    name.reserve(run.prefixLength + run.width + run.suffixLength);
+    name.append(arena, run.prefixOffset, run.prefixLength);
+    if (run.width > 0) {
+        char digits[24];
+        snprintf(digits, sizeof(digits), "%0*llu", (int)run.width, (unsigned long long)(run.firstNumber + (index - run.start)));
+        name.append(digits);
+        name.append(arena, run.suffixOffset, run.suffixLength);
+    }
+    return name;
+}
+
+//--------------------------------------------------------------
+string FrameList::getPath(size_t index) const {
+    return directory + "/" + getName(index);
+}
+
+//--------------------------------------------------------------
+size_t FrameList::getMemoryUsage() const {
+    return runs.capacity() * sizeof(Run) + arena.capacity() + buckets.capacity() * sizeof(uint32_t);
+}
+
+//--------------------------------------------------------------
+int FrameList::find(const string& name) const {
+    // Binary search over the natural order the list was built in
+    size_t low = 0;
+    size_t high = numFrames;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (naturalLess(getName(middle), name)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == numFrames || getName(low) != name) {
+        return -1;
+    }
+    return low;
+}
+
+//--------------------------------------------------------------
+bool FrameList::isImageFile(const string& name){
+    size_t dot = name.find_last_of('.');
+    if (dot == string::npos || name[0] == '.') {
+        return false;
+    }
+    // Called for every directory entry of huge folders, so compare in place
+    // instead of building a lowercased copy
+    auto is = [&](const char* ext){
+        size_t length = strlen(ext);
+        if (name.size() - dot - 1 != length) {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++) {
+            if (tolower((unsigned char)name[dot + 1 + i]) != ext[i]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return is("jpg") || is("jpeg") || is("png") || is("tif") || is("tiff");
+}
+
+//--------------------------------------------------------------
+bool FrameList::naturalLess(const string& a, const string& b){
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (isdigit((unsigned char)a[i]) && isdigit((unsigned char)b[j])) {
+            // Compare digit runs by value: skip leading zeros, then longer run wins
+            size_t startA = i;
+            size_t startB = j;
+            while (i < a.size() && isdigit((unsigned char)a[i])) i++;
+            while (j < b.size() && isdigit((unsigned char)b[j])) j++;
+            size_t valueA = startA;
+            size_t valueB = startB;
+            while (valueA + 1 < i && a[valueA] == '0') valueA++;
+            while (valueB + 1 < j && b[valueB] == '0') valueB++;
+            size_t lengthA = i - valueA;
+            size_t lengthB = j - valueB;
+            if (lengthA != lengthB) {
+                return lengthA < lengthB;
+            }
+            int order = a.compare(valueA, lengthA, b, valueB, lengthB);
+            if (order != 0) {
+                return order < 0;
+            }
+            // Same value: fewer leading zeros first, so the order stays total
+            if (i - startA != j - startB) {
+                return i - startA < j - startB;
+            }
+        } else {
+            if (a[i] != b[j]) {
+                return (unsigned char)a[i] < (unsigned char)b[j];
+            }
+            i++;
+            j++;
+        }
+    }
+    return a.size() - i < b.size() - j;
+}
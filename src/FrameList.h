@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Immutable, naturally sorted list of the image files in a sequence folder.
+// The directory watcher builds a new FrameList for every change and publishes it
+// with an atomic pointer swap; readers on any thread keep their shared_ptr for as
+// long as they need a consistent view.
+//
+// Names aren't stored one string per frame. Consecutive frames that share a
+// prefix and suffix around a counting number (frame_000123.jpg, frame_000124.jpg)
+// become one run of a few bytes, and only names that fit no run are kept whole,
+// in a single string arena. A bucket table maps an index to its run, so
+// index -> name stays constant time even for multi-million frame archives.
+class FrameList {
+public:
+	FrameList(const string& directory, const vector<string>& names, uint64_t replacedCount = 0);
+	
+	size_t size() const { return numFrames; }
+	bool empty() const { return numFrames == 0; }
+	string getPath(size_t index) const;
+	string getName(size_t index) const;
+	const string& getDirectory() const { return directory; }
+	
+	// Number of runs and bytes used for names, for the log
+	size_t getNumRuns() const { return runs.size(); }
+	size_t getMemoryUsage() const;
+	
+	// Index of a file name, or -1
+	int find(const string& name) const;
+	
+	// Increases whenever a file in the list is rewritten in place, so holders
+	// can tell that a decoded frame may be stale even though the count didn't change
+	uint64_t getReplacedCount() const { return replacedCount; }
+	
+	// Frame file extensions we play (jpg, jpeg, png, tif, tiff)
+	static bool isImageFile(const string& name);
+	
+	// Natural order: digit runs compare by value, so frame_9 sorts before frame_10
+	static bool naturalLess(const string& a, const string& b);
+	
+private:
+	struct Run {
+		uint32_t start = 0;         // index of the first frame in the run
+		uint32_t count = 0;
+		uint32_t prefixOffset = 0;  // into arena; a name without a number is all prefix
+		uint32_t suffixOffset = 0;
+		uint16_t prefixLength = 0;
+		uint16_t suffixLength = 0;
+		uint8_t width = 0;          // digits of the zero-padded number; 0 for a whole name
+		uint64_t firstNumber = 0;
+	};
+	
+	// Each bucket covers this many frames and holds the run its first frame is in
+	static const int BUCKET_SHIFT = 4;
+	
+	void appendName(const string& name);
+	uint32_t addToArena(const char* text, size_t length);
+	const Run& findRun(size_t index) const;
+	
+	string directory;
+	size_t numFrames = 0;
+	vector<Run> runs;
+	string arena;
+	vector<uint32_t> buckets;
+	uint64_t replacedCount;
+};
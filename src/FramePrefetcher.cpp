@@ -0,0 +1,230 @@
+#include "FramePrefetcher.h"
+
+//--------------------------------------------------------------
+FramePrefetcher::~FramePrefetcher(){
+    close();
+}
+
+//--------------------------------------------------------------
+void FramePrefetcher::setup(int size, FrameCache& frameCache, int numThreads){
+    unique_ptr<DecodePool> newPool = make_unique<DecodePool>();
+    newPool->setup(numThreads);
+    setup(size, frameCache, *newPool);
+    ownedPool = std::move(newPool);
+}
+
+//--------------------------------------------------------------
+void FramePrefetcher::setup(int size, FrameCache& frameCache, DecodePool& decodePool){
+    close();
+
+    std::unique_lock<std::mutex> lock(decodePool.mutex);
+    pool = &decodePool;
+    ringSize = std::max(std::max(1, size), pool->getNumThreads());
+    cache = &frameCache;
+    queue.clear();
+    numDecoded = 0;
+    throughputSampleTime = ofGetElapsedTimeMicros();
+    throughputSampleDecoded = 0;
+    throughput = 0;
+    pool->attach(this);
+    schedule();
+}
+
+//--------------------------------------------------------------
+void FramePrefetcher::close(){
+    if (pool) {
+        std::unique_lock<std::mutex> lock(pool->mutex);
+        pool->detach(this, lock);
+        queue.clear();
+        pool = nullptr;
+    }
+    // Joins the workers if they were ours
+    ownedPool.reset();
+}
+
+//--------------------------------------------------------------
+void FramePrefetcher::setFrameList(shared_ptr<const FrameList> newFrameList){
+    std::unique_lock<std::mutex> lock = lockPool();
+    bool sameFiles = frameList && newFrameList &&
+                     frameList->getDirectory() == newFrameList->getDirectory() &&
+                     frameList->getReplacedCount() == newFrameList->getReplacedCount();
+    for (auto it = ring.begin(); it != ring.end();) {
+        if (sameFiles && it->first < (int)newFrameList->size() &&
+            frameList->getName(it->first) == newFrameList->getName(it->first)) {
+            ++it;
+        } else {
+            it = ring.erase(it);
+        }
+    }
+    frameList = newFrameList;
+    failed.clear();
+    generation++;
+    schedule();
+}
+
+//--------------------------------------------------------------
+void FramePrefetcher::setPlayhead(const PlaybackCursor& cursor){
+    std::unique_lock<std::mutex> lock = lockPool();
+    if (cursor.index == playhead.index && cursor.direction == playhead.direction &&
+        cursor.loopMode == playhead.loopMode && cursor.rangeStart == playhead.rangeStart &&
+        cursor.rangeEnd == playhead.rangeEnd && cursor.stride == playhead.stride &&
+        cursor.frameStep == playhead.frameStep) {
+        return;
+    }
+    playhead = cursor;
+    schedule();
+}
+
+//--------------------------------------------------------------
+void FramePrefetcher::setDecodeSize(int width, int height, ProxyCache* proxyCache){
+    std::unique_lock<std::mutex> lock = lockPool();
+    decodeWidth = std::max(0, width);
+    decodeHeight = std::max(0, height);
+    proxies = proxyCache;
+}
+
+//--------------------------------------------------------------
+bool FramePrefetcher::takeFrame(int index, shared_ptr<const ofPixels>& frame){
+    std::unique_lock<std::mutex> lock = lockPool();
+    auto it = ring.find(index);
+    if (it == ring.end()) {
+        return false;
+    }
+    frame = it->second;
+    ring.erase(it);
+    return true;
+}
+
+//--------------------------------------------------------------
+int FramePrefetcher::getNumReady(){
+    std::unique_lock<std::mutex> lock = lockPool();
+    return ring.size();
+}
+
+//--------------------------------------------------------------
+bool FramePrefetcher::isFailed(int index){
+    std::unique_lock<std::mutex> lock = lockPool();
+    return failed.count(index) > 0;
+}
+
+//--------------------------------------------------------------
+uint64_t FramePrefetcher::getNumDecoded(){
+    std::unique_lock<std::mutex> lock = lockPool();
+    return numDecoded;
+}
+
+//--------------------------------------------------------------
+float FramePrefetcher::getThroughput(){
+    std::unique_lock<std::mutex> lock = lockPool();
+    uint64_t now = ofGetElapsedTimeMicros();
+    if (now - throughputSampleTime >= 500000) {
+        throughput = (numDecoded - throughputSampleDecoded) * 1000000.0f / (now - throughputSampleTime);
+        throughputSampleTime = now;
+        throughputSampleDecoded = numDecoded;
+    }
+    return throughput;
+}
+
+//--------------------------------------------------------------
+vector<int> FramePrefetcher::getUpcomingIndices(const PlaybackCursor& cursor) const {
+    vector<int> upcoming;
+    if (!frameList || frameList->empty() || cursor.rangeEnd < cursor.rangeStart) {
+        return upcoming;
+    }
+
+    // Walk the same wrap/bounce rules and frame skipping the player uses. Short ranges revisit
+    // frames, so stop adding once the ring would only contain duplicates.
+    PlaybackCursor next = cursor;
+    for (int i = 0; i < ringSize * 2 && (int)upcoming.size() < ringSize; i++) {
+        next.stepShown();
+        if (next.index < 0 || next.index >= (int)frameList->size()) {
+            break;
+        }
+        if (std::find(upcoming.begin(), upcoming.end(), next.index) == upcoming.end()) {
+            upcoming.push_back(next.index);
+        }
+    }
+    return upcoming;
+}
+
+//--------------------------------------------------------------
+void FramePrefetcher::schedule(){
+    // Called with the mutex held whenever the playhead or the frame list changes
+    upcoming = getUpcomingIndices(playhead);
+
+    // Drop frames the playhead has moved away from
+    for (auto it = ring.begin(); it != ring.end();) {
+        if (std::find(upcoming.begin(), upcoming.end(), it->first) == upcoming.end()) {
+            it = ring.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Queue the missing frames nearest first; idle workers each take the next one,
+    // so the nearest frames decode side by side
+    queue.clear();
+    for (int index : upcoming) {
+        if (ring.count(index) == 0 && decoding.count(index) == 0 && failed.count(index) == 0) {
+            queue.push_back(index);
+        }
+    }
+    if (!queue.empty() && pool) {
+        pool->condition.notify_all();
+    }
+}
+
+//--------------------------------------------------------------
+bool FramePrefetcher::takeJob(Job& job){
+    if (queue.empty()) {
+        return false;
+    }
+    job.index = queue.front();
+    queue.pop_front();
+    job.path = frameList->getPath(job.index);
+    job.generation = generation;
+    job.minWidth = decodeWidth;
+    job.minHeight = decodeHeight;
+    job.proxies = proxies;
+    decoding.insert(job.index);
+    return true;
+}
+
+//--------------------------------------------------------------
+void FramePrefetcher::finishJob(const Job& job, shared_ptr<const ofPixels> pixels){
+    decoding.erase(job.index);
+    numDecoded++;
+    if (job.generation != generation) {
+        // The frame list changed meanwhile; this index may belong to the new list too,
+        // and schedule() skipped it while it was still being decoded
+        schedule();
+        return;
+    }
+    if (!pixels) {
+        ofLogWarning("FramePrefetcher") << "Could not decode " << job.path;
+        failed.insert(job.index);
+    } else if (std::find(upcoming.begin(), upcoming.end(), job.index) != upcoming.end()) {
+        ring[job.index] = pixels;
+    }
+}
+
+//--------------------------------------------------------------
+shared_ptr<const ofPixels> FramePrefetcher::decode(const Job& job){
+    if (job.proxies) {
+        string proxyPath = job.proxies->getProxyPath(job.index, job.minWidth);
+        shared_ptr<const ofPixels> pixels = proxyPath.empty() ? nullptr : cache->load(proxyPath);
+        if (pixels) {
+            return pixels;
+        }
+    }
+    if (job.minWidth > 0 || job.minHeight > 0) {
+        return cache->load(job.path, job.minWidth, job.minHeight);
+    }
+    return cache->load(job.path);
+}
+
+//--------------------------------------------------------------
+std::unique_lock<std::mutex> FramePrefetcher::lockPool(){
+    // Before setup() no worker can be looking at this prefetcher
+    return pool ? std::unique_lock<std::mutex>(pool->mutex) : std::unique_lock<std::mutex>();
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "ofMain.h"
+#include <deque>
+#include <set>
+#include "PlaybackCursor.h"
+#include "FrameCache.h"
+#include "FrameList.h"
+#include "DecodePool.h"
+#include "ProxyCache.h"
+
+// Background decoder that keeps a ring of decoded frames ready ahead of the playhead.
+// The main thread reports the playhead with setPlayhead() and only ever takes frames
+// that are already decoded; everything that touches the disk happens on the workers.
+// Frames are decoded through the shared FrameCache, so looping ranges that fit in
+// the cache budget are not read from disk again.
+//
+// A pool of decode threads works on different upcoming frames side by side. The
+// frames missing from the ring wait in one queue shared by the workers, nearest
+// first, and an idle worker takes the frame at its front. This stands in for
+// per-worker queues with work stealing: the queue is rebuilt on every playhead
+// change under the lock that guards the ring anyway, and a decode takes far longer
+// than taking a job, so per-worker queues would only add bookkeeping. Workers
+// finish out of order, but the ring is keyed by frame index and frames are only
+// handed over by index, so the player still gets them in playback order.
+//
+// The workers belong to a DecodePool, either the prefetcher's own or one shared
+// with the prefetchers of other sequences playing at the same time.
+class FramePrefetcher {
+public:
+	~FramePrefetcher();
+	
+	// Decodes on a pool of its own; numThreads 0 uses one decode thread per core.
+	// The ring holds at least one frame per thread so none of them sits idle.
+	void setup(int ringSize, FrameCache& cache, int numThreads = 0);
+	// Decodes on a pool shared with other prefetchers
+	void setup(int ringSize, FrameCache& cache, DecodePool& pool);
+	void close();
+	
+	// Replace the sequence being played. Decoded frames are kept only where the
+	// new list still has the same, unmodified file at the same index.
+	void setFrameList(shared_ptr<const FrameList> frameList);
+	
+	// Tell the workers where playback is, so they decode the frames that follow it
+	void setPlayhead(const PlaybackCursor& cursor);
+	
+	// Decode at least width x height from now on instead of the cache's decode size,
+	// 0 x 0 to go back to it. With proxies, frames whose scrub proxy at that width is
+	// built are loaded from it. Frames already in the ring are kept.
+	void setDecodeSize(int width, int height, ProxyCache* proxies = nullptr);
+	
+	// Hand over a decoded frame. Returns false (and leaves frame untouched)
+	// if the frame is not decoded yet; never blocks on disk.
+	bool takeFrame(int index, shared_ptr<const ofPixels>& frame);
+	
+	int getNumReady();
+	
+	// The frame could not be decoded and won't be retried until the frame list changes
+	bool isFailed(int index);
+	int getNumThreads() const { return pool ? pool->getNumThreads() : 0; }
+	
+	// Frames decoded since setup
+	uint64_t getNumDecoded();
+	
+	// Frames decoded per second over the last half second or more
+	float getThroughput();
+	
+private:
+	friend class DecodePool;
+	
+	struct Job {
+		int index = -1;
+		string path;
+		int generation = 0;
+		int minWidth = 0;   // 0 x 0 for the cache's decode size
+		int minHeight = 0;
+		ProxyCache* proxies = nullptr;
+	};
+	
+	// Locks the pool's mutex, which guards everything below; nothing to lock before setup()
+	std::unique_lock<std::mutex> lockPool();
+	vector<int> getUpcomingIndices(const PlaybackCursor& cursor) const;
+	void schedule();
+	bool hasJobs() const { return !queue.empty(); }
+	// The pool calls these for its workers, with its mutex held
+	bool takeJob(Job& job);
+	void finishJob(const Job& job, shared_ptr<const ofPixels> pixels);
+	// Run by the pool's workers without its mutex
+	shared_ptr<const ofPixels> decode(const Job& job);
+	
+	DecodePool* pool = nullptr;
+	unique_ptr<DecodePool> ownedPool;  // set up by setup(ringSize, cache, numThreads)
+	int ringSize = 8;
+	FrameCache* cache = nullptr;
+	shared_ptr<const FrameList> frameList;
+	PlaybackCursor playhead;
+	vector<int> upcoming;  // frames the ring should hold, nearest first
+	std::map<int, shared_ptr<const ofPixels>> ring;  // frame index -> decoded pixels
+	std::set<int> decoding;  // frames a worker is decoding right now
+	std::set<int> failed;  // frames that could not be decoded, skipped until the frame list changes
+	int generation = 0;    // bumped whenever the frame list changes so in-flight decodes get discarded
+	int decodeWidth = 0;   // from setDecodeSize()
+	int decodeHeight = 0;
+	ProxyCache* proxies = nullptr;
+	
+	std::deque<int> queue;  // frame indices still to decode, nearest first
+	
+	uint64_t numDecoded = 0;
+	uint64_t throughputSampleTime = 0;
+	uint64_t throughputSampleDecoded = 0;
+	float throughput = 0;
+};
@@ -0,0 +1,191 @@
+#include "FrameStats.h"
+
+//--------------------------------------------------------------
+FrameStats& FrameStats::get(){
+    static FrameStats stats;
+    return stats;
+}
+
+//--------------------------------------------------------------
+FrameStats::FrameStats(){
+    reset();
+}
+
+//--------------------------------------------------------------
+const char* FrameStats::getStageName(Stage stage){
+    switch (stage) {
+        case FILE_READ: return "read";
+        case DECODE: return "decode";
+        case UPLOAD: return "upload";
+        case RENDER: return "render";
+        case PUBLISH: return "publish";
+        case TAIL_READY: return "tail";
+        case TAIL_OUTPUT: return "live";
+        default: return "?";
+    }
+}
+
+//--------------------------------------------------------------
+int FrameStats::getBucket(uint64_t micros){
+    if (micros < SUB_BUCKETS) {
+        return micros;
+    }
+    // Octave from the highest set bit, sub-bucket from the two bits below it
+    int octave = 63 - __builtin_clzll(micros);
+    int sub = (micros >> (octave - 2)) & (SUB_BUCKETS - 1);
+    return std::min(NUM_BUCKETS - 1, (octave - 1) * SUB_BUCKETS + sub);
+}
+
+//--------------------------------------------------------------
+uint64_t FrameStats::getBucketMiddle(int bucket){
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    int octave = bucket / SUB_BUCKETS + 1;
+    int sub = bucket % SUB_BUCKETS;
+    uint64_t width = 1ull << (octave - 2);
+    return (1ull << octave) + sub * width + width / 2;
+}
+
+//--------------------------------------------------------------
+uint32_t FrameStats::getThreadNumber(){
+    // Small stable numbers read better in the trace viewer than thread id hashes
+    static std::atomic<uint32_t> nextThread(1);
+    thread_local uint32_t thread = nextThread++;
+    return thread;
+}
+
+//--------------------------------------------------------------
+void FrameStats::record(Stage stage, uint64_t startMicros, uint64_t durationMicros){
+    Histogram& histogram = histograms[stage];
+    histogram.buckets[getBucket(durationMicros)].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.totalMicros.fetch_add(durationMicros, std::memory_order_relaxed);
+    uint64_t previousMax = histogram.maxMicros.load(std::memory_order_relaxed);
+    while (durationMicros > previousMax &&
+           !histogram.maxMicros.compare_exchange_weak(previousMax, durationMicros, std::memory_order_relaxed)) {
+    }
+    
+    // Oldest events are overwritten; an export racing a writer may catch one half-written
+    Event& event = events[nextEvent.fetch_add(1, std::memory_order_relaxed) % TRACE_CAPACITY];
+    event.startMicros.store(startMicros, std::memory_order_relaxed);
+    event.durationMicros.store(std::min<uint64_t>(durationMicros, UINT32_MAX), std::memory_order_relaxed);
+    event.stageAndThread.store(stage | (getThreadNumber() << 8), std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+FrameStats::Summary FrameStats::getSummary(Stage stage) const {
+    const Histogram& histogram = histograms[stage];
+    Summary summary;
+    summary.count = histogram.count.load(std::memory_order_relaxed);
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.meanMillis = histogram.totalMicros.load(std::memory_order_relaxed) / (double)summary.count / 1000.0;
+    summary.maxMillis = histogram.maxMicros.load(std::memory_order_relaxed) / 1000.0f;
+    
+    // Buckets keep counting while we read, so rank against what we actually summed
+    uint64_t counts[NUM_BUCKETS];
+    uint64_t total = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        counts[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    uint64_t p50Rank = (total + 1) / 2;
+    uint64_t p99Rank = std::max<uint64_t>(1, (total * 99 + 99) / 100);
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        if (seen < p50Rank && seen + counts[i] >= p50Rank) {
+            summary.p50Millis = getBucketMiddle(i) / 1000.0f;
+        }
+        if (seen < p99Rank && seen + counts[i] >= p99Rank) {
+            summary.p99Millis = getBucketMiddle(i) / 1000.0f;
+        }
+        seen += counts[i];
+    }
+    summary.p50Millis = std::min(summary.p50Millis, summary.maxMillis);
+    summary.p99Millis = std::min(summary.p99Millis, summary.maxMillis);
+    return summary;
+}
+
+//--------------------------------------------------------------
+void FrameStats::reset(){
+    for (Histogram& histogram : histograms) {
+        for (auto& bucket : histogram.buckets) {
+            bucket = 0;
+        }
+        histogram.count = 0;
+        histogram.totalMicros = 0;
+        histogram.maxMicros = 0;
+    }
+    for (Event& event : events) {
+        event.durationMicros = 0;
+        event.startMicros = 0;
+        event.stageAndThread = 0;
+    }
+    nextEvent = 0;
+    late = 0;
+    dropped = 0;
+}
+
+//--------------------------------------------------------------
+bool FrameStats::exportTrace(const string& path) const {
+    ofFile file(path, ofFile::WriteOnly);
+    if (!file.is_open()) {
+        ofLogWarning("FrameStats") << "Could not write " << path;
+        return false;
+    }
+    
+    uint64_t end = nextEvent.load();
+    uint64_t begin = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"SequenceStreamer\"}}";
+    for (uint64_t i = begin; i < end; i++) {
+        const Event& event = events[i % TRACE_CAPACITY];
+        uint32_t stageAndThread = event.stageAndThread.load(std::memory_order_relaxed);
+        file << ",\n{\"name\":\"" << getStageName((Stage)(stageAndThread & 0xFF))
+             << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (stageAndThread >> 8)
+             << ",\"ts\":" << event.startMicros.load(std::memory_order_relaxed)
+             << ",\"dur\":" << event.durationMicros.load(std::memory_order_relaxed) << "}";
+    }
+    file << "\n]}\n";
+    ofLogNotice("FrameStats") << "Wrote " << (end - begin) << " events to " << path;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool FrameStats::exportCsv(const string& path) const {
+    ofFile file(path, ofFile::WriteOnly);
+    if (!file.is_open()) {
+        ofLogWarning("FrameStats") << "Could not write " << path;
+        return false;
+    }
+    
+    uint64_t end = nextEvent.load();
+    uint64_t begin = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    file << "stage,thread,start_us,duration_us\n";
+    for (uint64_t i = begin; i < end; i++) {
+        const Event& event = events[i % TRACE_CAPACITY];
+        uint32_t stageAndThread = event.stageAndThread.load(std::memory_order_relaxed);
+        file << getStageName((Stage)(stageAndThread & 0xFF)) << "," << (stageAndThread >> 8) << ","
+             << event.startMicros.load(std::memory_order_relaxed) << ","
+             << event.durationMicros.load(std::memory_order_relaxed) << "\n";
+    }
+    
+    // Summary for the whole session, not just the events still in the ring
+    string summaryPath = ofFilePath::removeExt(path) + "-summary.csv";
+    ofFile summaryFile(summaryPath, ofFile::WriteOnly);
+    if (!summaryFile.is_open()) {
+        ofLogWarning("FrameStats") << "Could not write " << summaryPath;
+        return false;
+    }
+    summaryFile << "stage,count,mean_ms,p50_ms,p99_ms,max_ms\n";
+    for (int i = 0; i < NUM_STAGES; i++) {
+        Summary summary = getSummary((Stage)i);
+        summaryFile << getStageName((Stage)i) << "," << summary.count << "," << summary.meanMillis << ","
+                    << summary.p50Millis << "," << summary.p99Millis << "," << summary.maxMillis << "\n";
+    }
+    summaryFile << "late_frames," << late.load() << ",,,,\n";
+    summaryFile << "dropped_frames," << dropped.load() << ",,,,\n";
+    return true;
+}
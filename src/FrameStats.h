@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ofMain.h"
+#include <atomic>
+
+// Where frame time goes: file read, decode, texture upload, FBO render and
+// Syphon publish are timed into lock-free histograms (p50/p99/max), and every
+// timing is also kept in a ring of recent events that can be written out as a
+// Chrome trace (chrome://tracing, Perfetto) or CSV on a show machine.
+// Recording only touches atomics, so worker threads can time themselves too.
+//
+// GL stages measure the CPU side of the call; the driver may finish later.
+// The live tail stages run from a new file's modification time until its frame
+// is decoded and until it is first shown (see LiveTail).
+class FrameStats {
+public:
+	enum Stage {
+		FILE_READ,
+		DECODE,
+		UPLOAD,
+		RENDER,
+		PUBLISH,
+		TAIL_READY,
+		TAIL_OUTPUT,
+		NUM_STAGES
+	};
+	
+	struct Summary {
+		uint64_t count = 0;
+		float meanMillis = 0;
+		float p50Millis = 0;
+		float p99Millis = 0;
+		float maxMillis = 0;
+	};
+	
+	// Times the enclosing block
+	class Scope {
+	public:
+		Scope(Stage stage) : stage(stage), start(ofGetElapsedTimeMicros()) {}
+		~Scope() { FrameStats::get().record(stage, start, ofGetElapsedTimeMicros() - start); }
+	private:
+		Stage stage;
+		uint64_t start;
+	};
+	
+	static FrameStats& get();
+	static const char* getStageName(Stage stage);
+	
+	void record(Stage stage, uint64_t startMicros, uint64_t durationMicros);
+	
+	// A due frame wasn't ready and the previous one stayed up another refresh
+	void countLate() { late++; }
+	// Source frames skipped beyond what the playback speed asks for
+	void countDropped(int frames) { dropped += frames; }
+	
+	Summary getSummary(Stage stage) const;
+	uint64_t getLate() const { return late; }
+	uint64_t getDropped() const { return dropped; }
+	void reset();
+	
+	// Recent events as Chrome trace-event JSON, and as CSV with a summary next to it
+	bool exportTrace(const string& path) const;
+	bool exportCsv(const string& path) const;
+	
+private:
+	// Four buckets per power of two of microseconds: about 19% resolution
+	static const int SUB_BUCKETS = 4;
+	static const int NUM_BUCKETS = 64 * SUB_BUCKETS;
+	static const int TRACE_CAPACITY = 1 << 16;
+	
+	struct Histogram {
+		std::atomic<uint64_t> buckets[NUM_BUCKETS];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> totalMicros;
+		std::atomic<uint64_t> maxMicros;
+	};
+	
+	struct Event {
+		std::atomic<uint64_t> startMicros;
+		std::atomic<uint32_t> durationMicros;
+		std::atomic<uint32_t> stageAndThread;  // stage in the low byte
+	};
+	
+	FrameStats();
+	static int getBucket(uint64_t micros);
+	static uint64_t getBucketMiddle(int bucket);
+	static uint32_t getThreadNumber();
+	
+	Histogram histograms[NUM_STAGES];
+	Event events[TRACE_CAPACITY];
+	std::atomic<uint64_t> nextEvent;
+	std::atomic<uint64_t> late;
+	std::atomic<uint64_t> dropped;
+};
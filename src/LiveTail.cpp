@@ -0,0 +1,210 @@
+#include "LiveTail.h"
+#include "FrameStats.h"
+#include <sys/stat.h>
+
+//--------------------------------------------------------------
+LiveTail::~LiveTail(){
+    close();
+}
+
+//--------------------------------------------------------------
+void LiveTail::setup(FrameCache& frameCache, int frames){
+    close();
+    std::unique_lock<std::mutex> lock(mutex);
+    cache = &frameCache;
+    numFrames = std::max(1, frames);
+    running = true;
+    worker = std::thread(&LiveTail::loadLoop, this);
+}
+
+//--------------------------------------------------------------
+void LiveTail::close(){
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+        queue.clear();
+        condition.notify_all();
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    frameList.reset();
+    wanted.clear();
+    arrived.clear();
+    loading.clear();
+    pinned.clear();
+    lastLatency = 0;
+}
+
+//--------------------------------------------------------------
+void LiveTail::setNumFrames(int frames){
+    std::unique_lock<std::mutex> lock(mutex);
+    frames = std::max(1, frames);
+    if (frames != numFrames) {
+        numFrames = frames;
+        plan();
+    }
+}
+
+//--------------------------------------------------------------
+void LiveTail::setFrameList(shared_ptr<const FrameList> newFrameList){
+    std::unique_lock<std::mutex> lock(mutex);
+    shared_ptr<const FrameList> previous = frameList;
+    frameList = newFrameList;
+
+    bool sameFolder = previous && frameList && previous->getDirectory() == frameList->getDirectory();
+    if (!sameFolder) {
+        arrived.clear();
+    }
+    if (!sameFolder || previous->getReplacedCount() != frameList->getReplacedCount()) {
+        // Another folder, or a file rewritten in place: nothing pinned can be trusted
+        generation++;
+        pinned.clear();
+        loading.clear();
+    }
+
+    // Names the last list didn't have just arrived
+    if (sameFolder) {
+        size_t size = frameList->size();
+        for (size_t i = size > (size_t)numFrames ? size - numFrames : 0; i < size; i++) {
+            string name = frameList->getName(i);
+            if (previous->find(name) < 0) {
+                arrived.insert(name);
+            }
+        }
+    }
+    plan();
+}
+
+//--------------------------------------------------------------
+bool LiveTail::getFrame(int index, shared_ptr<const ofPixels>& pixels){
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!frameList || index < 0 || index >= (int)frameList->size()) {
+        return false;
+    }
+    auto it = pinned.find(frameList->getName(index));
+    if (it == pinned.end()) {
+        return false;
+    }
+    pixels = it->second.pixels;
+    return true;
+}
+
+//--------------------------------------------------------------
+void LiveTail::recordShown(int index){
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!frameList || index < 0 || index >= (int)frameList->size()) {
+        return;
+    }
+    auto it = pinned.find(frameList->getName(index));
+    if (it == pinned.end() || it->second.shown) {
+        return;
+    }
+    it->second.shown = true;
+    uint64_t latency = getLatency(it->second.writeMicros);
+    if (latency > 0) {
+        FrameStats::get().record(FrameStats::TAIL_OUTPUT, ofGetElapsedTimeMicros() - latency, latency);
+        lastLatency = latency / 1000.0f;
+    }
+}
+
+//--------------------------------------------------------------
+int LiveTail::getNumPinned(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return pinned.size();
+}
+
+//--------------------------------------------------------------
+float LiveTail::getLastLatency(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return lastLatency;
+}
+
+//--------------------------------------------------------------
+uint64_t LiveTail::getRealTimeMicros(){
+    // The clock file modification times are in
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+//--------------------------------------------------------------
+uint64_t LiveTail::getWriteTimeMicros(const string& path){
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (uint64_t)info.st_mtimespec.tv_sec * 1000000 + info.st_mtimespec.tv_nsec / 1000;
+#else
+    return (uint64_t)info.st_mtim.tv_sec * 1000000 + info.st_mtim.tv_nsec / 1000;
+#endif
+}
+
+//--------------------------------------------------------------
+uint64_t LiveTail::getLatency(uint64_t writeMicros){
+    uint64_t now = getRealTimeMicros();
+    if (writeMicros == 0 || now <= writeMicros) {
+        return 0;
+    }
+    // Also keeps the event from starting before the app did
+    uint64_t latency = now - writeMicros;
+    return latency < MAX_LATENCY_MICROS && latency < ofGetElapsedTimeMicros() ? latency : 0;
+}
+
+//--------------------------------------------------------------
+void LiveTail::plan(){
+    wanted.clear();
+    queue.clear();
+    if (frameList) {
+        size_t size = frameList->size();
+        size_t first = size > (size_t)numFrames ? size - numFrames : 0;
+        for (size_t i = size; i-- > first;) {
+            string name = frameList->getName(i);
+            wanted.insert(name);
+            if (!pinned.count(name) && !loading.count(name)) {
+                queue.push_back({name, frameList->getPath(i), arrived.count(name) > 0});
+            }
+        }
+    }
+
+    // Unpin whatever has dropped out of the tail
+    for (auto it = pinned.begin(); it != pinned.end();) {
+        it = wanted.count(it->first) ? std::next(it) : pinned.erase(it);
+    }
+    for (auto it = arrived.begin(); it != arrived.end();) {
+        it = wanted.count(*it) ? std::next(it) : arrived.erase(it);
+    }
+    condition.notify_all();
+}
+
+//--------------------------------------------------------------
+void LiveTail::loadLoop(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (queue.empty()) {
+            condition.wait(lock);
+            continue;
+        }
+        Job job = queue.front();
+        queue.pop_front();
+        int jobGeneration = generation;
+        loading.insert(job.name);
+        lock.unlock();
+
+        uint64_t writeMicros = job.arrived ? getWriteTimeMicros(job.path) : 0;
+        shared_ptr<const ofPixels> pixels = cache->load(job.path);
+        uint64_t latency = pixels ? getLatency(writeMicros) : 0;
+        if (latency > 0) {
+            FrameStats::get().record(FrameStats::TAIL_READY, ofGetElapsedTimeMicros() - latency, latency);
+        }
+
+        lock.lock();
+        loading.erase(job.name);
+        // A frame that didn't decode may still have been incomplete; the next frame list queues it again
+        if (pixels && jobGeneration == generation && wanted.count(job.name)) {
+            Entry& entry = pinned[job.name];
+            entry.pixels = pixels;
+            entry.writeMicros = latency > 0 ? writeMicros : 0;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ofMain.h"
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include "FrameCache.h"
+#include "FrameList.h"
+
+// Keeps the newest frames of a folder that a camera is writing into decoded and
+// pinned, so a frame can go out the moment the watcher publishes it instead of
+// waiting for the prefetcher to get round to the end of the range.
+//
+// Every new frame list queues the newest frames that aren't pinned yet, newest
+// first, for a thread of its own; they are decoded through the FrameCache and held
+// here even if the cache evicts them. Frames that arrived while the tail was being
+// watched are timed from their file's modification time: when they are decoded
+// (FrameStats::TAIL_READY) and when they are first shown (TAIL_OUTPUT), which is
+// the capture to output latency as far as the file system can tell.
+class LiveTail {
+public:
+	~LiveTail();
+	
+	void setup(FrameCache& cache, int numFrames = 8);
+	void close();
+	
+	// How many of the newest frames to keep pinned
+	void setNumFrames(int numFrames);
+	void setFrameList(shared_ptr<const FrameList> frameList);
+	
+	// The frame if it is pinned and decoded; never blocks on a load
+	bool getFrame(int index, shared_ptr<const ofPixels>& pixels);
+	// The frame went out; records its latency the first time
+	void recordShown(int index);
+	
+	int getNumPinned();
+	// Capture to output of the newest frame shown, in milliseconds; 0 before the first
+	float getLastLatency();
+	
+	// Older files aren't from a live capture; their latency isn't recorded
+	static const uint64_t MAX_LATENCY_MICROS = 10000000;
+	
+private:
+	struct Job {
+		string name;
+		string path;
+		bool arrived = false;  // appeared while we were watching
+	};
+	
+	struct Entry {
+		shared_ptr<const ofPixels> pixels;
+		uint64_t writeMicros = 0;  // file modification time, 0 if it didn't arrive while watching
+		bool shown = false;
+	};
+	
+	static uint64_t getRealTimeMicros();
+	static uint64_t getWriteTimeMicros(const string& path);
+	// Microseconds from the file being written until now, or 0 to leave it out
+	static uint64_t getLatency(uint64_t writeMicros);
+	void plan();
+	void loadLoop();
+	
+	FrameCache* cache = nullptr;
+	shared_ptr<const FrameList> frameList;
+	int numFrames = 8;
+	
+	std::deque<Job> queue;               // newest first
+	std::set<string> wanted;             // names of the newest numFrames frames
+	std::set<string> arrived;            // of those, the ones that appeared while watching
+	std::set<string> loading;
+	std::map<string, Entry> pinned;
+	int generation = 0;                  // bumped when a file is rewritten or the folder changes
+	float lastLatency = 0;
+	
+	std::thread worker;
+	bool running = false;
+	std::mutex mutex;
+	std::condition_variable condition;
+};
@@ -0,0 +1,180 @@
+#include "Lz4Codec.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+    const int MIN_MATCH = 4;
+    const int LAST_LITERALS = 5;   // the block must end with at least this many literals
+    const int MATCH_FIND_LIMIT = 12;  // no match may start within this many bytes of the end
+    const int HASH_BITS = 16;
+    const int SKIP_TRIGGER = 6;    // speed up the search on data that doesn't compress
+    
+    inline uint32_t read32(const uint8_t* p) {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    
+    inline uint32_t hash(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+    
+    inline uint8_t* writeLength(uint8_t* op, size_t length) {
+        while (length >= 255) {
+            *op++ = 255;
+            length -= 255;
+        }
+        *op++ = (uint8_t)length;
+        return op;
+    }
+    
+    inline uint8_t* writeLiterals(uint8_t* op, uint8_t* token, const uint8_t* literals, size_t length) {
+        if (length >= 15) {
+            *token = 15 << 4;
+            op = writeLength(op, length - 15);
+        } else {
+            *token = (uint8_t)(length << 4);
+        }
+        memcpy(op, literals, length);
+        return op + length;
+    }
+    
+    inline bool readLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+        uint8_t byte;
+        do {
+            if (ip >= end) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+}
+
+//--------------------------------------------------------------
+size_t Lz4Codec::compressBound(size_t size){
+    return size + size / 255 + 16;
+}
+
+//--------------------------------------------------------------
+size_t Lz4Codec::compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity){
+    if (dstCapacity < compressBound(srcSize)) {
+        return 0;
+    }
+    
+    const uint8_t* ip = src;
+    const uint8_t* anchor = src;
+    const uint8_t* end = src + srcSize;
+    uint8_t* op = dst;
+    
+    if (srcSize > MATCH_FIND_LIMIT) {
+        const uint8_t* matchLimit = end - LAST_LITERALS;
+        const uint8_t* findLimit = end - MATCH_FIND_LIMIT;
+        std::vector<uint32_t> table(1 << HASH_BITS, 0);  // offsets into src
+        unsigned misses = 0;
+        
+        while (ip < findLimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t& slot = table[hash(sequence)];
+            const uint8_t* ref = src + slot;
+            slot = (uint32_t)(ip - src);
+            
+            if (ref >= ip || ip - ref > 65535 || read32(ref) != sequence) {
+                ip += 1 + (misses++ >> SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+            
+            // Extend the match forwards, stopping short of the trailing literals
+            const uint8_t* matchEnd = ip + MIN_MATCH;
+            const uint8_t* refEnd = ref + MIN_MATCH;
+            while (matchEnd < matchLimit && *matchEnd == *refEnd) {
+                matchEnd++;
+                refEnd++;
+            }
+            
+            uint8_t* token = op++;
+            op = writeLiterals(op, token, anchor, ip - anchor);
+            
+            size_t offset = ip - ref;
+            *op++ = (uint8_t)(offset & 0xff);
+            *op++ = (uint8_t)(offset >> 8);
+            
+            size_t matchLength = (matchEnd - ip) - MIN_MATCH;
+            if (matchLength >= 15) {
+                *token |= 15;
+                op = writeLength(op, matchLength - 15);
+            } else {
+                *token |= (uint8_t)matchLength;
+            }
+            
+            ip = matchEnd;
+            anchor = ip;
+        }
+    }
+    
+    // Whatever is left goes out as the final literal-only sequence
+    uint8_t* token = op++;
+    op = writeLiterals(op, token, anchor, end - anchor);
+    return op - dst;
+}
+
+//--------------------------------------------------------------
+bool Lz4Codec::decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize){
+    const uint8_t* ip = src;
+    const uint8_t* end = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* outEnd = dst + dstSize;
+    
+    while (ip < end) {
+        uint8_t token = *ip++;
+        
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(ip, end, literalLength)) {
+            return false;
+        }
+        if (literalLength > (size_t)(end - ip) || literalLength > (size_t)(outEnd - op)) {
+            return false;
+        }
+        memcpy(op, ip, literalLength);
+        op += literalLength;
+        ip += literalLength;
+        
+        // The last sequence carries literals only
+        if (ip >= end) {
+            break;
+        }
+        
+        if (end - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return false;
+        }
+        
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(ip, end, matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (matchLength > (size_t)(outEnd - op)) {
+            return false;
+        }
+        
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+        } else {
+            // Overlapping copy repeats the last offset bytes
+            for (size_t i = 0; i < matchLength; i++) {
+                op[i] = match[i];
+            }
+        }
+        op += matchLength;
+    }
+    
+    return op == outEnd;
+}
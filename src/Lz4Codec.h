@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Plain C++ compressor/decompressor for the LZ4 block format.
+// Used to shrink packed frames on disk; decompression is fast enough to run
+// per frame on the render thread. No openFrameworks dependency.
+class Lz4Codec {
+public:
+	// Worst-case compressed size for an input of size bytes
+	static size_t compressBound(size_t size);
+	
+	// Compress src into dst, which must hold at least compressBound(srcSize) bytes.
+	// Returns the compressed size, or 0 if dst is too small.
+	static size_t compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+	
+	// Decompress a block that expands to exactly dstSize bytes.
+	// Returns false on corrupt input instead of reading or writing out of bounds.
+	static bool decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+};
@@ -0,0 +1,252 @@
+#include "OutputGraph.h"
+#include <climits>
+
+//--------------------------------------------------------------
+void OutputGraph::setup(){
+    colorAdjust.setup();
+}
+
+//--------------------------------------------------------------
+void OutputGraph::setOutput(const string& name, int width, int height, bool maintainAspectRatio){
+    Output& output = outputs[name];
+    output.name = name;
+    if (output.fbo.isAllocated() && output.width == width && output.height == height &&
+        output.maintainAspectRatio == maintainAspectRatio) {
+        return;
+    }
+    if (!output.fbo.isAllocated() || output.width != width || output.height != height) {
+        output.fbo.allocate(width, height, GL_RGBA);
+    }
+    output.width = width;
+    output.height = height;
+    output.maintainAspectRatio = maintainAspectRatio;
+    output.dirty = true;
+    layoutDirty = true;
+}
+
+//--------------------------------------------------------------
+void OutputGraph::removeOutput(const string& name){
+    if (outputs.erase(name) > 0) {
+        layoutDirty = true;
+    }
+}
+
+//--------------------------------------------------------------
+OutputGraph::Output* OutputGraph::getOutput(const string& name){
+    auto it = outputs.find(name);
+    return it != outputs.end() ? &it->second : nullptr;
+}
+
+//--------------------------------------------------------------
+std::map<string, OutputGraph::Output>& OutputGraph::getOutputs(){
+    return outputs;
+}
+
+//--------------------------------------------------------------
+void OutputGraph::getLargestOutputSize(int& width, int& height) const {
+    width = 0;
+    height = 0;
+    for (const auto& entry : outputs) {
+        width = std::max(width, entry.second.width);
+        height = std::max(height, entry.second.height);
+    }
+}
+
+//--------------------------------------------------------------
+bool OutputGraph::keepsAspectRatio() const {
+    for (const auto& entry : outputs) {
+        if (!entry.second.maintainAspectRatio) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+void OutputGraph::setSource(const ofTexture& texture){
+    source = texture;
+    frameDirty = true;
+}
+
+//--------------------------------------------------------------
+void OutputGraph::setColor(const ColorAdjust::Settings& settings){
+    if (settings.brightness != color.brightness || settings.contrast != color.contrast ||
+        settings.saturation != color.saturation) {
+        color = settings;
+        frameDirty = true;
+    }
+}
+
+//--------------------------------------------------------------
+void OutputGraph::setBlack(bool value){
+    if (value != black) {
+        black = value;
+        frameDirty = true;
+    }
+}
+
+//--------------------------------------------------------------
+void OutputGraph::setPreviewArea(const ofRectangle& area){
+    if (area.width != previewWidth || area.height != previewHeight) {
+        previewWidth = area.width;
+        previewHeight = area.height;
+        layoutDirty = true;
+    }
+}
+
+//--------------------------------------------------------------
+void OutputGraph::invalidate(){
+    frameDirty = true;
+}
+
+//--------------------------------------------------------------
+bool OutputGraph::update(){
+    for (auto& entry : outputs) {
+        entry.second.updated = false;
+    }
+
+    if (layoutDirty) {
+        // A new output that fits the existing levels only needs its own draw
+        if (layoutChain()) {
+            frameDirty = true;
+        }
+        layoutDirty = false;
+    }
+    if (frameDirty) {
+        if (isShowingFrame()) {
+            renderChain();
+        }
+        for (auto& entry : outputs) {
+            entry.second.dirty = true;
+        }
+        frameDirty = false;
+    }
+
+    bool rendered = false;
+    for (auto& entry : outputs) {
+        Output& output = entry.second;
+        if (output.dirty) {
+            renderOutput(output);
+            output.dirty = false;
+            output.updated = true;
+            rendered = true;
+        }
+    }
+    return rendered;
+}
+
+//--------------------------------------------------------------
+void OutputGraph::drawPreview(const ofRectangle& area) const {
+    if (!isShowingFrame() || levels.empty()) {
+        return;
+    }
+    ofRectangle rect = getFrameRect(area.width, area.height, true);
+    getLevel(rect.width, rect.height).fbo.draw(area.x + rect.x, area.y + rect.y, rect.width, rect.height);
+}
+
+//--------------------------------------------------------------
+int OutputGraph::getNumLevels() const {
+    return levels.size();
+}
+
+//--------------------------------------------------------------
+bool OutputGraph::isShowingFrame() const {
+    return !black && source.isAllocated();
+}
+
+//--------------------------------------------------------------
+ofRectangle OutputGraph::getFrameRect(float width, float height, bool maintainAspectRatio) const {
+    if (!maintainAspectRatio) {
+        return ofRectangle(0, 0, width, height);
+    }
+    // Centered, as large as fits
+    float scale = min(width / source.getWidth(), height / source.getHeight());
+    float frameWidth = source.getWidth() * scale;
+    float frameHeight = source.getHeight() * scale;
+    return ofRectangle((width - frameWidth) / 2, (height - frameHeight) / 2, frameWidth, frameHeight);
+}
+
+//--------------------------------------------------------------
+bool OutputGraph::layoutChain(){
+    // Sized by the outputs rather than by the frame, so switching between scrub proxies
+    // and full frames never reallocates it. The frame is stretched into each level; an
+    // output's frame rect fits inside the output, so some level covers it either way.
+    int maxWidth = 0, maxHeight = 0;
+    int minWidth = INT_MAX, minHeight = INT_MAX;
+    auto addTarget = [&](int width, int height) {
+        maxWidth = std::max(maxWidth, width);
+        maxHeight = std::max(maxHeight, height);
+        minWidth = std::min(minWidth, width);
+        minHeight = std::min(minHeight, height);
+    };
+    for (const auto& entry : outputs) {
+        addTarget(entry.second.width, entry.second.height);
+    }
+    if (previewWidth >= 1 && previewHeight >= 1) {
+        addTarget(previewWidth, previewHeight);
+    }
+
+    vector<std::pair<int, int>> sizes;
+    if (maxWidth > 0 && maxHeight > 0) {
+        sizes.emplace_back(maxWidth, maxHeight);
+        while (true) {
+            int width = (sizes.back().first + 1) / 2;
+            int height = (sizes.back().second + 1) / 2;
+            if (width < minWidth || height < minHeight) {
+                break;
+            }
+            sizes.emplace_back(width, height);
+        }
+    }
+
+    bool changed = sizes.size() != levels.size();
+    levels.resize(sizes.size());
+    for (size_t i = 0; i < sizes.size(); i++) {
+        Level& level = levels[i];
+        if (level.width != sizes[i].first || level.height != sizes[i].second || !level.fbo.isAllocated()) {
+            level.width = sizes[i].first;
+            level.height = sizes[i].second;
+            level.fbo.allocate(level.width, level.height, GL_RGBA);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+//--------------------------------------------------------------
+void OutputGraph::renderChain(){
+    for (size_t i = 0; i < levels.size(); i++) {
+        Level& level = levels[i];
+        level.fbo.begin();
+        ofClear(0, 0, 0, 255);
+        if (i == 0) {
+            colorAdjust.draw(source, 0, 0, level.width, level.height, color);
+        } else {
+            // At half size linear filtering averages each 2x2 block
+            levels[i - 1].fbo.draw(0, 0, level.width, level.height);
+        }
+        level.fbo.end();
+    }
+}
+
+//--------------------------------------------------------------
+void OutputGraph::renderOutput(Output& output){
+    output.fbo.begin();
+    ofClear(0, 0, 0, 255);
+    if (isShowingFrame() && !levels.empty()) {
+        ofRectangle rect = getFrameRect(output.width, output.height, output.maintainAspectRatio);
+        getLevel(rect.width, rect.height).fbo.draw(rect.x, rect.y, rect.width, rect.height);
+    }
+    output.fbo.end();
+}
+
+//--------------------------------------------------------------
+const OutputGraph::Level& OutputGraph::getLevel(float width, float height) const {
+    // The smallest level that still has a texel for every output pixel
+    for (size_t i = levels.size(); i-- > 1;) {
+        if (levels[i].width >= std::ceil(width) && levels[i].height >= std::ceil(height)) {
+            return levels[i];
+        }
+    }
+    return levels[0];
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ColorAdjust.h"
+
+// The outputs one frame is rendered to, each a named FBO of its own size (the Syphon
+// output at 4K plus a 1080p and a 720p monitor feed, say).
+//
+// The frame is drawn through the colour pass once, at the size of the largest output
+// or the preview, into the top of a chain of half-size levels that reaches down to
+// the smallest. Each output scales from the smallest level that still covers it, so
+// a 4K frame feeding a 720p output is filtered down in steps instead of skipping texels,
+// and extra outputs cost a small draw each rather than another full-size colour pass.
+//
+// Nothing is redrawn until the frame, the colour settings, black screen or an output
+// changes. update() returns whether anything was, and Output::updated says which
+// outputs have a new picture to publish.
+class OutputGraph {
+public:
+	struct Output {
+		string name;
+		int width = 0;
+		int height = 0;
+		bool maintainAspectRatio = true;
+		ofFbo fbo;
+		bool dirty = true;
+		bool updated = false;  // Redrawn by the last update()
+	};
+
+	// Compiles the colour shaders; needs the GL context
+	void setup();
+
+	// Adds the output, or resizes it; only an actual change redraws it
+	void setOutput(const string& name, int width, int height, bool maintainAspectRatio);
+	void removeOutput(const string& name);
+	Output* getOutput(const string& name);
+	std::map<string, Output>& getOutputs();
+
+	// Largest output size, the most a frame needs decoding at
+	void getLargestOutputSize(int& width, int& height) const;
+	// True if every output letterboxes the frame rather than stretching it, so a frame
+	// fitted inside the largest output size is as large as any of them draws it
+	bool keepsAspectRatio() const;
+
+	// texture is the new current frame; it shares the GL texture, so it has to stay
+	// unchanged until the next call
+	void setSource(const ofTexture& texture);
+	void setColor(const ColorAdjust::Settings& settings);
+	void setBlack(bool black);
+
+	// Where drawPreview() will draw, so the chain keeps a level sharp enough for it
+	void setPreviewArea(const ofRectangle& area);
+	// Redraws every output on the next update(), e.g. for a new consumer of them
+	void invalidate();
+
+	// Redraws whatever changed; true if any output was
+	bool update();
+
+	// The frame as the outputs show it, colour included, fitted into area
+	void drawPreview(const ofRectangle& area) const;
+
+	int getNumLevels() const;
+
+private:
+	struct Level {
+		int width = 0;
+		int height = 0;
+		ofFbo fbo;
+	};
+
+	bool isShowingFrame() const;
+	ofRectangle getFrameRect(float width, float height, bool maintainAspectRatio) const;
+	bool layoutChain();
+	void renderChain();
+	void renderOutput(Output& output);
+	const Level& getLevel(float width, float height) const;
+
+	ColorAdjust colorAdjust;
+	ColorAdjust::Settings color;
+	ofTexture source;
+	bool black = false;
+	std::map<string, Output> outputs;
+	vector<Level> levels;  // Largest first, each half the size of the one before
+	float previewWidth = 0;
+	float previewHeight = 0;
+	bool frameDirty = true;   // Every output needs redrawing
+	bool layoutDirty = true;  // Sizes changed, the chain may need different levels
+};
@@ -0,0 +1,386 @@
+#include "PipeOutput.h"
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/uio.h>
+#endif
+
+namespace {
+    const size_t PAGE_BYTES = 4096;
+}
+
+//--------------------------------------------------------------
+PipeOutput::Buffer::~Buffer(){
+    // Unmapping is safe even while the pipe still holds spliced pages: the kernel keeps
+    // its own reference to them, and the address range is never handed out with them again
+    if (data) {
+        munmap(data, capacity);
+    }
+}
+
+//--------------------------------------------------------------
+PipeOutput::~PipeOutput(){
+    close();
+}
+
+//--------------------------------------------------------------
+bool PipeOutput::parseArguments(const vector<string>& arguments, Settings& settings){
+    bool requested = false;
+    for (size_t i = 0; i < arguments.size(); i++) {
+        if (arguments[i] == "--pipe" && i + 1 < arguments.size()) {
+            settings.target = arguments[++i];
+            requested = true;
+        } else if (arguments[i] == "--pipe-fps" && i + 1 < arguments.size()) {
+            settings.fps = ofToFloat(arguments[++i]);
+        } else if (arguments[i] == "--pipe-block") {
+            settings.policy = BLOCK;
+        }
+    }
+    return requested;
+}
+
+//--------------------------------------------------------------
+bool PipeOutput::setup(const Settings& newSettings){
+    close();
+    settings = newSettings;
+    settings.fps = std::max(1.0f, settings.fps);
+    settings.queueSize = std::max(1, settings.queueSize);
+    if (!settings.target.empty() && settings.target[0] == '|') {
+        command = popen(settings.target.substr(1).c_str(), "w");
+        if (!command) {
+            ofLogError("PipeOutput") << "Could not run " << settings.target.substr(1) << ": " << strerror(errno);
+            return false;
+        }
+        fd = fileno(command);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    } else {
+        struct stat info;
+        if (stat(settings.target.c_str(), &info) != 0 && mkfifo(settings.target.c_str(), 0644) != 0) {
+            ofLogError("PipeOutput") << "Could not create the FIFO " << settings.target << ": " << strerror(errno);
+            return false;
+        }
+    }
+
+    // A consumer quitting would otherwise kill the app on the next write. Set after
+    // popen() so the command doesn't inherit it.
+    signal(SIGPIPE, SIG_IGN);
+
+    readback.setup(2);
+    width = 0;
+    height = 0;
+    sizeWarned = false;
+    bytesWritten = 0;
+    numWritten = 0;
+    numDropped = 0;
+    startTime = 0;
+    numQueued = 0;
+    running = true;
+    writer = std::thread(&PipeOutput::writeLoop, this);
+    ofLogNotice("PipeOutput") << "Streaming raw RGBA at " << settings.fps << " fps to " << settings.target;
+    return true;
+}
+
+//--------------------------------------------------------------
+void PipeOutput::close(){
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+        condition.notify_all();
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+    disconnect();
+    if (command) {
+        // Waits for the encoder to finish the file
+        pclose(command);
+        command = nullptr;
+    }
+    readback.clear();
+    queue.clear();
+    latest.reset();
+    buffers.clear();
+}
+
+//--------------------------------------------------------------
+void PipeOutput::publish(const ofFbo& fbo){
+    if (!running) {
+        return;
+    }
+    FboReadback::Frame frame;
+    if (readback.isFull() && readback.map(frame, true)) {
+        store(frame);
+        readback.unmap();
+    }
+    readback.begin(fbo, ofGetElapsedTimeMicros());
+}
+
+//--------------------------------------------------------------
+void PipeOutput::update(){
+    if (!running) {
+        return;
+    }
+    FboReadback::Frame frame;
+    while (readback.map(frame)) {
+        store(frame);
+        readback.unmap();
+    }
+
+    // Every 1/fps seconds the stream gets a frame, the newest picture again if nothing
+    // changed, so the encoder's timeline matches the wall clock
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!latest) {
+        return;
+    }
+    uint64_t now = ofGetElapsedTimeMicros();
+    if (startTime == 0) {
+        startTime = now;
+    }
+    uint64_t due = (now - startTime) * settings.fps / 1000000 + 1;
+    shared_ptr<Buffer> frameBuffer = latest;
+    for (bool first = true; numQueued < due && running; numQueued++, first = false) {
+        if (!enqueue(frameBuffer, lock, first)) {
+            numQueued = due;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void PipeOutput::setPolicy(Policy policy){
+    std::unique_lock<std::mutex> lock(mutex);
+    settings.policy = policy;
+}
+
+//--------------------------------------------------------------
+uint64_t PipeOutput::getNumWritten(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return numWritten;
+}
+
+//--------------------------------------------------------------
+uint64_t PipeOutput::getNumDropped(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return numDropped;
+}
+
+//--------------------------------------------------------------
+bool PipeOutput::isConnected(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return connected;
+}
+
+//--------------------------------------------------------------
+void PipeOutput::store(const FboReadback::Frame& frame){
+    if (width == 0) {
+        width = frame.width;
+        height = frame.height;
+        ofLogNotice("PipeOutput") << "Stream is " << width << "x" << height;
+    }
+    if (frame.width != width || frame.height != height) {
+        // The consumer was told the size when it started; restart the pipe output for a new one
+        if (!sizeWarned) {
+            ofLogWarning("PipeOutput") << "Output is " << frame.width << "x" << frame.height << " now, the stream stays "
+                                       << width << "x" << height << " and repeats the last frame";
+            sizeWarned = true;
+        }
+        return;
+    }
+
+    size_t bytes = (size_t)width * height * 4;
+    std::unique_lock<std::mutex> lock(mutex);
+    shared_ptr<Buffer> buffer = getFreeBuffer(bytes, lock);
+    if (!buffer) {
+        // Every buffer is queued or still in the pipe; keep repeating the last picture
+        return;
+    }
+    lock.unlock();
+    memcpy(buffer->data, frame.pixels, bytes);
+    buffer->size = bytes;
+    lock.lock();
+    latest = buffer;
+}
+
+//--------------------------------------------------------------
+shared_ptr<PipeOutput::Buffer> PipeOutput::getFreeBuffer(size_t bytes, std::unique_lock<std::mutex>& lock){
+    while (running) {
+        for (const shared_ptr<Buffer>& buffer : buffers) {
+            // Spliced pages are the consumer's until it has read past them; the pipe never
+            // holds more than pipeCapacity bytes, so that is the case once as many came after
+            if (buffer.use_count() == 1 &&
+                (buffer->writtenUntil == 0 || bytesWritten >= buffer->writtenUntil + pipeCapacity)) {
+                return buffer;
+            }
+        }
+        // Room for the queue, the picture repeated, one being written and one being filled
+        if ((int)buffers.size() < settings.queueSize + 3) {
+            shared_ptr<Buffer> buffer = make_shared<Buffer>();
+            buffer->capacity = (bytes + PAGE_BYTES - 1) / PAGE_BYTES * PAGE_BYTES;
+            void* memory = mmap(nullptr, buffer->capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                return nullptr;
+            }
+            buffer->data = (unsigned char*)memory;
+            buffers.push_back(buffer);
+            return buffer;
+        }
+        // Only worth waiting for while the writer has something to get through
+        if (settings.policy == DROP || !connected || queue.empty()) {
+            return nullptr;
+        }
+        condition.wait(lock);
+    }
+    return nullptr;
+}
+
+//--------------------------------------------------------------
+bool PipeOutput::enqueue(const shared_ptr<Buffer>& buffer, std::unique_lock<std::mutex>& lock, bool canWait){
+    if (!connected) {
+        // Nobody reading yet; the stream starts with whatever is current when they do
+        return true;
+    }
+    if ((int)queue.size() >= settings.queueSize) {
+        if (settings.policy == DROP) {
+            numDropped++;
+            return true;
+        }
+        if (!canWait) {
+            return false;
+        }
+        condition.wait(lock, [&]() { return (int)queue.size() < settings.queueSize || !running || !connected; });
+        if (!running || !connected) {
+            return true;
+        }
+    }
+    queue.push_back(buffer);
+    condition.notify_all();
+    return true;
+}
+
+//--------------------------------------------------------------
+void PipeOutput::writeLoop(){
+    std::unique_lock<std::mutex> lock(mutex);
+    bool waitingLogged = false;
+
+    while (running) {
+        if (!connected) {
+            size_t capacity = 0;
+            lock.unlock();
+            bool opened = connect(capacity);
+            lock.lock();
+            if (!opened) {
+                if (!waitingLogged && !command) {
+                    ofLogNotice("PipeOutput") << "Waiting for a reader to open " << settings.target;
+                    waitingLogged = true;
+                }
+                condition.wait_for(lock, std::chrono::milliseconds(100));
+                continue;
+            }
+            ofLogNotice("PipeOutput") << "Writing to " << settings.target;
+            pipeCapacity = capacity;
+            connected = true;
+            waitingLogged = false;
+            continue;
+        }
+
+        if (queue.empty()) {
+            condition.wait(lock);
+            continue;
+        }
+        shared_ptr<Buffer> buffer = queue.front();
+        queue.pop_front();
+        // Room in the queue for a render thread waiting with BLOCK
+        condition.notify_all();
+
+        lock.unlock();
+        bool written = writeBuffer(*buffer);
+        lock.lock();
+
+        if (!written) {
+            if (running) {
+                ofLogWarning("PipeOutput") << "The reader of " << settings.target << " went away";
+            }
+            connected = false;
+            queue.clear();
+            lock.unlock();
+            disconnect();
+            lock.lock();
+            condition.notify_all();
+            continue;
+        }
+        bytesWritten += buffer->size;
+        buffer->writtenUntil = bytesWritten;
+        numWritten++;
+        condition.notify_all();
+    }
+}
+
+//--------------------------------------------------------------
+bool PipeOutput::connect(size_t& capacity){
+    if (!command) {
+        // Fails until a reader has the FIFO open, instead of blocking like a plain open() would
+        fd = open(settings.target.c_str(), O_WRONLY | O_NONBLOCK);
+    }
+    // A command's stdin is only there once; after it closes nothing reconnects
+    if (fd < 0) {
+        return false;
+    }
+    // Only pipes take vmsplice(); a regular file at the path gets plain writes
+    capacity = 0;
+#ifdef __linux__
+    int pipeSize = fcntl(fd, F_GETPIPE_SZ);
+    if (pipeSize > 0) {
+        capacity = pipeSize;
+    }
+#endif
+    return true;
+}
+
+//--------------------------------------------------------------
+void PipeOutput::disconnect(){
+    if (command) {
+        // pclose() closes it
+        fd = -1;
+        return;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+//--------------------------------------------------------------
+bool PipeOutput::writeBuffer(const Buffer& buffer){
+    size_t offset = 0;
+    while (offset < buffer.size) {
+        ssize_t result;
+#ifdef __linux__
+        if (pipeCapacity > 0) {
+            // Maps the pages into the pipe rather than copying them
+            iovec data = {buffer.data + offset, buffer.size - offset};
+            result = vmsplice(fd, &data, 1, SPLICE_F_NONBLOCK);
+        } else
+#endif
+        {
+            result = ::write(fd, buffer.data + offset, buffer.size - offset);
+        }
+
+        if (result > 0) {
+            offset += result;
+        } else if (result < 0 && (errno == EAGAIN || errno == EINTR)) {
+            // Pipe full: wait for the reader, checking every so often whether we should stop
+            pollfd waiting = {fd, POLLOUT, 0};
+            poll(&waiting, 1, 100);
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!running) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
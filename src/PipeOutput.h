@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ofMain.h"
+#include "FboReadback.h"
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+// Streams an output as raw RGBA video into a FIFO or the stdin of a command, for
+// recording or streaming with ffmpeg and other encoders:
+//
+//   ffmpeg -f rawvideo -pix_fmt rgba -s 1920x1080 -r 30 -i /tmp/sequencestreamer.rgba out.mp4
+//
+// Encoders expect a constant frame rate while the app only redraws outputs when the
+// picture changes, so update() paces the stream itself: every 1/fps seconds it queues
+// the newest picture again. Pictures arrive through an FboReadback and are copied once
+// into page-aligned buffers that a writer thread hands to the pipe with vmsplice() on
+// Linux, which maps them into the pipe instead of copying, and with write() elsewhere.
+//
+// A consumer that can't keep up fills the queue. With DROP the render thread then
+// skips frames and counts them. With BLOCK it waits for room once per update(), so no
+// picture is lost and the app slows down to the consumer's pace; repeats of the same
+// picture that don't fit after that are left out rather than waited for.
+class PipeOutput {
+public:
+	enum Policy {
+		DROP,
+		BLOCK,
+	};
+
+	struct Settings {
+		string target = "/tmp/sequencestreamer.rgba";  // FIFO (created if missing), or "|command" to run with the video on its stdin
+		Policy policy = DROP;
+		float fps = 30;       // Frames per second written, whatever the app draws at
+		int queueSize = 3;    // Frames waiting for the consumer before the policy applies
+	};
+
+	~PipeOutput();
+
+	// --pipe <fifo or |command> [--pipe-fps N] [--pipe-block]; false if --pipe isn't there
+	static bool parseArguments(const vector<string>& arguments, Settings& settings);
+
+	bool setup(const Settings& settings);
+	void close();
+	bool isOpen() const { return running; }
+	const Settings& getSettings() const { return settings; }
+	void setPolicy(Policy policy);
+
+	// A new picture of the output; frames carry it from the next update() on
+	void publish(const ofFbo& fbo);
+	// Call every frame, from the GL thread
+	void update();
+
+	uint64_t getNumWritten();
+	uint64_t getNumDropped();
+	bool isConnected();  // A consumer has the FIFO open
+
+private:
+	struct Buffer {
+		unsigned char* data = nullptr;
+		size_t capacity = 0;
+		size_t size = 0;            // Bytes of the picture in it
+		uint64_t writtenUntil = 0;  // Stream position after the last write of this buffer, 0 if never written
+		~Buffer();
+	};
+
+	void store(const FboReadback::Frame& frame);
+	shared_ptr<Buffer> getFreeBuffer(size_t bytes, std::unique_lock<std::mutex>& lock);
+	// False if the queue is full under BLOCK and canWait isn't set
+	bool enqueue(const shared_ptr<Buffer>& buffer, std::unique_lock<std::mutex>& lock, bool canWait);
+	void writeLoop();
+	bool connect(size_t& capacity);
+	void disconnect();
+	bool writeBuffer(const Buffer& buffer);
+
+	Settings settings;
+	FboReadback readback;
+	FILE* command = nullptr;
+	int fd = -1;
+	size_t pipeCapacity = 0;  // Bytes the kernel holds before the consumer reads them
+
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool running = false;
+	bool connected = false;
+	std::deque<shared_ptr<Buffer>> queue;
+	vector<shared_ptr<Buffer>> buffers;
+	shared_ptr<Buffer> latest;  // Newest picture, repeated until the next one
+	int width = 0;              // Of the stream, fixed by its first picture
+	int height = 0;
+	bool sizeWarned = false;
+	uint64_t bytesWritten = 0;
+	uint64_t numWritten = 0;
+	uint64_t numDropped = 0;
+	uint64_t startTime = 0;
+	uint64_t numQueued = 0;     // Frame slots the pacing has used since startTime
+};
@@ -0,0 +1,612 @@
+#include "PixelConvert.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIXEL_CONVERT_X86 1
+#include <immintrin.h>
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__ARM_NEON)
+#define PIXEL_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+    typedef void (*ExpandKernel)(const uint8_t* src, uint8_t* dst, size_t pixels);
+    typedef void (*NarrowKernel)(const uint16_t* src, uint8_t* dst, size_t samples);
+    typedef void (*PremultiplyKernel)(uint8_t* pixels4, size_t pixels);
+
+    // Colour matrix in 12-bit fixed point; offsets carry the rounding half
+    const int MATRIX_BITS = 12;
+    struct FixedMatrix {
+        int16_t weights[3][3];  // [out channel][r, g, b]
+        int32_t offsets[3];
+    };
+    typedef void (*ColorMatrixKernel)(uint8_t* data, size_t pixels, const FixedMatrix& matrix);
+
+    struct Kernels {
+        ExpandKernel expand[3][2];  // [grey, RGB, RGBA][RGBA, BGRA out]
+        NarrowKernel narrow;
+        PremultiplyKernel premultiply;
+        ColorMatrixKernel colorMatrix[2];  // [RGB, RGBA]
+    };
+
+    // Pixels per pass when several steps run back to back, so each step reads what the
+    // previous one wrote while it is still in cache
+    const size_t CHUNK_PIXELS = 1024;
+
+    //--------------------------------------------------------------
+    // Scalar reference; the SIMD kernels hand their tails to these and must match them exactly
+
+    template<int Channels, bool SwapRedBlue>
+    void expandScalar(const uint8_t* src, uint8_t* dst, size_t pixels) {
+        for (size_t i = 0; i < pixels; i++, src += Channels, dst += 4) {
+            if (Channels == 1) {
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = 255;
+            } else {
+                dst[0] = src[SwapRedBlue ? 2 : 0];
+                dst[1] = src[1];
+                dst[2] = src[SwapRedBlue ? 0 : 2];
+                dst[3] = Channels == 4 ? src[3] : 255;
+            }
+        }
+    }
+
+    void copyPixels(const uint8_t* src, uint8_t* dst, size_t pixels) {
+        memcpy(dst, src, pixels * 4);
+    }
+
+    void narrowScalar(const uint16_t* src, uint8_t* dst, size_t samples) {
+        // round(v / 257) without a division. The SIMD kernels get (v + 128) >> 8 from a
+        // rounding average so nothing overflows 16 bits; the result never exceeds 65407.
+        for (size_t i = 0; i < samples; i++) {
+            dst[i] = (uint8_t)((src[i] - ((src[i] + 128) >> 8) + 128) >> 8);
+        }
+    }
+
+    inline uint8_t multiplyAlpha(uint8_t c, uint8_t a) {
+        // round(c * a / 255), exact for all 8-bit inputs, in 16-bit arithmetic
+        uint16_t t = c * a + 128;
+        return (uint8_t)((t + (t >> 8)) >> 8);
+    }
+
+    void premultiplyScalar(uint8_t* pixels4, size_t pixels) {
+        for (size_t i = 0; i < pixels; i++, pixels4 += 4) {
+            uint8_t a = pixels4[3];
+            pixels4[0] = multiplyAlpha(pixels4[0], a);
+            pixels4[1] = multiplyAlpha(pixels4[1], a);
+            pixels4[2] = multiplyAlpha(pixels4[2], a);
+        }
+    }
+
+    template<int Channels>
+    void colorMatrixScalar(uint8_t* data, size_t pixels, const FixedMatrix& matrix) {
+        for (size_t i = 0; i < pixels; i++, data += Channels) {
+            int r = data[0], g = data[1], b = data[2];
+            for (int c = 0; c < 3; c++) {
+                const int16_t* w = matrix.weights[c];
+                int v = (w[0] * r + w[1] * g + w[2] * b + matrix.offsets[c]) >> MATRIX_BITS;
+                data[c] = (uint8_t)std::min(255, std::max(0, v));
+            }
+        }
+    }
+
+    const Kernels SCALAR_KERNELS = {
+        {{expandScalar<1, false>, expandScalar<1, true>},
+         {expandScalar<3, false>, expandScalar<3, true>},
+         {copyPixels, expandScalar<4, true>}},
+        narrowScalar,
+        premultiplyScalar,
+        {colorMatrixScalar<3>, colorMatrixScalar<4>}
+    };
+
+#ifdef PIXEL_CONVERT_X86
+    //--------------------------------------------------------------
+    // SSE4.1: pshufb does the channel moves, 16-bit lanes the arithmetic
+
+    template<bool SwapRedBlue>
+    TARGET_SSE41 __m128i rgbToFourMask() {
+        return SwapRedBlue ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+                           : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    }
+
+    template<int Channels, bool SwapRedBlue>
+    TARGET_SSE41 void expandSse41(const uint8_t* src, uint8_t* dst, size_t pixels) {
+        const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+        size_t i = 0;
+        if (Channels == 1) {
+            const __m128i masks[4] = {
+                _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+                _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+                _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+                _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1)
+            };
+            for (; i + 16 <= pixels; i += 16) {
+                __m128i grey = _mm_loadu_si128((const __m128i*)(src + i));
+                for (int k = 0; k < 4; k++) {
+                    _mm_storeu_si128((__m128i*)(dst + i * 4 + k * 16), _mm_or_si128(_mm_shuffle_epi8(grey, masks[k]), alpha));
+                }
+            }
+        } else if (Channels == 3) {
+            // 16 pixels are exactly three loads; alignr lines each group of four up at byte 0
+            const __m128i mask = rgbToFourMask<SwapRedBlue>();
+            for (; i + 16 <= pixels; i += 16) {
+                const uint8_t* s = src + i * 3;
+                __m128i a = _mm_loadu_si128((const __m128i*)s);
+                __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+                __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+                __m128i groups[4] = {a, _mm_alignr_epi8(b, a, 12), _mm_alignr_epi8(c, b, 8), _mm_srli_si128(c, 4)};
+                for (int k = 0; k < 4; k++) {
+                    _mm_storeu_si128((__m128i*)(dst + i * 4 + k * 16), _mm_or_si128(_mm_shuffle_epi8(groups[k], mask), alpha));
+                }
+            }
+        } else {
+            const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            for (; i + 4 <= pixels; i += 4) {
+                __m128i rgba = _mm_loadu_si128((const __m128i*)(src + i * 4));
+                _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(rgba, mask));
+            }
+        }
+        expandScalar<Channels, SwapRedBlue>(src + i * Channels, dst + i * 4, pixels - i);
+    }
+
+    TARGET_SSE41 __m128i narrowLanes(__m128i v) {
+        __m128i bias = _mm_srli_epi16(_mm_avg_epu16(v, _mm_set1_epi16(127)), 7);
+        __m128i t = _mm_add_epi16(_mm_sub_epi16(v, bias), _mm_set1_epi16(128));
+        return _mm_srli_epi16(t, 8);
+    }
+
+    TARGET_SSE41 void narrowSse41(const uint16_t* src, uint8_t* dst, size_t samples) {
+        size_t i = 0;
+        for (; i + 16 <= samples; i += 16) {
+            __m128i lo = narrowLanes(_mm_loadu_si128((const __m128i*)(src + i)));
+            __m128i hi = narrowLanes(_mm_loadu_si128((const __m128i*)(src + i + 8)));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+        }
+        narrowScalar(src + i, dst + i, samples - i);
+    }
+
+    TARGET_SSE41 __m128i multiplyAlphaLanes(__m128i colors) {
+        // Two pixels as 16-bit lanes; alpha is spread over the colour lanes and 255 put
+        // in the alpha lane, so alpha comes out unchanged
+        const __m128i spread = _mm_setr_epi8(6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1);
+        const __m128i keepAlpha = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+        __m128i alpha = _mm_or_si128(_mm_shuffle_epi8(colors, spread), keepAlpha);
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(colors, alpha), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    TARGET_SSE41 void premultiplySse41(uint8_t* pixels4, size_t pixels) {
+        size_t i = 0;
+        for (; i + 4 <= pixels; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pixels4 + i * 4));
+            __m128i lo = multiplyAlphaLanes(_mm_cvtepu8_epi16(v));
+            __m128i hi = multiplyAlphaLanes(_mm_unpackhi_epi8(v, _mm_setzero_si128()));
+            _mm_storeu_si128((__m128i*)(pixels4 + i * 4), _mm_packus_epi16(lo, hi));
+        }
+        premultiplyScalar(pixels4 + i * 4, pixels - i);
+    }
+
+    // Four RGBx pixels; madd pairs (r, g) and (b, x) per pixel, hadd finishes the sums so
+    // each channel ends up as four 32-bit lanes in pixel order
+    TARGET_SSE41 __m128i colorMatrixFour(__m128i v, const __m128i rows[3], const __m128i offsets[3], __m128i alpha) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i interleave = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i channels[3];
+        for (int c = 0; c < 3; c++) {
+            __m128i sum = _mm_hadd_epi32(_mm_madd_epi16(lo, rows[c]), _mm_madd_epi16(hi, rows[c]));
+            channels[c] = _mm_srai_epi32(_mm_add_epi32(sum, offsets[c]), MATRIX_BITS);
+        }
+        // The saturating packs clamp to 0-255 like the scalar kernel
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(channels[0], channels[1]), _mm_packs_epi32(channels[2], alpha));
+        return _mm_shuffle_epi8(packed, interleave);
+    }
+
+    template<int Channels>
+    TARGET_SSE41 void colorMatrixSse41(uint8_t* data, size_t pixels, const FixedMatrix& matrix) {
+        __m128i rows[3], offsets[3];
+        for (int c = 0; c < 3; c++) {
+            const int16_t* w = matrix.weights[c];
+            rows[c] = _mm_setr_epi16(w[0], w[1], w[2], 0, w[0], w[1], w[2], 0);
+            offsets[c] = _mm_set1_epi32(matrix.offsets[c]);
+        }
+        size_t i = 0;
+        if (Channels == 4) {
+            for (; i + 4 <= pixels; i += 4) {
+                uint8_t* p = data + i * 4;
+                __m128i v = _mm_loadu_si128((const __m128i*)p);
+                _mm_storeu_si128((__m128i*)p, colorMatrixFour(v, rows, offsets, _mm_srli_epi32(v, 24)));
+            }
+        } else {
+            // Four pixels are 12 bytes; the 4 bytes after them are loaded and written back unchanged
+            const __m128i toFour = rgbToFourMask<false>();
+            const __m128i toThree = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+            const __m128i keep = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1);
+            for (; i + 6 <= pixels; i += 4) {
+                uint8_t* p = data + i * 3;
+                __m128i v = _mm_loadu_si128((const __m128i*)p);
+                __m128i out = colorMatrixFour(_mm_shuffle_epi8(v, toFour), rows, offsets, _mm_setzero_si128());
+                _mm_storeu_si128((__m128i*)p, _mm_blendv_epi8(_mm_shuffle_epi8(out, toThree), v, keep));
+            }
+        }
+        colorMatrixScalar<Channels>(data + i * Channels, pixels - i, matrix);
+    }
+
+    const Kernels SSE41_KERNELS = {
+        {{expandSse41<1, false>, expandSse41<1, true>},
+         {expandSse41<3, false>, expandSse41<3, true>},
+         {copyPixels, expandSse41<4, true>}},
+        narrowSse41,
+        premultiplySse41,
+        {colorMatrixSse41<3>, colorMatrixSse41<4>}
+    };
+
+    //--------------------------------------------------------------
+    // AVX2: the same shuffles on two 128-bit lanes at once
+
+    template<int Channels, bool SwapRedBlue>
+    TARGET_AVX2 void expandAvx2(const uint8_t* src, uint8_t* dst, size_t pixels) {
+        const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+        size_t i = 0;
+        if (Channels == 1) {
+            const __m256i lowMask = _mm256_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+                                                     4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+            const __m256i highMask = _mm256_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1,
+                                                      12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1);
+            for (; i + 16 <= pixels; i += 16) {
+                __m256i grey = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(src + i)));
+                _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(grey, lowMask), alpha));
+                _mm256_storeu_si256((__m256i*)(dst + i * 4 + 32), _mm256_or_si256(_mm256_shuffle_epi8(grey, highMask), alpha));
+            }
+        } else if (Channels == 3) {
+            // Four pixels per lane; the second load starts 12 bytes in and reads 4 bytes past them
+            const __m256i mask = _mm256_broadcastsi128_si256(rgbToFourMask<SwapRedBlue>());
+            for (; i + 10 <= pixels; i += 8) {
+                const uint8_t* s = src + i * 3;
+                __m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)s)),
+                                                      _mm_loadu_si128((const __m128i*)(s + 12)), 1);
+                _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(rgb, mask), alpha));
+            }
+        } else {
+            const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                                  2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            for (; i + 8 <= pixels; i += 8) {
+                __m256i rgba = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+                _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(rgba, mask));
+            }
+        }
+        expandScalar<Channels, SwapRedBlue>(src + i * Channels, dst + i * 4, pixels - i);
+    }
+
+    TARGET_AVX2 __m256i narrowLanes256(__m256i v) {
+        __m256i bias = _mm256_srli_epi16(_mm256_avg_epu16(v, _mm256_set1_epi16(127)), 7);
+        __m256i t = _mm256_add_epi16(_mm256_sub_epi16(v, bias), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(t, 8);
+    }
+
+    TARGET_AVX2 void narrowAvx2(const uint16_t* src, uint8_t* dst, size_t samples) {
+        size_t i = 0;
+        for (; i + 32 <= samples; i += 32) {
+            __m256i lo = narrowLanes256(_mm256_loadu_si256((const __m256i*)(src + i)));
+            __m256i hi = narrowLanes256(_mm256_loadu_si256((const __m256i*)(src + i + 16)));
+            // packus works per lane; put the quarters back in order
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+            _mm256_storeu_si256((__m256i*)(dst + i), packed);
+        }
+        narrowScalar(src + i, dst + i, samples - i);
+    }
+
+    TARGET_AVX2 __m256i multiplyAlphaLanes256(__m256i colors) {
+        const __m256i spread = _mm256_setr_epi8(6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1,
+                                                6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1);
+        const __m256i keepAlpha = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+        __m256i alpha = _mm256_or_si256(_mm256_shuffle_epi8(colors, spread), keepAlpha);
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(colors, alpha), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    TARGET_AVX2 void premultiplyAvx2(uint8_t* pixels4, size_t pixels) {
+        size_t i = 0;
+        for (; i + 8 <= pixels; i += 8) {
+            uint8_t* p = pixels4 + i * 4;
+            __m256i lo = multiplyAlphaLanes256(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p)));
+            __m256i hi = multiplyAlphaLanes256(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + 16))));
+            _mm256_storeu_si256((__m256i*)p, _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+        }
+        premultiplyScalar(pixels4 + i * 4, pixels - i);
+    }
+
+    TARGET_AVX2 void colorMatrixAvx2(uint8_t* data, size_t pixels, const FixedMatrix& matrix) {
+        // Everything stays within 128-bit lanes, so this is the SSE4.1 kernel on eight pixels
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i interleave = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+                                                    0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        __m256i rows[3], offsets[3];
+        for (int c = 0; c < 3; c++) {
+            const int16_t* w = matrix.weights[c];
+            rows[c] = _mm256_setr_epi16(w[0], w[1], w[2], 0, w[0], w[1], w[2], 0, w[0], w[1], w[2], 0, w[0], w[1], w[2], 0);
+            offsets[c] = _mm256_set1_epi32(matrix.offsets[c]);
+        }
+        size_t i = 0;
+        for (; i + 8 <= pixels; i += 8) {
+            uint8_t* p = data + i * 4;
+            __m256i v = _mm256_loadu_si256((const __m256i*)p);
+            __m256i lo = _mm256_unpacklo_epi8(v, zero);
+            __m256i hi = _mm256_unpackhi_epi8(v, zero);
+            __m256i channels[3];
+            for (int c = 0; c < 3; c++) {
+                __m256i sum = _mm256_hadd_epi32(_mm256_madd_epi16(lo, rows[c]), _mm256_madd_epi16(hi, rows[c]));
+                channels[c] = _mm256_srai_epi32(_mm256_add_epi32(sum, offsets[c]), MATRIX_BITS);
+            }
+            __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(channels[0], channels[1]),
+                                                 _mm256_packs_epi32(channels[2], _mm256_srli_epi32(v, 24)));
+            _mm256_storeu_si256((__m256i*)p, _mm256_shuffle_epi8(packed, interleave));
+        }
+        colorMatrixSse41<4>(data + i * 4, pixels - i, matrix);
+    }
+
+    const Kernels AVX2_KERNELS = {
+        {{expandAvx2<1, false>, expandAvx2<1, true>},
+         {expandAvx2<3, false>, expandAvx2<3, true>},
+         {copyPixels, expandAvx2<4, true>}},
+        narrowAvx2,
+        premultiplyAvx2,
+        {colorMatrixSse41<3>, colorMatrixAvx2}  // RGB needs 12-byte groups, which don't fill a 256-bit lane pair
+    };
+#endif
+
+#ifdef PIXEL_CONVERT_NEON
+    //--------------------------------------------------------------
+    // NEON: structured loads and stores split and join the channels for free
+
+    template<int Channels, bool SwapRedBlue>
+    void expandNeon(const uint8_t* src, uint8_t* dst, size_t pixels) {
+        size_t i = 0;
+        for (; i + 16 <= pixels; i += 16) {
+            uint8x16x4_t out;
+            if (Channels == 1) {
+                uint8x16_t grey = vld1q_u8(src + i);
+                out.val[0] = out.val[1] = out.val[2] = grey;
+                out.val[3] = vdupq_n_u8(255);
+            } else if (Channels == 3) {
+                uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+                out.val[0] = rgb.val[SwapRedBlue ? 2 : 0];
+                out.val[1] = rgb.val[1];
+                out.val[2] = rgb.val[SwapRedBlue ? 0 : 2];
+                out.val[3] = vdupq_n_u8(255);
+            } else {
+                uint8x16x4_t rgba = vld4q_u8(src + i * 4);
+                out.val[0] = rgba.val[SwapRedBlue ? 2 : 0];
+                out.val[1] = rgba.val[1];
+                out.val[2] = rgba.val[SwapRedBlue ? 0 : 2];
+                out.val[3] = rgba.val[3];
+            }
+            vst4q_u8(dst + i * 4, out);
+        }
+        expandScalar<Channels, SwapRedBlue>(src + i * Channels, dst + i * 4, pixels - i);
+    }
+
+    inline uint8x8_t narrowLanesNeon(uint16x8_t v) {
+        uint16x8_t bias = vshrq_n_u16(vrhaddq_u16(v, vdupq_n_u16(127)), 7);
+        uint16x8_t t = vaddq_u16(vsubq_u16(v, bias), vdupq_n_u16(128));
+        return vshrn_n_u16(t, 8);
+    }
+
+    void narrowNeon(const uint16_t* src, uint8_t* dst, size_t samples) {
+        size_t i = 0;
+        for (; i + 16 <= samples; i += 16) {
+            vst1q_u8(dst + i, vcombine_u8(narrowLanesNeon(vld1q_u16(src + i)), narrowLanesNeon(vld1q_u16(src + i + 8))));
+        }
+        narrowScalar(src + i, dst + i, samples - i);
+    }
+
+    inline uint8x8_t multiplyAlphaNeon(uint8x8_t c, uint8x8_t a) {
+        uint16x8_t t = vaddq_u16(vmull_u8(c, a), vdupq_n_u16(128));
+        return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+    }
+
+    void premultiplyNeon(uint8_t* pixels4, size_t pixels) {
+        size_t i = 0;
+        for (; i + 8 <= pixels; i += 8) {
+            uint8x8x4_t v = vld4_u8(pixels4 + i * 4);
+            v.val[0] = multiplyAlphaNeon(v.val[0], v.val[3]);
+            v.val[1] = multiplyAlphaNeon(v.val[1], v.val[3]);
+            v.val[2] = multiplyAlphaNeon(v.val[2], v.val[3]);
+            vst4_u8(pixels4 + i * 4, v);
+        }
+        premultiplyScalar(pixels4 + i * 4, pixels - i);
+    }
+
+    inline void colorMatrixNeonEight(const uint8x8_t in[3], uint8x8_t out[3], const FixedMatrix& matrix) {
+        int16x8_t rgb[3];
+        for (int c = 0; c < 3; c++) {
+            rgb[c] = vreinterpretq_s16_u16(vmovl_u8(in[c]));
+        }
+        for (int c = 0; c < 3; c++) {
+            const int16_t* w = matrix.weights[c];
+            int32x4_t lo = vdupq_n_s32(matrix.offsets[c]);
+            int32x4_t hi = lo;
+            for (int k = 0; k < 3; k++) {
+                lo = vmlal_n_s16(lo, vget_low_s16(rgb[k]), w[k]);
+                hi = vmlal_n_s16(hi, vget_high_s16(rgb[k]), w[k]);
+            }
+            int16x8_t v = vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, MATRIX_BITS)), vqmovn_s32(vshrq_n_s32(hi, MATRIX_BITS)));
+            out[c] = vqmovun_s16(v);
+        }
+    }
+
+    template<int Channels>
+    void colorMatrixNeon(uint8_t* data, size_t pixels, const FixedMatrix& matrix) {
+        size_t i = 0;
+        for (; i + 8 <= pixels; i += 8) {
+            uint8_t* p = data + i * Channels;
+            uint8x8_t in[3], out[3];
+            if (Channels == 4) {
+                uint8x8x4_t v = vld4_u8(p);
+                in[0] = v.val[0]; in[1] = v.val[1]; in[2] = v.val[2];
+                colorMatrixNeonEight(in, out, matrix);
+                v.val[0] = out[0]; v.val[1] = out[1]; v.val[2] = out[2];
+                vst4_u8(p, v);
+            } else {
+                uint8x8x3_t v = vld3_u8(p);
+                in[0] = v.val[0]; in[1] = v.val[1]; in[2] = v.val[2];
+                colorMatrixNeonEight(in, out, matrix);
+                v.val[0] = out[0]; v.val[1] = out[1]; v.val[2] = out[2];
+                vst3_u8(p, v);
+            }
+        }
+        colorMatrixScalar<Channels>(data + i * Channels, pixels - i, matrix);
+    }
+
+    const Kernels NEON_KERNELS = {
+        {{expandNeon<1, false>, expandNeon<1, true>},
+         {expandNeon<3, false>, expandNeon<3, true>},
+         {copyPixels, expandNeon<4, true>}},
+        narrowNeon,
+        premultiplyNeon,
+        {colorMatrixNeon<3>, colorMatrixNeon<4>}
+    };
+#endif
+
+    //--------------------------------------------------------------
+    PixelConvert::Implementation detectBest() {
+#ifdef PIXEL_CONVERT_X86
+        // Runs from a static initializer, possibly before the compiler runtime has read cpuid
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return PixelConvert::AVX2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return PixelConvert::SSE41;
+        }
+#endif
+#ifdef PIXEL_CONVERT_NEON
+        return PixelConvert::NEON;
+#endif
+        return PixelConvert::SCALAR;
+    }
+
+    std::atomic<int> currentImplementation{detectBest()};
+
+    const Kernels& getKernels() {
+        switch (currentImplementation.load(std::memory_order_relaxed)) {
+#ifdef PIXEL_CONVERT_X86
+            case PixelConvert::SSE41: return SSE41_KERNELS;
+            case PixelConvert::AVX2: return AVX2_KERNELS;
+#endif
+#ifdef PIXEL_CONVERT_NEON
+            case PixelConvert::NEON: return NEON_KERNELS;
+#endif
+            default: return SCALAR_KERNELS;
+        }
+    }
+
+    int getChannelIndex(int channels) {
+        return channels == 1 ? 0 : channels == 3 ? 1 : channels == 4 ? 2 : -1;
+    }
+}
+
+//--------------------------------------------------------------
+void PixelConvert::toFourChannels(const uint8_t* src, int channels, uint8_t* dst, size_t pixels, Layout layout, bool premultiply){
+    int channelIndex = getChannelIndex(channels);
+    if (channelIndex < 0) {
+        return;
+    }
+    const Kernels& kernels = getKernels();
+    ExpandKernel expand = kernels.expand[channelIndex][layout == BGRA];
+    if (!premultiply) {
+        expand(src, dst, pixels);
+        return;
+    }
+    for (size_t i = 0; i < pixels; i += CHUNK_PIXELS) {
+        size_t count = std::min(CHUNK_PIXELS, pixels - i);
+        expand(src + i * channels, dst + i * 4, count);
+        kernels.premultiply(dst + i * 4, count);
+    }
+}
+
+//--------------------------------------------------------------
+void PixelConvert::toFourChannels(const uint16_t* src, int channels, uint8_t* dst, size_t pixels, Layout layout, bool premultiply){
+    int channelIndex = getChannelIndex(channels);
+    if (channelIndex < 0) {
+        return;
+    }
+    const Kernels& kernels = getKernels();
+    ExpandKernel expand = kernels.expand[channelIndex][layout == BGRA];
+    uint8_t narrowed[CHUNK_PIXELS * 4];
+    for (size_t i = 0; i < pixels; i += CHUNK_PIXELS) {
+        size_t count = std::min(CHUNK_PIXELS, pixels - i);
+        kernels.narrow(src + i * channels, narrowed, count * channels);
+        expand(narrowed, dst + i * 4, count);
+        if (premultiply) {
+            kernels.premultiply(dst + i * 4, count);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void PixelConvert::narrow(const uint16_t* src, uint8_t* dst, size_t samples){
+    getKernels().narrow(src, dst, samples);
+}
+
+//--------------------------------------------------------------
+void PixelConvert::premultiply(uint8_t* pixels4, size_t pixels){
+    getKernels().premultiply(pixels4, pixels);
+}
+
+//--------------------------------------------------------------
+void PixelConvert::colorMatrix(uint8_t* data, int channels, size_t pixels, const float matrix[12]){
+    if (channels != 3 && channels != 4) {
+        return;
+    }
+    const float one = 1 << MATRIX_BITS;
+    FixedMatrix fixed;
+    for (int c = 0; c < 3; c++) {
+        for (int k = 0; k < 3; k++) {
+            fixed.weights[c][k] = (int16_t)std::lround(std::min(7.99f, std::max(-7.99f, matrix[c * 4 + k])) * one);
+        }
+        fixed.offsets[c] = (int32_t)std::lround(matrix[c * 4 + 3] * one) + (1 << (MATRIX_BITS - 1));
+    }
+    getKernels().colorMatrix[channels == 4](data, pixels, fixed);
+}
+
+//--------------------------------------------------------------
+PixelConvert::Implementation PixelConvert::getImplementation(){
+    return (Implementation)currentImplementation.load();
+}
+
+//--------------------------------------------------------------
+bool PixelConvert::setImplementation(Implementation implementation){
+    if (!isAvailable(implementation)) {
+        return false;
+    }
+    currentImplementation = implementation;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool PixelConvert::isAvailable(Implementation implementation){
+    switch (implementation) {
+        case SCALAR: return true;
+#ifdef PIXEL_CONVERT_X86
+        case SSE41: return __builtin_cpu_supports("sse4.1");
+        case AVX2: return __builtin_cpu_supports("avx2");
+#endif
+#ifdef PIXEL_CONVERT_NEON
+        case NEON: return true;
+#endif
+        default: return false;
+    }
+}
+
+//--------------------------------------------------------------
+const char* PixelConvert::getName(Implementation implementation){
+    static const char* names[] = {"scalar", "sse4.1", "avx2", "neon"};
+    return names[implementation];
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Pixel format conversion for frames on their way to the GPU: grey/RGB/RGBA to
+// four channel RGBA or BGRA, 16 to 8 bits per sample with rounding, and alpha
+// premultiplication, plus the colour matrix behind ColorAdjust's CPU path. Kernels are specialized at compile time per channel count
+// and sample size, with SSE4.1, AVX2 and NEON versions chosen at runtime and a
+// scalar fallback they are bit-exact with. No openFrameworks dependency.
+class PixelConvert {
+public:
+	enum Implementation {
+		SCALAR,
+		SSE41,
+		AVX2,
+		NEON
+	};
+
+	enum Layout {
+		RGBA,
+		BGRA  // the layout macOS drivers upload without a conversion of their own
+	};
+
+	// src holds pixels * channels samples (1 = grey, 3 = RGB, 4 = RGBA); dst gets
+	// pixels * 4 bytes in layout. 16-bit samples are rounded to the nearest 8-bit value.
+	static void toFourChannels(const uint8_t* src, int channels, uint8_t* dst, size_t pixels, Layout layout, bool premultiply = false);
+	static void toFourChannels(const uint16_t* src, int channels, uint8_t* dst, size_t pixels, Layout layout, bool premultiply = false);
+
+	// 16 to 8 bits per sample, keeping the channel layout: round(v * 255 / 65535)
+	static void narrow(const uint16_t* src, uint8_t* dst, size_t samples);
+
+	// Multiplies the colour channels of RGBA or BGRA pixels by their alpha, rounding
+	static void premultiply(uint8_t* pixels4, size_t pixels);
+
+	// In place on 3 or 4 channel pixels: each colour channel becomes its row of the
+	// row-major 3x4 matrix applied to (r, g, b, 1), offsets in 0-255 units, clamped to
+	// 0-255. Alpha is left alone. Weights are rounded to 1/4096 and must lie within +-7.99.
+	static void colorMatrix(uint8_t* data, int channels, size_t pixels, const float matrix[12]);
+
+	// Best available on this CPU unless overridden; set() ignores unavailable ones
+	static Implementation getImplementation();
+	static bool setImplementation(Implementation implementation);
+	static bool isAvailable(Implementation implementation);
+	static const char* getName(Implementation implementation);
+};
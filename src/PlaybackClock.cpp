@@ -0,0 +1,58 @@
+#include "PlaybackClock.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // How close elapsed time has to be to a whole number of refreshes to count as one
+    const double SNAP_TOLERANCE = 0.25;
+    
+    // Update intervals longer than this are hitches, not the refresh rate
+    const double MAX_REFRESH_PERIOD = 0.1;
+    
+    // If frames stay unavailable for longer than this, give up on catching up
+    const double MAX_LAG_SECONDS = 0.5;
+    
+    // Owed frames are a sum of floating point intervals; a whole frame that comes out as
+    // 0.9999999 must still count, or it shows a refresh late
+    const double FRAME_EPSILON = 1e-6;
+}
+
+//--------------------------------------------------------------
+void PlaybackClock::reset(double now){
+    lastUpdate = now;
+    clockTime = now;
+    owedFrames = 0;
+}
+
+//--------------------------------------------------------------
+int PlaybackClock::update(double now, double framesPerSecond){
+    if (lastUpdate < 0) {
+        reset(now);
+    }
+    
+    // Learn the refresh period from the update interval
+    double interval = now - lastUpdate;
+    lastUpdate = now;
+    if (interval > 0 && interval < MAX_REFRESH_PERIOD) {
+        refreshPeriod = refreshPeriod * 0.95 + interval * 0.05;
+    }
+    
+    // With vsync a frame appears on a refresh boundary, so count whole refreshes.
+    // Rounding is done against the clock's own time, never against the last
+    // update, so rounding errors can't accumulate into drift.
+    double elapsed = now - clockTime;
+    double refreshes = std::round(elapsed / refreshPeriod);
+    if (refreshes >= 0 && std::fabs(elapsed - refreshes * refreshPeriod) < refreshPeriod * SNAP_TOLERANCE) {
+        elapsed = refreshes * refreshPeriod;
+    }
+    clockTime += elapsed;
+    
+    owedFrames += elapsed * framesPerSecond;
+    owedFrames = std::min(owedFrames, std::max(1.0, framesPerSecond * MAX_LAG_SECONDS));
+    return std::max(0, (int)(owedFrames + FRAME_EPSILON));
+}
+
+//--------------------------------------------------------------
+void PlaybackClock::consume(int frames){
+    owedFrames = std::max(0.0, owedFrames - frames);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Decides how many source frames playback moves on each display refresh.
+//
+// Elapsed time is converted to source frames in a fractional accumulator, so
+// overshoot of the render loop is never lost and speeds above the display rate
+// skip frames instead of slowing down: 4x of a 30 fps sequence on a 60 Hz
+// output advances two frames per refresh. Update timing jitters around the
+// vsync interval, so elapsed time is counted in whole refreshes while it stays
+// close to them; the clock follows real time and resyncs if it drifts away.
+class PlaybackClock {
+public:
+	// Start counting from now, forgetting any frames owed
+	void reset(double now);
+	
+	// Fix the refresh period instead of learning it, for a known output rate such as
+	// an offline render stepping a virtual clock
+	void setRefreshPeriod(double seconds) { refreshPeriod = seconds; }
+	
+	// Call once per update while playing. Returns the whole number of frames
+	// owed since the last shown frame; the fraction carries over.
+	int update(double now, double framesPerSecond);
+	
+	// The owed frames were shown; frames that couldn't be shown yet stay owed
+	void consume(int frames);
+	
+	// Frames owed including the fraction, for predicting the next frames
+	double getOwedFrames() const { return owedFrames; }
+	
+	// Source frames per display refresh at this speed
+	double getFramesPerRefresh(double framesPerSecond) const { return framesPerSecond * refreshPeriod; }
+	
+	double getRefreshPeriod() const { return refreshPeriod; }
+	
+private:
+	double refreshPeriod = 1.0 / 60.0;  // learned from the update interval
+	double lastUpdate = -1;
+	double clockTime = 0;    // now, rounded to whole refreshes
+	double owedFrames = 0;
+};
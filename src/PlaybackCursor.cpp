@@ -0,0 +1,51 @@
+#include "PlaybackCursor.h"
+#include <algorithm>
+
+//--------------------------------------------------------------
+void PlaybackCursor::step(){
+    if (direction == FORWARD) {
+        index++;
+        
+        // Handle reaching the end based on loop mode
+        if (index > rangeEnd) {
+            if (loopMode == LOOP) {
+                index = rangeStart;
+            } else if (loopMode == PING_PONG) {
+                index = rangeEnd - 1;
+                if (index < rangeStart) index = rangeStart;
+                direction = BACKWARD;
+            }
+        }
+    } else { // BACKWARD
+        index--;
+        
+        // Handle reaching the start based on loop mode
+        if (index < rangeStart) {
+            if (loopMode == LOOP) {
+                index = rangeEnd;
+            } else if (loopMode == PING_PONG) {
+                index = rangeStart + 1;
+                if (index > rangeEnd) index = rangeEnd;
+                direction = FORWARD;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void PlaybackCursor::step(int frames){
+    for (int i = 0; i < frames; i++) {
+        step();
+    }
+}
+
+//--------------------------------------------------------------
+void PlaybackCursor::stepShown(){
+    // Same arithmetic as PlaybackClock, one refresh at a time. Below one frame
+    // per refresh every frame is shown, so always move at least one; frames are
+    // skipped in whole frameSteps.
+    phase += stride;
+    int frames = std::max(frameStep, (int)phase / frameStep * frameStep);
+    phase = std::max(0.0, phase - frames);
+    step(frames);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Playback direction enum
+enum Direction {
+	FORWARD,
+	BACKWARD
+};
+
+// Loop mode enum
+enum LoopMode {
+	LOOP,
+	PING_PONG
+};
+
+// Playhead position plus the rules that move it through the active frame range.
+// Shared by ofApp::update() and the prefetcher so both walk the sequence the same way.
+struct PlaybackCursor {
+	int index = 0;
+	Direction direction = FORWARD;
+	LoopMode loopMode = LOOP;
+	int rangeStart = 0;
+	int rangeEnd = 0;
+	
+	// Playback clock state, so the prefetcher can predict which frames get shown
+	double stride = 1;  // source frames per display refresh
+	double phase = 0;   // frames already owed towards the next one
+	int frameStep = 1;  // only every frameStep-th frame is shown (see QualityGovernor)
+	
+	// Move one frame along the current direction, wrapping (LOOP) or
+	// bouncing (PING_PONG) when stepping past rangeStart/rangeEnd
+	void step();
+	void step(int frames);
+	
+	// Move to the next frame the clock will show, skipping the ones it won't
+	void stepShown();
+};
@@ -0,0 +1,340 @@
+#include "ProxyCache.h"
+#include "ScaledJpegDecoder.h"
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <dirent.h>
+
+namespace {
+    const int INITIAL_PASS_STRIDE = 64;
+    
+    int64_t getModifiedTime(const string& path) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return -1;
+        }
+        return info.st_mtime;
+    }
+}
+
+//--------------------------------------------------------------
+ProxyCache::~ProxyCache(){
+    close();
+}
+
+//--------------------------------------------------------------
+const vector<int>& ProxyCache::getLevels(){
+    static const vector<int> levels = {64, 160, 320, 640};
+    return levels;
+}
+
+//--------------------------------------------------------------
+void ProxyCache::setup(){
+    if (!isThreadRunning()) {
+        startThread();
+    }
+}
+
+//--------------------------------------------------------------
+void ProxyCache::close(){
+    if (isThreadRunning()) {
+        {
+            // Under the lock so the stop can't land between the thread's check and its wait
+            std::unique_lock<std::mutex> lock(mutex);
+            stopThread();
+            condition.notify_all();
+        }
+        waitForThread(false);
+    }
+}
+
+//--------------------------------------------------------------
+void ProxyCache::setFrameList(const string& directory, shared_ptr<const FrameList> newFrameList){
+    // One cache folder per source directory, named after a hash of its path
+    std::stringstream folder;
+    folder << std::hex << std::hash<string>()(directory);
+    string newCacheDirectory = ofToDataPath("proxies/" + folder.str(), true);
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    if (newCacheDirectory != cacheDirectory) {
+        cacheDirectory = newCacheDirectory;
+        ready.clear();
+        failed.clear();
+        for (int level : getLevels()) {
+            ofDirectory::createDirectory(ofFilePath::join(cacheDirectory, ofToString(level)), false, true);
+        }
+        // The folder's mtime says when its sequence was last opened, for evictToBudget()
+        utimes(cacheDirectory.c_str(), nullptr);
+        evictPending = true;
+    } else if (frameList && newFrameList && frameList->getReplacedCount() != newFrameList->getReplacedCount()) {
+        // Some frame was rewritten; recheck every proxy against its source's mtime
+        ready.clear();
+        failed.clear();
+    }
+    frameList = newFrameList;
+    requests.clear();
+    passStride = INITIAL_PASS_STRIDE;
+    passPosition = 0;
+    condition.notify_all();
+}
+
+//--------------------------------------------------------------
+void ProxyCache::setDiskBudget(uint64_t bytes){
+    std::unique_lock<std::mutex> lock(mutex);
+    if (bytes != diskBudget) {
+        diskBudget = bytes;
+        evictPending = true;
+        condition.notify_all();
+    }
+}
+
+//--------------------------------------------------------------
+uint64_t ProxyCache::getDiskBudget(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return diskBudget;
+}
+
+//--------------------------------------------------------------
+void ProxyCache::setPaused(bool newPaused){
+    std::unique_lock<std::mutex> lock(mutex);
+    if (newPaused != paused) {
+        paused = newPaused;
+        condition.notify_all();
+    }
+}
+
+//--------------------------------------------------------------
+void ProxyCache::request(int index){
+    std::unique_lock<std::mutex> lock(mutex);
+    if (index < 0 || index >= getNumPaths() || ready.count(frameList->getPath(index)) || failed.count(frameList->getPath(index))) {
+        return;
+    }
+    // Latest request first; the user has probably moved past older ones
+    requests.push_front(index);
+    condition.notify_all();
+}
+
+//--------------------------------------------------------------
+string ProxyCache::getLevelPath(const string& directory, int level, const string& sourcePath){
+    return ofFilePath::join(ofFilePath::join(directory, ofToString(level)),
+                            ofFilePath::getFileName(sourcePath) + ".jpg");
+}
+
+//--------------------------------------------------------------
+string ProxyCache::getProxyPath(int index, int width){
+    std::unique_lock<std::mutex> lock(mutex);
+    if (index < 0 || index >= getNumPaths() || !ready.count(frameList->getPath(index))) {
+        return "";
+    }
+    
+    const vector<int>& levels = getLevels();
+    int level = levels.back();
+    for (int candidate : levels) {
+        if (candidate >= width) {
+            level = candidate;
+            break;
+        }
+    }
+    return getLevelPath(cacheDirectory, level, frameList->getPath(index));
+}
+
+//--------------------------------------------------------------
+int ProxyCache::findNearestReady(int index, int maxDistance){
+    std::unique_lock<std::mutex> lock(mutex);
+    for (int distance = 0; distance <= maxDistance; distance++) {
+        int before = index - distance;
+        int after = index + distance;
+        if (before >= 0 && before < getNumPaths() && ready.count(frameList->getPath(before))) {
+            return before;
+        }
+        if (after >= 0 && after < getNumPaths() && ready.count(frameList->getPath(after))) {
+            return after;
+        }
+    }
+    return -1;
+}
+
+//--------------------------------------------------------------
+float ProxyCache::getProgress(){
+    std::unique_lock<std::mutex> lock(mutex);
+    if (getNumPaths() == 0) {
+        return 0;
+    }
+    return std::min(1.0f, ready.size() / (float)getNumPaths());
+}
+
+//--------------------------------------------------------------
+bool ProxyCache::nextFrameToBuild(int& index){
+    while (!requests.empty()) {
+        index = requests.front();
+        requests.pop_front();
+        if (index < getNumPaths() && !ready.count(frameList->getPath(index)) && !failed.count(frameList->getPath(index))) {
+            return true;
+        }
+    }
+    
+    // Background pass: every 64th frame, then every 32nd, ... down to every frame
+    while (passStride > 0 && !paused) {
+        while (passPosition < getNumPaths()) {
+            index = passPosition;
+            passPosition += passStride;
+            if (!ready.count(frameList->getPath(index)) && !failed.count(frameList->getPath(index))) {
+                return true;
+            }
+        }
+        passStride /= 2;
+        passPosition = passStride;
+    }
+    return false;
+}
+
+//--------------------------------------------------------------
+bool ProxyCache::buildProxies(const string& directory, const string& sourcePath){
+    const vector<int>& levels = getLevels();
+    
+    // Proxies newer than the source are still valid
+    int64_t sourceTime = getModifiedTime(sourcePath);
+    bool upToDate = true;
+    for (int level : levels) {
+        if (getModifiedTime(getLevelPath(directory, level, sourcePath)) < sourceTime) {
+            upToDate = false;
+            break;
+        }
+    }
+    if (upToDate) {
+        return true;
+    }
+    
+    // JPEG sources are decoded only down to the largest proxy size when libjpeg-turbo is there
+    ofPixels pixels;
+    ofBuffer buffer = ofBufferFromFile(sourcePath, true);
+    if (!ScaledJpegDecoder::decode(buffer, pixels, levels.back(), 0) && !ofLoadImage(pixels, buffer)) {
+        ofLogWarning("ProxyCache") << "Could not decode " << sourcePath;
+        return false;
+    }
+    
+    // Walk down the pyramid, halving at most each step so the bicubic resize doesn't alias
+    for (int i = levels.size() - 1; i >= 0; i--) {
+        int width = levels[i];
+        while (pixels.getWidth() / 2 > width) {
+            pixels.resize(pixels.getWidth() / 2, std::max<size_t>(1, pixels.getHeight() / 2), OF_INTERPOLATE_BICUBIC);
+        }
+        if (pixels.getWidth() > width) {
+            int height = std::max(1, (int)round(pixels.getHeight() * width / (float)pixels.getWidth()));
+            pixels.resize(width, height, OF_INTERPOLATE_BICUBIC);
+        }
+        
+        // Write to a temp name first so a scrub never reads a half-written proxy
+        string path = getLevelPath(directory, width, sourcePath);
+        string tempPath = path + ".tmp.jpg";
+        if (!ofSaveImage(pixels, tempPath, OF_IMAGE_QUALITY_MEDIUM) || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            ofLogWarning("ProxyCache") << "Could not write proxy " << path;
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+uint64_t ProxyCache::getFolderSize(const string& directory){
+    uint64_t bytes = 0;
+    for (int level : getLevels()) {
+        string levelDirectory = ofFilePath::join(directory, ofToString(level));
+        DIR* dir = opendir(levelDirectory.c_str());
+        if (!dir) {
+            continue;
+        }
+        while (dirent* entry = readdir(dir)) {
+            struct stat info;
+            if (entry->d_name[0] != '.' && stat(ofFilePath::join(levelDirectory, entry->d_name).c_str(), &info) == 0) {
+                bytes += info.st_size;
+            }
+        }
+        closedir(dir);
+    }
+    return bytes;
+}
+
+//--------------------------------------------------------------
+void ProxyCache::evictToBudget(const string& keepDirectory, uint64_t budget){
+    struct Folder {
+        string path;
+        int64_t time;
+        uint64_t bytes;
+    };
+    vector<Folder> folders;
+    uint64_t total = 0;
+    
+    string root = ofFilePath::getEnclosingDirectory(keepDirectory, false);
+    DIR* dir = opendir(root.c_str());
+    if (!dir) {
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        string path = ofFilePath::join(root, entry->d_name);
+        struct stat info;
+        if (entry->d_name[0] == '.' || stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+            continue;
+        }
+        folders.push_back({path, (int64_t)info.st_mtime, getFolderSize(path)});
+        total += folders.back().bytes;
+    }
+    closedir(dir);
+    
+    // Least recently opened first
+    std::sort(folders.begin(), folders.end(), [](const Folder& a, const Folder& b) {
+        return a.time < b.time;
+    });
+    string keepName = ofFilePath::getFileName(keepDirectory);
+    for (const Folder& folder : folders) {
+        if (total <= budget) {
+            break;
+        }
+        if (ofFilePath::getFileName(folder.path) == keepName) {
+            continue;
+        }
+        if (ofDirectory::removeDirectory(folder.path, true, false)) {
+            ofLogNotice("ProxyCache") << "Deleted proxies in " << folder.path << " (" << folder.bytes / (1024 * 1024) << " MB) to stay under the disk budget";
+            total -= folder.bytes;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void ProxyCache::threadedFunction(){
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    while (isThreadRunning()) {
+        if (evictPending && !cacheDirectory.empty()) {
+            evictPending = false;
+            string keepDirectory = cacheDirectory;
+            uint64_t budget = diskBudget;
+            lock.unlock();
+            evictToBudget(keepDirectory, budget);
+            lock.lock();
+            continue;
+        }
+        
+        int index;
+        if (!nextFrameToBuild(index)) {
+            condition.wait(lock);
+            continue;
+        }
+        
+        string sourcePath = frameList->getPath(index);
+        string buildDirectory = cacheDirectory;
+        
+        lock.unlock();
+        bool built = buildProxies(buildDirectory, sourcePath);
+        lock.lock();
+        
+        // Results for a directory we've since moved away from are dropped
+        if (buildDirectory != cacheDirectory) {
+            continue;
+        }
+        if (built) {
+            ready.insert(sourcePath);
+        } else {
+            failed.insert(sourcePath);
+        }
+    }
+}
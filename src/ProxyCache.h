@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ofMain.h"
+#include <deque>
+#include <unordered_set>
+#include "FrameList.h"
+
+// Downscaled copies of every frame used while scrubbing.
+// A background thread decodes each source frame once and writes JPEG proxies
+// at every pyramid level (64/160/320/640 px wide) into a per-sequence cache dir
+// under data/proxies. Frames are built coarse to fine (every 64th frame first,
+// then every 32nd, ...) so a long sequence is quickly covered end to end, and
+// frames the user scrubs to are built ahead of the background pass.
+//
+// The cache folders of all sequences together are kept under a disk budget: when a
+// sequence is opened, the folders of the least recently opened ones are deleted
+// until the rest fit. The folder in use is never deleted, even if it alone is over.
+class ProxyCache : public ofThread {
+public:
+	~ProxyCache();
+	
+	static const vector<int>& getLevels();
+	
+	void setup();
+	void close();
+	
+	// Replace the sequence. Proxies already on disk for the same directory are reused.
+	void setFrameList(const string& directory, shared_ptr<const FrameList> frameList);
+	
+	void setDiskBudget(uint64_t bytes);
+	uint64_t getDiskBudget();
+	
+	// Hold the background pass, e.g. while playback needs the cores for decoding.
+	// Frames asked for with request() are still built.
+	void setPaused(bool paused);
+	
+	// Build this frame before continuing the background pass
+	void request(int index);
+	
+	// Proxy file for frame index at the smallest level that is at least width wide,
+	// or an empty string if that frame has no proxy yet
+	string getProxyPath(int index, int width);
+	
+	// Closest frame within maxDistance of index that has a proxy, or -1
+	int findNearestReady(int index, int maxDistance);
+	
+	float getProgress();
+	
+protected:
+	void threadedFunction() override;
+	
+private:
+	static string getLevelPath(const string& directory, int level, const string& sourcePath);
+	static bool buildProxies(const string& directory, const string& sourcePath);
+	// Deletes the least recently used cache folders next to keepDirectory until all of them fit
+	static void evictToBudget(const string& keepDirectory, uint64_t budget);
+	static uint64_t getFolderSize(const string& directory);
+	bool nextFrameToBuild(int& index);
+	int getNumPaths() const { return frameList ? frameList->size() : 0; }
+	
+	string cacheDirectory;
+	shared_ptr<const FrameList> frameList;
+	std::unordered_set<string> ready;   // source paths whose proxies are on disk and up to date
+	std::unordered_set<string> failed;  // source paths that could not be decoded or written
+	std::deque<int> requests;
+	int passStride = 0;    // coarse-to-fine background pass state
+	int passPosition = 0;
+	uint64_t diskBudget = 4ull * 1024 * 1024 * 1024;
+	bool evictPending = false;  // a folder was opened or the budget changed
+	bool paused = false;
+	std::condition_variable condition;
+};
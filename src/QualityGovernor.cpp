@@ -0,0 +1,140 @@
+#include "QualityGovernor.h"
+#include "FrameStats.h"
+
+const double QualityGovernor::WINDOW = 0.5;
+const double QualityGovernor::UPGRADE_HOLD = 3.0;
+
+namespace {
+    // Busier than this and the next frames are likely to be late
+    const float DEGRADE_LOAD = 0.9f;
+    // The level above has to be expected under this to go back up
+    const float UPGRADE_LOAD = 0.65f;
+    // Of the refreshes in a window; a single late frame after a seek doesn't count
+    const float LATE_RATIO = 0.02f;
+    // Of the render thread's time that uploads may take before they crowd out drawing
+    const float UPLOAD_SHARE = 0.5f;
+}
+
+//--------------------------------------------------------------
+const char* QualityGovernor::getLevelName(Level level){
+    switch (level) {
+        case FULL: return "Full";
+        case HALF: return "Half Size";
+        case PROXY: return "Proxy";
+        case SKIP_HALF: return "Proxy, 1/2 Frames";
+        case SKIP_MOST: return "Proxy, 1/4 Frames";
+        default: return "?";
+    }
+}
+
+//--------------------------------------------------------------
+int QualityGovernor::getFrameStep(Level level){
+    return level == SKIP_MOST ? 4 : level == SKIP_HALF ? 2 : 1;
+}
+
+//--------------------------------------------------------------
+int QualityGovernor::getFrameStep() const {
+    return getFrameStep(level);
+}
+
+//--------------------------------------------------------------
+QualityGovernor::Sample QualityGovernor::takeSample(){
+    FrameStats& stats = FrameStats::get();
+    FrameStats::Summary read = stats.getSummary(FrameStats::FILE_READ);
+    FrameStats::Summary decode = stats.getSummary(FrameStats::DECODE);
+    FrameStats::Summary upload = stats.getSummary(FrameStats::UPLOAD);
+    Sample sample;
+    sample.decodes = decode.count;
+    sample.decodeMillis = (double)read.count * read.meanMillis + (double)decode.count * decode.meanMillis;
+    sample.uploadMillis = (double)upload.count * upload.meanMillis;
+    sample.late = stats.getLate();
+    return sample;
+}
+
+//--------------------------------------------------------------
+bool QualityGovernor::update(double now, int numThreads, double refreshPeriod){
+    if (windowStart < 0) {
+        windowStart = now;
+        windowSample = takeSample();
+        return false;
+    }
+    double elapsed = now - windowStart;
+    if (elapsed < WINDOW) {
+        return false;
+    }
+
+    Sample sample = takeSample();
+    if (sample.decodes < windowSample.decodes || sample.late < windowSample.late) {
+        // The stats were reset
+        windowStart = now;
+        windowSample = sample;
+        return false;
+    }
+    uint64_t decodes = sample.decodes - windowSample.decodes;
+    double decodeMillis = sample.decodeMillis - windowSample.decodeMillis;
+    float decodeLoad = decodeMillis / (elapsed * 1000 * std::max(1, numThreads));
+    float uploadLoad = (sample.uploadMillis - windowSample.uploadMillis) / (elapsed * 1000 * UPLOAD_SHARE);
+    float lateRatio = (sample.late - windowSample.late) * refreshPeriod / elapsed;
+    load = std::max(decodeLoad, uploadLoad);
+    if (decodes > 0) {
+        float cost = decodeMillis / decodes;
+        decodeCost[level] = decodeCost[level] > 0 ? 0.7f * decodeCost[level] + 0.3f * cost : cost;
+    }
+    if (sample.late > windowSample.late) {
+        lastLateTime = now;
+    }
+    windowStart = now;
+    windowSample = sample;
+
+    if (neverDegrade) {
+        return false;
+    }
+    Level next = level;
+    if ((load > DEGRADE_LOAD || lateRatio > LATE_RATIO) && level + 1 < NUM_LEVELS) {
+        next = (Level)(level + 1);
+    } else if (level > FULL && now - lastLateTime >= UPGRADE_HOLD && now - changeTime >= UPGRADE_HOLD &&
+               load * getUpgradeRatio() < UPGRADE_LOAD) {
+        next = (Level)(level - 1);
+    }
+    if (next == level) {
+        return false;
+    }
+    ofLogNotice("QualityGovernor") << getLevelName(level) << " -> " << getLevelName(next) << ": load "
+                                   << ofToString(decodeLoad, 2) << " decode, " << ofToString(uploadLoad, 2)
+                                   << " upload, " << ofToString(lateRatio * 100, 1) << "% late";
+    level = next;
+    changeTime = now;
+    return true;
+}
+
+//--------------------------------------------------------------
+void QualityGovernor::pause(){
+    windowStart = -1;
+}
+
+//--------------------------------------------------------------
+bool QualityGovernor::isBehind() const {
+    return level != FULL || load > UPGRADE_LOAD;
+}
+
+//--------------------------------------------------------------
+void QualityGovernor::setNeverDegrade(bool value){
+    neverDegrade = value;
+    if (neverDegrade) {
+        level = FULL;
+    }
+}
+
+//--------------------------------------------------------------
+float QualityGovernor::getUpgradeRatio() const {
+    Level above = (Level)(level - 1);
+    // Showing twice the frames decodes twice as many
+    float ratio = (float)getFrameStep(level) / getFrameStep(above);
+    if (decodeCost[above] > 0 && decodeCost[level] > 0) {
+        ratio *= decodeCost[above] / decodeCost[level];
+    } else if (ratio == 1) {
+        // A size step that hasn't been measured yet; assume it is expensive
+        ratio = 2;
+    }
+    return ratio;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Trades picture quality for keeping up when decoding can't, so playback at high
+// speeds or of 8K TIFFs degrades visibly and evenly instead of silently falling behind.
+//
+// Every WINDOW seconds of playback it looks at what FrameStats measured since the last
+// look: how busy the decode threads were (file read plus decode time over the time
+// they had), how much of the render thread uploads took, and how many refreshes a due
+// frame wasn't ready. When any of them says the deadline is at risk it drops a level:
+// decoding at half the output size (JPEGs straight from the DCT), then loading scrub
+// proxies, then also showing only every second or fourth frame, always the same ones.
+//
+// Going back up waits until there were no late frames for UPGRADE_HOLD seconds and the
+// level above is predicted to fit with headroom, from what decoding cost the last time
+// it was played at that level. The gap between the two thresholds and the hold keep it
+// from flapping. With never degrade set it stays at full quality, for a final output.
+class QualityGovernor {
+public:
+	enum Level {
+		FULL,
+		HALF,       // decoded at half the output size
+		PROXY,      // scrub proxies where they are built, a quarter of the output size otherwise
+		SKIP_HALF,  // proxies, every second frame
+		SKIP_MOST,  // proxies, every fourth frame
+		NUM_LEVELS
+	};
+	
+	static const char* getLevelName(Level level);
+	
+	// Call every update while playing from a folder. True if the level changed.
+	bool update(double now, int numThreads, double refreshPeriod);
+	// Not playing: measurements start over when playback does
+	void pause();
+	
+	void setNeverDegrade(bool neverDegrade);
+	bool getNeverDegrade() const { return neverDegrade; }
+	
+	Level getLevel() const { return level; }
+	// 1 shows every frame, 2 every second one...
+	int getFrameStep() const;
+	// Busiest of decode and upload in the last window; 1 is all the time there is
+	float getLoad() const { return load; }
+	// Degraded, or too busy to go back up a level: background work should wait
+	bool isBehind() const;
+	
+	static const double WINDOW;
+	static const double UPGRADE_HOLD;
+	
+private:
+	struct Sample {
+		uint64_t decodes = 0;
+		double decodeMillis = 0;  // file read and decode
+		double uploadMillis = 0;
+		uint64_t late = 0;
+	};
+	
+	static Sample takeSample();
+	static int getFrameStep(Level level);
+	// How much more the level above this one is expected to cost
+	float getUpgradeRatio() const;
+	
+	Level level = FULL;
+	bool neverDegrade = false;
+	float load = 0;
+	float decodeCost[NUM_LEVELS] = {};  // milliseconds per frame decoded at each level, 0 until measured
+	
+	double windowStart = -1;
+	Sample windowSample;
+	double changeTime = 0;
+	double lastLateTime = 0;
+};
@@ -0,0 +1,427 @@
+#include "Resampler.h"
+#include "PixelConvert.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RESAMPLER_X86 1
+#include <immintrin.h>
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__ARM_NEON)
+#define RESAMPLER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+    // Weights are 14-bit fixed point, so a sum of 8-bit samples stays far from overflowing
+    // 32 bits and each weight still fits 16 for pmaddwd
+    const int WEIGHT_BITS = 14;
+    const int ROUNDING = 1 << (WEIGHT_BITS - 1);
+
+    // dst[i] = sum over k of rows[k][i] * weights[k], for bytes samples; taps is even
+    typedef void (*VerticalKernel)(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, size_t bytes);
+    // dst gets width pixels; pixel x weighs taps pixels of src from starts[x]
+    typedef void (*HorizontalKernel)(const uint8_t* src, uint8_t* dst, int width, const int* starts, const int16_t* weights, int taps);
+
+    struct Kernels {
+        VerticalKernel vertical;
+        HorizontalKernel horizontal[4];  // [grey, grey + alpha, RGB, RGBA]
+    };
+
+    inline uint8_t clampSample(int v) {
+        return (uint8_t)std::min(255, std::max(0, v));
+    }
+
+    // Two neighbouring weights as one 32-bit lane, the way pmaddwd pairs them
+    inline int32_t weightPair(const int16_t* weights) {
+        int32_t pair;
+        memcpy(&pair, weights, sizeof(pair));
+        return pair;
+    }
+
+    //--------------------------------------------------------------
+    // Scalar reference; the SIMD kernels hand their tails to these and must match them exactly
+
+    void verticalRange(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            int sum = ROUNDING;
+            for (int k = 0; k < taps; k++) {
+                sum += weights[k] * rows[k][i];
+            }
+            dst[i] = clampSample(sum >> WEIGHT_BITS);
+        }
+    }
+
+    void verticalScalar(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, size_t bytes) {
+        verticalRange(rows, weights, taps, dst, 0, bytes);
+    }
+
+    template<int Channels>
+    void horizontalScalar(const uint8_t* src, uint8_t* dst, int width, const int* starts, const int16_t* weights, int taps) {
+        for (int x = 0; x < width; x++, dst += Channels, weights += taps) {
+            const uint8_t* s = src + starts[x] * Channels;
+            for (int c = 0; c < Channels; c++) {
+                int sum = ROUNDING;
+                for (int k = 0; k < taps; k++) {
+                    sum += weights[k] * s[k * Channels + c];
+                }
+                dst[c] = clampSample(sum >> WEIGHT_BITS);
+            }
+        }
+    }
+
+    const Kernels SCALAR_KERNELS = {
+        verticalScalar,
+        {horizontalScalar<1>, horizontalScalar<2>, horizontalScalar<3>, horizontalScalar<4>}
+    };
+
+#ifdef RESAMPLER_X86
+    //--------------------------------------------------------------
+    // SSE4.1: pmaddwd multiplies two taps at once, from interleaved samples and paired weights
+
+    TARGET_SSE41 void verticalSse41(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, size_t bytes) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi32(ROUNDING);
+        size_t i = 0;
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i sums[4] = {rounding, rounding, rounding, rounding};
+            for (int k = 0; k < taps; k += 2) {
+                __m128i a = _mm_loadu_si128((const __m128i*)(rows[k] + i));
+                __m128i b = _mm_loadu_si128((const __m128i*)(rows[k + 1] + i));
+                __m128i pair = _mm_set1_epi32(weightPair(weights + k));
+                // a0 b0 a1 b1 ... as 16-bit lanes, four samples per pmaddwd
+                __m128i low = _mm_unpacklo_epi8(a, b);
+                __m128i high = _mm_unpackhi_epi8(a, b);
+                sums[0] = _mm_add_epi32(sums[0], _mm_madd_epi16(_mm_unpacklo_epi8(low, zero), pair));
+                sums[1] = _mm_add_epi32(sums[1], _mm_madd_epi16(_mm_unpackhi_epi8(low, zero), pair));
+                sums[2] = _mm_add_epi32(sums[2], _mm_madd_epi16(_mm_unpacklo_epi8(high, zero), pair));
+                sums[3] = _mm_add_epi32(sums[3], _mm_madd_epi16(_mm_unpackhi_epi8(high, zero), pair));
+            }
+            __m128i first = _mm_packs_epi32(_mm_srai_epi32(sums[0], WEIGHT_BITS), _mm_srai_epi32(sums[1], WEIGHT_BITS));
+            __m128i second = _mm_packs_epi32(_mm_srai_epi32(sums[2], WEIGHT_BITS), _mm_srai_epi32(sums[3], WEIGHT_BITS));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(first, second));
+        }
+        verticalRange(rows, weights, taps, dst, i, bytes);
+    }
+
+    // Two neighbouring pixels of 3 or 4 channels to (c0 of p0, c0 of p1, c1 of p0, ...) 16-bit lanes
+    template<int Channels>
+    TARGET_SSE41 __m128i pairMask() {
+        return Channels == 4 ? _mm_setr_epi8(0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1)
+                             : _mm_setr_epi8(0, -1, 3, -1, 1, -1, 4, -1, 2, -1, 5, -1, -1, -1, -1, -1);
+    }
+
+    // Reads 8 bytes from every second tap, which the scratch row is padded for
+    template<int Channels>
+    TARGET_SSE41 void horizontalSse41(const uint8_t* src, uint8_t* dst, int width, const int* starts, const int16_t* weights, int taps) {
+        if (Channels < 3) {
+            horizontalScalar<Channels>(src, dst, width, starts, weights, taps);
+            return;
+        }
+        const __m128i mask = pairMask<Channels>();
+        const __m128i rounding = _mm_set1_epi32(ROUNDING);
+        for (int x = 0; x < width; x++, dst += Channels, weights += taps) {
+            const uint8_t* s = src + starts[x] * Channels;
+            __m128i sum = rounding;
+            for (int k = 0; k < taps; k += 2) {
+                __m128i pixels = _mm_shuffle_epi8(_mm_loadl_epi64((const __m128i*)(s + k * Channels)), mask);
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, _mm_set1_epi32(weightPair(weights + k))));
+            }
+            __m128i packed = _mm_packs_epi32(_mm_srai_epi32(sum, WEIGHT_BITS), _mm_setzero_si128());
+            uint32_t value = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+            // An RGB pixel's fourth byte is the next pixel's first, written over right after
+            memcpy(dst, &value, Channels == 4 || x + 1 < width ? 4 : 3);
+        }
+    }
+
+    //--------------------------------------------------------------
+    // AVX2: the vertical pass twice as wide. Per pixel the horizontal pass has only a
+    // handful of pairs to sum, so it stays on the SSE4.1 kernel.
+
+    TARGET_AVX2 void verticalAvx2(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, size_t bytes) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i rounding = _mm256_set1_epi32(ROUNDING);
+        size_t i = 0;
+        for (; i + 32 <= bytes; i += 32) {
+            __m256i sums[4] = {rounding, rounding, rounding, rounding};
+            for (int k = 0; k < taps; k += 2) {
+                __m256i a = _mm256_loadu_si256((const __m256i*)(rows[k] + i));
+                __m256i b = _mm256_loadu_si256((const __m256i*)(rows[k + 1] + i));
+                __m256i pair = _mm256_set1_epi32(weightPair(weights + k));
+                __m256i low = _mm256_unpacklo_epi8(a, b);
+                __m256i high = _mm256_unpackhi_epi8(a, b);
+                sums[0] = _mm256_add_epi32(sums[0], _mm256_madd_epi16(_mm256_unpacklo_epi8(low, zero), pair));
+                sums[1] = _mm256_add_epi32(sums[1], _mm256_madd_epi16(_mm256_unpackhi_epi8(low, zero), pair));
+                sums[2] = _mm256_add_epi32(sums[2], _mm256_madd_epi16(_mm256_unpacklo_epi8(high, zero), pair));
+                sums[3] = _mm256_add_epi32(sums[3], _mm256_madd_epi16(_mm256_unpackhi_epi8(high, zero), pair));
+            }
+            // The unpacks and packs both work within 128-bit lanes, so the order comes out right
+            __m256i first = _mm256_packs_epi32(_mm256_srai_epi32(sums[0], WEIGHT_BITS), _mm256_srai_epi32(sums[1], WEIGHT_BITS));
+            __m256i second = _mm256_packs_epi32(_mm256_srai_epi32(sums[2], WEIGHT_BITS), _mm256_srai_epi32(sums[3], WEIGHT_BITS));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(first, second));
+        }
+        verticalRange(rows, weights, taps, dst, i, bytes);
+    }
+
+    const Kernels SSE41_KERNELS = {
+        verticalSse41,
+        {horizontalScalar<1>, horizontalScalar<2>, horizontalSse41<3>, horizontalSse41<4>}
+    };
+
+    const Kernels AVX2_KERNELS = {
+        verticalAvx2,
+        {horizontalScalar<1>, horizontalScalar<2>, horizontalSse41<3>, horizontalSse41<4>}
+    };
+#endif
+
+#ifdef RESAMPLER_NEON
+    //--------------------------------------------------------------
+    // NEON: widening multiply-accumulates, one tap at a time
+
+    void verticalNeon(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, size_t bytes) {
+        size_t i = 0;
+        for (; i + 16 <= bytes; i += 16) {
+            int32x4_t sums[4];
+            for (int j = 0; j < 4; j++) {
+                sums[j] = vdupq_n_s32(ROUNDING);
+            }
+            for (int k = 0; k < taps; k++) {
+                uint8x16_t v = vld1q_u8(rows[k] + i);
+                int16x8_t low = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(v)));
+                int16x8_t high = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(v)));
+                sums[0] = vmlal_n_s16(sums[0], vget_low_s16(low), weights[k]);
+                sums[1] = vmlal_n_s16(sums[1], vget_high_s16(low), weights[k]);
+                sums[2] = vmlal_n_s16(sums[2], vget_low_s16(high), weights[k]);
+                sums[3] = vmlal_n_s16(sums[3], vget_high_s16(high), weights[k]);
+            }
+            int16x8_t first = vcombine_s16(vqmovn_s32(vshrq_n_s32(sums[0], WEIGHT_BITS)), vqmovn_s32(vshrq_n_s32(sums[1], WEIGHT_BITS)));
+            int16x8_t second = vcombine_s16(vqmovn_s32(vshrq_n_s32(sums[2], WEIGHT_BITS)), vqmovn_s32(vshrq_n_s32(sums[3], WEIGHT_BITS)));
+            vst1q_u8(dst + i, vcombine_u8(vqmovun_s16(first), vqmovun_s16(second)));
+        }
+        verticalRange(rows, weights, taps, dst, i, bytes);
+    }
+
+    // Reads 8 bytes per tap, which the scratch row is padded for; an RGB pixel's fourth
+    // lane sums the next pixel's red and is dropped
+    template<int Channels>
+    void horizontalNeon(const uint8_t* src, uint8_t* dst, int width, const int* starts, const int16_t* weights, int taps) {
+        if (Channels < 3) {
+            horizontalScalar<Channels>(src, dst, width, starts, weights, taps);
+            return;
+        }
+        for (int x = 0; x < width; x++, dst += Channels, weights += taps) {
+            const uint8_t* s = src + starts[x] * Channels;
+            int32x4_t sum = vdupq_n_s32(ROUNDING);
+            for (int k = 0; k < taps; k++) {
+                int16x4_t pixel = vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(s + k * Channels))));
+                sum = vmlal_n_s16(sum, pixel, weights[k]);
+            }
+            int16x4_t narrowed = vqmovn_s32(vshrq_n_s32(sum, WEIGHT_BITS));
+            uint8x8_t packed = vqmovun_s16(vcombine_s16(narrowed, narrowed));
+            uint32_t value = vget_lane_u32(vreinterpret_u32_u8(packed), 0);
+            memcpy(dst, &value, Channels == 4 || x + 1 < width ? 4 : 3);
+        }
+    }
+
+    const Kernels NEON_KERNELS = {
+        verticalNeon,
+        {horizontalScalar<1>, horizontalScalar<2>, horizontalNeon<3>, horizontalNeon<4>}
+    };
+#endif
+
+    // Follows PixelConvert, so the benchmark switches both together
+    const Kernels& getKernels() {
+        switch (PixelConvert::getImplementation()) {
+#ifdef RESAMPLER_X86
+            case PixelConvert::SSE41: return SSE41_KERNELS;
+            case PixelConvert::AVX2: return AVX2_KERNELS;
+#endif
+#ifdef RESAMPLER_NEON
+            case PixelConvert::NEON: return NEON_KERNELS;
+#endif
+            default: return SCALAR_KERNELS;
+        }
+    }
+
+    double lanczos3(double x) {
+        if (x == 0) {
+            return 1;
+        }
+        if (std::abs(x) >= 3) {
+            return 0;
+        }
+        double px = M_PI * x;
+        return 3 * std::sin(px) * std::sin(px / 3) / (px * px);
+    }
+}
+
+//--------------------------------------------------------------
+void Resampler::getFitSize(int width, int height, int boxWidth, int boxHeight, bool inside, int& fitWidth, int& fitHeight){
+    fitWidth = width;
+    fitHeight = height;
+    if (width <= 0 || height <= 0 || (boxWidth <= 0 && boxHeight <= 0)) {
+        return;
+    }
+    double scaleX = (double)boxWidth / width;
+    double scaleY = (double)boxHeight / height;
+    double scale = boxWidth <= 0 ? scaleY : boxHeight <= 0 ? scaleX : inside ? std::min(scaleX, scaleY) : std::max(scaleX, scaleY);
+    fitWidth = std::max(1, (int)std::round(width * scale));
+    fitHeight = std::max(1, (int)std::round(height * scale));
+}
+
+//--------------------------------------------------------------
+Resampler::Taps Resampler::computeTaps(int srcSize, int dstSize, Filter filter){
+    // Sample j covers [j, j + 1); output sample i is centered on (i + 0.5) * ratio.
+    // Shrinking stretches the filter over ratio source samples so it also averages.
+    double ratio = (double)srcSize / dstSize;
+    double filterScale = std::max(1.0, ratio);
+    double support = (filter == LANCZOS3 ? 3.0 : 0.5) * filterScale;
+    int capacity = (int)std::ceil(2 * support) + 3;
+
+    std::vector<double> raw((size_t)dstSize * capacity, 0.0);
+    std::vector<int> counts(dstSize, 0);
+    Taps taps;
+    taps.starts.resize(dstSize);
+    int maxCount = 1;
+    for (int i = 0; i < dstSize; i++) {
+        double center = (i + 0.5) * ratio;
+        int first = std::max(0, (int)std::floor(center - support));
+        int last = std::min(srcSize - 1, (int)std::ceil(center + support));
+        double* weights = &raw[(size_t)i * capacity];
+        double total = 0;
+        int count = 0;
+        for (int j = first; j <= last && count < capacity; j++, count++) {
+            double w;
+            if (filter == LANCZOS3) {
+                w = lanczos3((j + 0.5 - center) / filterScale);
+            } else {
+                // How much of the sample the box covers
+                w = std::max(0.0, std::min(j + 1.0, center + support) - std::max((double)j, center - support));
+            }
+            weights[count] = w;
+            total += w;
+        }
+        if (total <= 0) {
+            // Nothing under the filter; take the nearest sample
+            first = std::min(srcSize - 1, std::max(0, (int)center));
+            weights[0] = total = 1;
+            count = 1;
+        }
+        // Samples outside the frame are left out and the rest renormalized. Those
+        // weighing nothing are trimmed so they don't cost a tap.
+        int skip = 0;
+        while (skip < count - 1 && std::abs(weights[skip]) < 1e-9) {
+            skip++;
+        }
+        while (count - 1 > skip && std::abs(weights[count - 1]) < 1e-9) {
+            count--;
+        }
+        for (int k = skip; k < count; k++) {
+            weights[k - skip] = weights[k] / total;
+        }
+        count -= skip;
+        taps.starts[i] = first + skip;
+        counts[i] = count;
+        maxCount = std::max(maxCount, count);
+    }
+
+    // An even number of taps for the kernels that take them two at a time
+    taps.size = (maxCount + 1) & ~1;
+    taps.weights.assign((size_t)dstSize * taps.size, 0);
+    taps.exact.assign((size_t)dstSize * taps.size, 0.0);
+    const int one = 1 << WEIGHT_BITS;
+    for (int i = 0; i < dstSize; i++) {
+        const double* weights = &raw[(size_t)i * capacity];
+        int16_t* fixed = &taps.weights[(size_t)i * taps.size];
+        double* exact = &taps.exact[(size_t)i * taps.size];
+        int sum = 0;
+        int largest = 0;
+        for (int k = 0; k < counts[i]; k++) {
+            exact[k] = weights[k];
+            fixed[k] = (int16_t)std::lround(weights[k] * one);
+            sum += fixed[k];
+            largest = weights[k] > weights[largest] ? k : largest;
+        }
+        // Rounding must not brighten or darken flat areas
+        fixed[largest] += one - sum;
+    }
+    return taps;
+}
+
+//--------------------------------------------------------------
+void Resampler::resize(const uint8_t* src, int srcWidth, int srcHeight, int channels,
+                       uint8_t* dst, int dstWidth, int dstHeight, Filter filter){
+    if (channels < 1 || channels > 4 || srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+        return;
+    }
+    Taps horizontal = computeTaps(srcWidth, dstWidth, filter);
+    Taps vertical = computeTaps(srcHeight, dstHeight, filter);
+    const Kernels& kernels = getKernels();
+    HorizontalKernel filterRow = kernels.horizontal[channels - 1];
+
+    size_t srcStride = (size_t)srcWidth * channels;
+    size_t dstStride = (size_t)dstWidth * channels;
+    // The horizontal kernels read past the last tap of the last pixel; the padding is zero
+    std::vector<uint8_t> row((size_t)(srcWidth + horizontal.size) * channels + 16, 0);
+    std::vector<const uint8_t*> rows(vertical.size);
+    for (int y = 0; y < dstHeight; y++) {
+        for (int k = 0; k < vertical.size; k++) {
+            // Unused taps weigh 0 but still need a row to read
+            int index = std::min(srcHeight - 1, vertical.starts[y] + k);
+            rows[k] = src + index * srcStride;
+        }
+        kernels.vertical(rows.data(), &vertical.weights[(size_t)y * vertical.size], vertical.size, row.data(), srcStride);
+        filterRow(row.data(), dst + y * dstStride, dstWidth, horizontal.starts.data(), horizontal.weights.data(), horizontal.size);
+    }
+}
+
+//--------------------------------------------------------------
+void Resampler::resizeReference(const uint8_t* src, int srcWidth, int srcHeight, int channels,
+                                uint8_t* dst, int dstWidth, int dstHeight, Filter filter){
+    if (channels < 1 || channels > 4 || srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+        return;
+    }
+    Taps horizontal = computeTaps(srcWidth, dstWidth, filter);
+    Taps vertical = computeTaps(srcHeight, dstHeight, filter);
+    size_t srcStride = (size_t)srcWidth * channels;
+    std::vector<double> row(srcStride);
+    for (int y = 0; y < dstHeight; y++) {
+        const double* weights = &vertical.exact[(size_t)y * vertical.size];
+        std::fill(row.begin(), row.end(), 0.0);
+        for (int k = 0; k < vertical.size; k++) {
+            int index = vertical.starts[y] + k;
+            if (weights[k] == 0 || index >= srcHeight) {
+                continue;
+            }
+            const uint8_t* s = src + index * srcStride;
+            for (size_t i = 0; i < srcStride; i++) {
+                row[i] += weights[k] * s[i];
+            }
+        }
+        // The fixed point passes keep the row in 8 bits, so ringing is clipped there too
+        for (double& v : row) {
+            v = std::min(255.0, std::max(0.0, v));
+        }
+        uint8_t* d = dst + (size_t)y * dstWidth * channels;
+        for (int x = 0; x < dstWidth; x++) {
+            const double* w = &horizontal.exact[(size_t)x * horizontal.size];
+            for (int c = 0; c < channels; c++) {
+                double sum = 0;
+                for (int k = 0; k < horizontal.size; k++) {
+                    int index = horizontal.starts[x] + k;
+                    if (w[k] != 0 && index < srcWidth) {
+                        sum += w[k] * row[index * channels + c];
+                    }
+                }
+                d[x * channels + c] = clampSample((int)std::lround(sum));
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+const char* Resampler::getName(Filter filter){
+    return filter == LANCZOS3 ? "lanczos3" : "box";
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Resizes 8-bit frames with a separable box or Lanczos-3 filter, so decoded frames
+// can be brought down to the size they are shown at on the loader threads instead
+// of being uploaded whole and scaled by the GPU. Columns are filtered first, one
+// output row at a time into a scratch row, then that row is filtered across; both
+// passes use 14-bit fixed point weights. The SSE4.1, AVX2 and NEON kernels follow
+// PixelConvert's implementation and are bit-exact with the scalar one. No
+// openFrameworks dependency.
+class Resampler {
+public:
+	enum Filter {
+		BOX,       // area average when shrinking, cheap, for previews
+		LANCZOS3   // sharp, for frames that are shown
+	};
+
+	// Size of a width x height frame scaled to fit inside boxWidth x boxHeight, as an
+	// output that keeps its aspect ratio letterboxes it, or with inside false to cover
+	// it. 0 leaves that side of the box free; 0 x 0 keeps the frame's size.
+	static void getFitSize(int width, int height, int boxWidth, int boxHeight, bool inside, int& fitWidth, int& fitHeight);
+
+	// channels is 1 to 4; rows are packed
+	static void resize(const uint8_t* src, int srcWidth, int srcHeight, int channels,
+	                   uint8_t* dst, int dstWidth, int dstHeight, Filter filter);
+	// The same filter in double precision, to test against: nothing is rounded but the
+	// result, though the row between the passes is clipped to 0-255 like the kernels' is
+	static void resizeReference(const uint8_t* src, int srcWidth, int srcHeight, int channels,
+	                            uint8_t* dst, int dstWidth, int dstHeight, Filter filter);
+
+	static const char* getName(Filter filter);
+
+private:
+	// Weights of the source samples that make up each output sample
+	struct Taps {
+		int size = 0;                 // per output sample, even; unused ones weigh 0
+		std::vector<int> starts;      // first source sample
+		std::vector<int16_t> weights; // size per output sample, summing to 1 << 14
+		std::vector<double> exact;    // the same before rounding, summing to 1
+	};
+
+	static Taps computeTaps(int srcSize, int dstSize, Filter filter);
+};
@@ -0,0 +1,147 @@
+#include "ScaledJpegDecoder.h"
+#include <dlfcn.h>
+
+namespace {
+    // The few TurboJPEG entry points and constants used here; the API has kept them
+    // stable since libjpeg-turbo 1.2, so no header is needed at build time
+    typedef void* tjhandle;
+    const int TJPF_RGB = 0;
+    const int TJPF_GRAY = 6;
+    const int TJCS_GRAY = 2;
+    const int TJCS_CMYK = 3;
+    const int TJCS_YCCK = 4;
+
+    struct TurboJpeg {
+        tjhandle (*initDecompress)() = nullptr;
+        int (*decompressHeader3)(tjhandle, const unsigned char*, unsigned long, int*, int*, int*, int*) = nullptr;
+        int (*decompress2)(tjhandle, const unsigned char*, unsigned long, unsigned char*, int, int, int, int, int) = nullptr;
+        int (*destroy)(tjhandle) = nullptr;
+        char* (*getErrorStr)() = nullptr;
+        bool loaded = false;
+    };
+
+    template<typename Function>
+    bool findSymbol(void* library, const char* name, Function& function) {
+        function = (Function)dlsym(library, name);
+        return function != nullptr;
+    }
+
+    const TurboJpeg& getTurboJpeg() {
+        static const TurboJpeg turboJpeg = [] {
+            TurboJpeg api;
+            const char* candidates[] = {
+#ifdef TARGET_OSX
+                "@executable_path/../Frameworks/libturbojpeg.0.dylib",
+                "/opt/homebrew/opt/jpeg-turbo/lib/libturbojpeg.0.dylib",
+                "/usr/local/opt/jpeg-turbo/lib/libturbojpeg.0.dylib",
+                "libturbojpeg.0.dylib",
+#else
+                "libturbojpeg.so.0",
+                "libturbojpeg.so",
+#endif
+            };
+            void* library = nullptr;
+            for (const char* candidate : candidates) {
+                library = dlopen(candidate, RTLD_NOW | RTLD_LOCAL);
+                if (library) {
+                    break;
+                }
+            }
+            if (!library) {
+                ofLogNotice("ScaledJpegDecoder") << "libturbojpeg not found, JPEGs decode at full size through FreeImage";
+                return api;
+            }
+            api.loaded = findSymbol(library, "tjInitDecompress", api.initDecompress) &&
+                         findSymbol(library, "tjDecompressHeader3", api.decompressHeader3) &&
+                         findSymbol(library, "tjDecompress2", api.decompress2) &&
+                         findSymbol(library, "tjDestroy", api.destroy) &&
+                         findSymbol(library, "tjGetErrorStr", api.getErrorStr);
+            if (!api.loaded) {
+                ofLogWarning("ScaledJpegDecoder") << "libturbojpeg is missing symbols, not using it";
+            }
+            return api;
+        }();
+        return turboJpeg;
+    }
+
+    // TurboJPEG handles aren't thread-safe but are cheap to keep, so each decoding thread owns one
+    struct ThreadHandle {
+        tjhandle handle = nullptr;
+        ~ThreadHandle() {
+            if (handle) {
+                getTurboJpeg().destroy(handle);
+            }
+        }
+    };
+
+    tjhandle getThreadHandle() {
+        thread_local ThreadHandle threadHandle;
+        if (!threadHandle.handle) {
+            threadHandle.handle = getTurboJpeg().initDecompress();
+        }
+        return threadHandle.handle;
+    }
+}
+
+//--------------------------------------------------------------
+bool ScaledJpegDecoder::isAvailable(){
+    return getTurboJpeg().loaded;
+}
+
+//--------------------------------------------------------------
+bool ScaledJpegDecoder::isJpeg(const ofBuffer& buffer){
+    const unsigned char* data = (const unsigned char*)buffer.getData();
+    return buffer.size() > 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+//--------------------------------------------------------------
+int ScaledJpegDecoder::chooseScale(int width, int height, int minWidth, int minHeight){
+    if (minWidth <= 0 && minHeight <= 0) {
+        return 1;
+    }
+    // Scaled sizes round up, as the decoder does
+    int scale = 1;
+    while (scale < 8) {
+        int next = scale * 2;
+        if ((width + next - 1) / next < minWidth || (height + next - 1) / next < minHeight) {
+            break;
+        }
+        scale = next;
+    }
+    return scale;
+}
+
+//--------------------------------------------------------------
+int ScaledJpegDecoder::decode(const ofBuffer& buffer, ofPixels& pixels, int minWidth, int minHeight){
+    const TurboJpeg& api = getTurboJpeg();
+    if (!api.loaded || !isJpeg(buffer)) {
+        return 0;
+    }
+    tjhandle handle = getThreadHandle();
+    if (!handle) {
+        return 0;
+    }
+
+    const unsigned char* data = (const unsigned char*)buffer.getData();
+    int width, height, subsampling, colorspace;
+    if (api.decompressHeader3(handle, data, buffer.size(), &width, &height, &subsampling, &colorspace) != 0) {
+        return 0;
+    }
+    if (colorspace == TJCS_CMYK || colorspace == TJCS_YCCK) {
+        return 0;  // FreeImage handles the inversion and conversion these need
+    }
+
+    int scale = chooseScale(width, height, minWidth, minHeight);
+    int scaledWidth = (width + scale - 1) / scale;
+    int scaledHeight = (height + scale - 1) / scale;
+    bool grey = colorspace == TJCS_GRAY;
+    pixels.allocate(scaledWidth, scaledHeight, grey ? OF_PIXELS_GRAY : OF_PIXELS_RGB);
+
+    // Asking for the scaled size makes the decoder pick the matching DCT scaling factor
+    if (api.decompress2(handle, data, buffer.size(), pixels.getData(), scaledWidth, 0, scaledHeight,
+                        grey ? TJPF_GRAY : TJPF_RGB, 0) != 0) {
+        ofLogVerbose("ScaledJpegDecoder") << "Decode failed: " << api.getErrorStr();
+        return 0;
+    }
+    return scale;
+}
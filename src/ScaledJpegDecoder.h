@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ofMain.h"
+
+// JPEG decoding through libjpeg-turbo's TurboJPEG API, optionally at 1/2, 1/4 or
+// 1/8 size straight from the DCT coefficients, which skips most of the inverse
+// transform and colour conversion. Used for scrubbing, proxies and outputs smaller
+// than the source.
+//
+// libturbojpeg is loaded at runtime (Homebrew's jpeg-turbo, or a copy in the app
+// bundle's Frameworks folder) so the app still builds and runs without it; decode()
+// then fails and callers fall back to ofLoadImage. Linking it at build time would
+// clash with the libjpeg that FreeImage carries inside openFrameworks.
+// Safe to use from any thread.
+class ScaledJpegDecoder {
+public:
+	static bool isAvailable();
+	static bool isJpeg(const ofBuffer& buffer);
+
+	// Largest of 1, 2, 4 and 8 that keeps a width x height image at least
+	// minWidth x minHeight after dividing; 0 leaves that side unconstrained
+	static int chooseScale(int width, int height, int minWidth, int minHeight);
+
+	// Decodes to 8-bit RGB (or grey) at chooseScale() of the image size.
+	// Returns the scale used, or 0 if the library is missing or can't decode buffer.
+	static int decode(const ofBuffer& buffer, ofPixels& pixels, int minWidth = 0, int minHeight = 0);
+};
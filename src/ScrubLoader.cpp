@@ -0,0 +1,261 @@
+#include "ScrubLoader.h"
+
+const float ScrubLoader::LOOKAHEAD = 0.25f;
+
+namespace {
+    // Requests further apart than this start a new drag rather than continuing one
+    const double GESTURE_GAP = 0.25;
+}
+
+//--------------------------------------------------------------
+ScrubLoader::~ScrubLoader(){
+    close();
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::setup(FrameCache& frameCache, ProxyCache& proxyCache, int numThreads){
+    close();
+    std::unique_lock<std::mutex> lock(mutex);
+    cache = &frameCache;
+    proxies = &proxyCache;
+    running = true;
+    for (int i = 0; i < std::max(1, numThreads); i++) {
+        workers.emplace_back(&ScrubLoader::loadLoop, this);
+    }
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::close(){
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = false;
+        queue.clear();
+        condition.notify_all();
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::setFrameList(shared_ptr<const FrameList> newFrameList){
+    std::unique_lock<std::mutex> lock(mutex);
+    frameList = newFrameList;
+    generation++;
+    queue.clear();
+    ready.clear();
+    target = -1;
+    settled = false;
+    settledFrame = Frame();
+    shownIndex = -1;
+    shownFull = false;
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::setScrubWidth(int width){
+    std::unique_lock<std::mutex> lock(mutex);
+    if (width != scrubWidth) {
+        scrubWidth = width;
+        ready.clear();
+    }
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::request(int index, int start, int end){
+    // Frames are predicted one display frame apart
+    predictionStep = 1.0f / ofClamp(ofGetFrameRate(), 30, 120);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    double now = ofGetElapsedTimef();
+    double elapsed = now - lastRequestTime;
+    if (target >= 0 && elapsed > 0 && elapsed < GESTURE_GAP) {
+        // Smoothed, since slider events arrive with the jitter of the mouse
+        velocity = 0.5f * velocity + 0.5f * (index - target) / elapsed;
+    } else {
+        // A new drag; whatever take() returned before isn't on screen any more
+        velocity = 0;
+        shownIndex = -1;
+        shownFull = false;
+    }
+    lastRequestTime = now;
+
+    numRequests++;
+    if (ready.count(index)) {
+        numHits++;
+    }
+    target = index;
+    rangeStart = start;
+    rangeEnd = end;
+    settled = false;
+    settledFrame = Frame();
+    plan();
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::settle(int index){
+    std::unique_lock<std::mutex> lock(mutex);
+    target = index;
+    velocity = 0;
+    settled = true;
+    settledFrame = Frame();
+    queue.push_front({index, true});
+    condition.notify_all();
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::cancel(){
+    std::unique_lock<std::mutex> lock(mutex);
+    target = -1;
+    velocity = 0;
+    settled = false;
+    settledFrame = Frame();
+    queue.clear();
+    shownIndex = -1;
+    shownFull = false;
+}
+
+//--------------------------------------------------------------
+bool ScrubLoader::take(Frame& frame){
+    std::unique_lock<std::mutex> lock(mutex);
+    if (target < 0 || (shownFull && shownIndex == target)) {
+        return false;
+    }
+    if (settledFrame.pixels) {
+        frame = settledFrame;
+        shownIndex = target;
+        shownFull = true;
+        return true;
+    }
+
+    // The loaded frame nearest the target, if it is nearer than the one on screen
+    int best = -1;
+    for (const auto& entry : ready) {
+        if (best < 0 || abs(entry.first - target) < abs(best - target)) {
+            best = entry.first;
+        }
+    }
+    if (best < 0 || (shownIndex >= 0 && abs(best - target) >= abs(shownIndex - target))) {
+        return false;
+    }
+    frame.index = best;
+    frame.pixels = ready[best];
+    frame.full = false;
+    shownIndex = best;
+    shownFull = false;
+    return true;
+}
+
+//--------------------------------------------------------------
+float ScrubLoader::getHitRate(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return numRequests > 0 ? numHits / (float)numRequests : 0;
+}
+
+//--------------------------------------------------------------
+float ScrubLoader::getVelocity(){
+    std::unique_lock<std::mutex> lock(mutex);
+    return velocity;
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::plan(){
+    // Called with the mutex held, for the latest request
+    vector<int> wanted = {target};
+    auto want = [&](int index) {
+        index = ofClamp(index, rangeStart, rangeEnd);
+        if (std::find(wanted.begin(), wanted.end(), index) == wanted.end()) {
+            wanted.push_back(index);
+        }
+    };
+    int steps = LOOKAHEAD / predictionStep;
+    for (int i = 1; i <= steps && (int)wanted.size() <= MAX_PREDICTED; i++) {
+        want(round(target + velocity * predictionStep * i));
+    }
+    if (fabs(velocity) * predictionStep < 1) {
+        // Slower than a frame per display frame: the next stop is as likely to be behind
+        for (int distance = 1; distance <= 2; distance++) {
+            want(target + distance);
+            want(target - distance);
+        }
+    }
+
+    // Latest wins: loads that haven't started for older requests are dropped
+    queue.clear();
+    for (int index : wanted) {
+        if (!ready.count(index) && !loading.count(index)) {
+            queue.push_back({index, false});
+        }
+    }
+    trimReady();
+    if (!queue.empty()) {
+        condition.notify_all();
+    }
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::trimReady(){
+    // Keep the loaded frames nearest the target; the rest stay in the FrameCache
+    while ((int)ready.size() > MAX_READY) {
+        auto farthest = abs(ready.begin()->first - target) > abs(ready.rbegin()->first - target) ?
+                        ready.begin() : std::prev(ready.end());
+        ready.erase(farthest);
+    }
+}
+
+//--------------------------------------------------------------
+void ScrubLoader::loadLoop(){
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (running) {
+        if (queue.empty()) {
+            condition.wait(lock);
+            continue;
+        }
+        Job job = queue.front();
+        queue.pop_front();
+        if (!frameList || job.index < 0 || job.index >= (int)frameList->size()) {
+            continue;
+        }
+        string path = frameList->getPath(job.index);
+        int width = scrubWidth;
+        int jobGeneration = generation;
+        if (!job.full) {
+            loading.insert(job.index);
+        }
+
+        lock.unlock();
+        shared_ptr<const ofPixels> pixels;
+        if (job.full) {
+            pixels = cache->load(path);
+        } else {
+            // A proxy is a small JPEG, cheaper than even a reduced decode of the frame
+            string proxyPath = proxies->getProxyPath(job.index, width);
+            if (!proxyPath.empty()) {
+                pixels = cache->load(proxyPath);
+            }
+            if (!pixels) {
+                pixels = cache->load(path, width, 0);
+            }
+        }
+        lock.lock();
+
+        if (!job.full) {
+            loading.erase(job.index);
+        }
+        if (!pixels || jobGeneration != generation) {
+            continue;
+        }
+        if (job.full) {
+            if (settled && job.index == target) {
+                settledFrame.index = job.index;
+                settledFrame.pixels = pixels;
+                settledFrame.full = true;
+            }
+        } else if (width == scrubWidth) {
+            // Loads for requests that were overtaken are kept only while near the newest one
+            ready[job.index] = pixels;
+            trimReady();
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "ofMain.h"
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include "FrameCache.h"
+#include "FrameList.h"
+#include "ProxyCache.h"
+
+// Loads frames for the scrub slider in the background, so dragging it never waits
+// on the disk and every slider event counts instead of being debounced away.
+//
+// request() is latest-wins: it replaces every load that hasn't started. A decode
+// can't be interrupted, so loads already running finish into the FrameCache, but
+// their frames are only kept while they are near the newest request. Alongside the frame
+// asked for, it queues the frames the slider is heading for. Scrub velocity is
+// estimated from the timing of requests, and frames are predicted one display frame
+// apart up to LOOKAHEAD seconds ahead, so at a steady drag the next target is usually
+// decoded before the slider gets there. Slow drags also queue the frames on either
+// side, in case the direction changes.
+//
+// Frames load at scrubbing width, from the frame's proxy when it has one and
+// otherwise reduced out of the JPEG DCT (see FrameCache). Once scrubbing stops,
+// settle() loads the frame at full size.
+class ScrubLoader {
+public:
+	struct Frame {
+		int index = -1;
+		shared_ptr<const ofPixels> pixels;
+		bool full = false;  // full size, from settle()
+	};
+	
+	~ScrubLoader();
+	
+	void setup(FrameCache& cache, ProxyCache& proxies, int numThreads = 2);
+	void close();
+	
+	void setFrameList(shared_ptr<const FrameList> frameList);
+	void setScrubWidth(int width);
+	
+	// The slider is at index, within rangeStart..rangeEnd
+	void request(int index, int rangeStart, int rangeEnd);
+	// Scrubbing stopped at index: load it at full size next
+	void settle(int index);
+	// Playback has moved on from the slider: forget the request, so take() has
+	// nothing to show until the next one
+	void cancel();
+	
+	// The frame to show for the latest request: the requested frame once it is loaded,
+	// meanwhile the nearest one that is. False if that is no closer than the last one
+	// returned. Never blocks on a load.
+	bool take(Frame& frame);
+	
+	// Requests whose frame was already loaded when they came in, 0 to 1
+	float getHitRate();
+	// Frames per second the slider is moving, signed
+	float getVelocity();
+	
+	static const float LOOKAHEAD;   // seconds of scrubbing predicted ahead
+	static const int MAX_PREDICTED = 8;
+	static const int MAX_READY = 32;  // loaded frames kept around the target
+	
+private:
+	struct Job {
+		int index = -1;
+		bool full = false;
+	};
+	
+	void plan();
+	void trimReady();
+	void loadLoop();
+	
+	FrameCache* cache = nullptr;
+	ProxyCache* proxies = nullptr;
+	shared_ptr<const FrameList> frameList;
+	int scrubWidth = 320;
+	
+	int target = -1;
+	int rangeStart = 0;
+	int rangeEnd = 0;
+	bool settled = false;
+	double lastRequestTime = 0;
+	float velocity = 0;        // frames per second, smoothed
+	float predictionStep = 1.0f / 60;  // a display frame, in seconds
+	
+	std::deque<Job> queue;     // target first, then the predicted frames, soonest first
+	std::set<int> loading;
+	std::map<int, shared_ptr<const ofPixels>> ready;  // loaded at scrubbing width
+	Frame settledFrame;        // full size, once settle()'s load finishes
+	int generation = 0;        // bumped when the frame list changes
+	int shownIndex = -1;       // last frame handed out by take()
+	bool shownFull = false;
+	uint64_t numRequests = 0;
+	uint64_t numHits = 0;
+	
+	vector<std::thread> workers;
+	bool running = false;
+	std::mutex mutex;
+	std::condition_variable condition;
+};
@@ -0,0 +1,359 @@
+#include "SequenceExporter.h"
+#include "FolderScanner.h"
+#include "FrameCache.h"
+#include "FrameList.h"
+#include "FramePrefetcher.h"
+#include "PlaybackClock.h"
+#include "PlaybackCursor.h"
+#include "Resampler.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    // Frames queued for the writers per writer thread; bounds memory when encoding is the bottleneck
+    const int JOBS_PER_WRITER = 2;
+
+    const uint64_t CACHE_BUDGET_BYTES = 2048ull * 1024 * 1024;  // ofApp's default RAM budget
+
+    bool parseRange(const string& text, int& first, int& last) {
+        vector<string> parts = ofSplitString(text, "-", true, true);
+        if (parts.size() != 2) {
+            return false;
+        }
+        first = ofToInt(parts[0]) - 1;
+        last = ofToInt(parts[1]) - 1;
+        return first >= 0 && last >= first;
+    }
+
+    bool parseSize(const string& text, int& width, int& height) {
+        vector<string> parts = ofSplitString(ofToLower(text), "x", true, true);
+        if (parts.size() != 2) {
+            return false;
+        }
+        width = ofToInt(parts[0]);
+        height = ofToInt(parts[1]);
+        return width > 0 && height > 0;
+    }
+}
+
+//--------------------------------------------------------------
+bool SequenceExporter::isRequested(const vector<string>& arguments){
+    return std::find(arguments.begin(), arguments.end(), "--export") != arguments.end();
+}
+
+//--------------------------------------------------------------
+void SequenceExporter::printUsage(){
+    std::cerr << "usage: SequenceStreamer --export <folder> [options]\n"
+              << "  --output <path>               folder for image formats, file for raw (default <folder>_export)\n"
+              << "  --format png|jpg|tif|raw      raw writes 8-bit RGB frames back to back into one file\n"
+              << "  --range 1-100                 frames to play, 1-based and inclusive (default all)\n"
+              << "  --speed 1.0                   playback speed, 1.0 = 30 fps like the speed slider\n"
+              << "  --reverse                     play backwards\n"
+              << "  --pingpong                    bounce at the range ends instead of looping\n"
+              << "  --size 1920x1080              output size\n"
+              << "  --stretch                     fill the output instead of keeping the aspect ratio\n"
+              << "  --fps 30                      output frame rate\n"
+              << "  --frames 0                    output frames, 0 = one pass through the range\n"
+              << "  --brightness 0 --contrast 1 --saturation 1\n"
+              << "  --threads 0                   writer threads, 0 = one per core\n";
+}
+
+//--------------------------------------------------------------
+bool SequenceExporter::parseArguments(const vector<string>& arguments){
+    for (size_t i = 0; i < arguments.size(); i++) {
+        const string& argument = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+        if (argument == "--export") {
+            if (hasValue) {
+                inputDirectory = ofFilePath::removeTrailingSlash(ofFilePath::getAbsolutePath(arguments[++i], false));
+            }
+        } else if (argument == "--output" && hasValue) {
+            output = ofFilePath::getAbsolutePath(arguments[++i], false);
+        } else if (argument == "--format" && hasValue) {
+            format = ofToLower(arguments[++i]);
+        } else if (argument == "--range" && hasValue) {
+            if (!parseRange(arguments[++i], rangeStart, rangeEnd)) {
+                std::cerr << "Bad range: " << arguments[i] << "\n";
+                return false;
+            }
+        } else if (argument == "--speed" && hasValue) {
+            speed = ofToFloat(arguments[++i]);
+        } else if (argument == "--reverse") {
+            reverse = true;
+        } else if (argument == "--pingpong") {
+            pingPong = true;
+        } else if (argument == "--size" && hasValue) {
+            if (!parseSize(arguments[++i], width, height)) {
+                std::cerr << "Bad size: " << arguments[i] << "\n";
+                return false;
+            }
+        } else if (argument == "--stretch") {
+            maintainAspectRatio = false;
+        } else if (argument == "--fps" && hasValue) {
+            outputFps = ofToFloat(arguments[++i]);
+        } else if (argument == "--frames" && hasValue) {
+            numOutputFrames = std::max(0, ofToInt(arguments[++i]));
+        } else if (argument == "--brightness" && hasValue) {
+            colorSettings.brightness = ofClamp(ofToFloat(arguments[++i]), -1, 1);
+        } else if (argument == "--contrast" && hasValue) {
+            colorSettings.contrast = ofClamp(ofToFloat(arguments[++i]), 0, 2);
+        } else if (argument == "--saturation" && hasValue) {
+            colorSettings.saturation = ofClamp(ofToFloat(arguments[++i]), 0, 2);
+        } else if (argument == "--threads" && hasValue) {
+            numThreads = std::max(0, ofToInt(arguments[++i]));
+        } else {
+            std::cerr << "Unknown argument: " << argument << "\n";
+            return false;
+        }
+    }
+
+    if (inputDirectory.empty() || !ofDirectory::doesDirectoryExist(inputDirectory, false)) {
+        std::cerr << "Export needs an existing folder\n";
+        return false;
+    }
+    if (format != "png" && format != "jpg" && format != "tif" && format != "raw") {
+        std::cerr << "Unknown format: " << format << "\n";
+        return false;
+    }
+    if (speed <= 0 || outputFps <= 0) {
+        std::cerr << "Speed and fps must be positive\n";
+        return false;
+    }
+    if (output.empty()) {
+        output = inputDirectory + "_export" + (format == "raw" ? ".rgb" : "");
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+bool SequenceExporter::run(){
+    vector<string> names = FolderScanner::getSortedNames(FolderScanner::scan(inputDirectory, {}));
+    auto frameList = make_shared<FrameList>(inputDirectory, names);
+    if (frameList->empty()) {
+        std::cerr << "No frames in " << inputDirectory << "\n";
+        return false;
+    }
+    int lastFrame = frameList->size() - 1;
+    if (rangeEnd < 0 || rangeEnd > lastFrame) {
+        rangeEnd = lastFrame;
+    }
+    if (rangeStart > rangeEnd) {
+        std::cerr << "Range starts after the last frame (" << frameList->size() << ")\n";
+        return false;
+    }
+
+    // One pass: every frame of the range once, or there and back again for ping-pong
+    int rangeLength = rangeEnd - rangeStart + 1;
+    double framesPerSecond = baseFps * speed;
+    double sourcePerOutput = framesPerSecond / outputFps;
+    if (numOutputFrames == 0) {
+        int sourceFrames = pingPong ? std::max(1, 2 * (rangeLength - 1)) : rangeLength;
+        numOutputFrames = std::max(1, (int)std::ceil(sourceFrames / sourcePerOutput));
+    }
+
+    if (format == "raw") {
+        rawFile = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (rawFile < 0) {
+            std::cerr << "Could not create " << output << "\n";
+            return false;
+        }
+    } else if (!ofDirectory::createDirectory(output, false, true) && !ofDirectory::doesDirectoryExist(output, false)) {
+        std::cerr << "Could not create " << output << "\n";
+        return false;
+    }
+
+    // The decode side is set up like ofApp's: decoders in the prefetcher, frames decoded
+    // and resampled to the output size when it is smaller than the source
+    FrameCache cache;
+    cache.setBudget(CACHE_BUDGET_BYTES);
+    cache.setDecodeSize(width, height, maintainAspectRatio);
+    FramePrefetcher prefetcher;
+    prefetcher.setup(ringSize, cache);
+    prefetcher.setFrameList(frameList);
+
+    PlaybackClock clock;
+    clock.setRefreshPeriod(1.0 / outputFps);
+    clock.reset(0);
+    PlaybackCursor cursor;
+    cursor.rangeStart = rangeStart;
+    cursor.rangeEnd = rangeEnd;
+    cursor.loopMode = pingPong ? PING_PONG : LOOP;
+    cursor.direction = reverse ? BACKWARD : FORWARD;
+    cursor.index = reverse ? rangeEnd : rangeStart;
+    cursor.stride = clock.getFramesPerRefresh(framesPerSecond);
+    prefetcher.setPlayhead(cursor);
+
+    shared_ptr<const ofPixels> current = cache.load(frameList->getPath(cursor.index));
+    if (!current) {
+        std::cerr << "Could not decode " << frameList->getPath(cursor.index) << "\n";
+        return false;
+    }
+
+    int numWriters = numThreads > 0 ? numThreads : std::max(1u, std::thread::hardware_concurrency());
+    vector<std::thread> writers;
+    for (int i = 0; i < numWriters; i++) {
+        writers.emplace_back(&SequenceExporter::writeLoop, this);
+    }
+    std::cerr << "Exporting " << numOutputFrames << " frames of " << inputDirectory << " at "
+              << width << "x" << height << " to " << output << "\n";
+
+    uint64_t start = ofGetElapsedTimeMicros();
+    uint64_t lastReport = start;
+    for (int frame = 0; frame < numOutputFrames; frame++) {
+        if (frame > 0) {
+            // ofApp::update() with the virtual clock, except that nothing is dropped:
+            // there's no deadline, so wait for the decoders instead
+            int owedFrames = clock.update(frame / (double)outputFps, framesPerSecond);
+            if (owedFrames > 0) {
+                PlaybackCursor next = cursor;
+                next.step(owedFrames);
+                shared_ptr<const ofPixels> pixels;
+                while (!prefetcher.takeFrame(next.index, pixels) && !prefetcher.isFailed(next.index)) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+                if (pixels) {
+                    current = pixels;
+                }
+                clock.consume(owedFrames);
+                cursor.index = next.index;
+                cursor.direction = next.direction;
+            }
+            cursor.stride = clock.getFramesPerRefresh(framesPerSecond);
+            cursor.phase = clock.getOwedFrames();
+            prefetcher.setPlayhead(cursor);
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&]{ return (int)jobs.size() < numWriters * JOBS_PER_WRITER; });
+        jobs.push_back({frame, current});
+        condition.notify_all();
+        lock.unlock();
+
+        uint64_t now = ofGetElapsedTimeMicros();
+        if (now - lastReport > 1000000) {
+            std::cerr << numWritten << "/" << numOutputFrames << " frames, "
+                      << ofToString(numWritten * 1000000.0 / (now - start), 1) << " fps\n";
+            lastReport = now;
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished = true;
+        condition.notify_all();
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    double seconds = (ofGetElapsedTimeMicros() - start) / 1000000.0;
+    prefetcher.close();
+    if (rawFile >= 0) {
+        ::close(rawFile);
+        rawFile = -1;
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "{\"output\":\"" << output << "\""
+              << ",\"format\":\"" << format << "\""
+              << ",\"width\":" << width
+              << ",\"height\":" << height
+              << ",\"frames\":" << numWritten
+              << ",\"failed\":" << numFailed
+              << ",\"seconds\":" << seconds
+              << ",\"fps\":" << (seconds > 0 ? numWritten / seconds : 0)
+              << ",\"decoded\":" << prefetcher.getNumDecoded()
+              << ",\"decode_threads\":" << prefetcher.getNumThreads()
+              << ",\"writer_threads\":" << numWriters
+              << "}" << std::endl;
+    if (format == "raw") {
+        std::cerr << "Play with: ffplay -f rawvideo -pixel_format rgb24 -video_size " << width << "x" << height
+                  << " -framerate " << outputFps << " \"" << output << "\"\n";
+    }
+    return numFailed == 0;
+}
+
+//--------------------------------------------------------------
+void SequenceExporter::writeLoop(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this]{ return !jobs.empty() || finished; });
+        if (jobs.empty()) {
+            return;
+        }
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        condition.notify_all();
+
+        lock.unlock();
+        if (writeFrame(job)) {
+            numWritten++;
+        } else {
+            numFailed++;
+        }
+        lock.lock();
+    }
+}
+
+//--------------------------------------------------------------
+bool SequenceExporter::writeFrame(const Job& job){
+    ofPixels frame;
+    renderFrame(*job.source, frame, width, height, maintainAspectRatio);
+    ColorAdjust::apply(frame, colorSettings);
+
+    if (rawFile >= 0) {
+        // Every frame has the same size, so each writer can put its own at its offset
+        off_t offset = (off_t)job.index * frame.size();
+        ssize_t written = pwrite(rawFile, frame.getData(), frame.size(), offset);
+        if (written != (ssize_t)frame.size()) {
+            ofLogError("SequenceExporter") << "Could not write frame " << job.index << " to " << output;
+            return false;
+        }
+        return true;
+    }
+    string path = getFramePath(job.index);
+    if (!ofSaveImage(frame, path, OF_IMAGE_QUALITY_BEST)) {
+        ofLogError("SequenceExporter") << "Could not write " << path;
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+string SequenceExporter::getFramePath(int index) const {
+    return ofFilePath::join(output, ofFilePath::getFileName(inputDirectory) + "_" + ofToString(index + 1, 5, '0') + "." + format);
+}
+
+//--------------------------------------------------------------
+void SequenceExporter::renderFrame(const ofPixels& source, ofPixels& output, int width, int height, bool maintainAspectRatio){
+    // Everything is written as RGB; alpha has nothing to composite over but black anyway
+    ofPixels converted;
+    const ofPixels* frame = &source;
+    if (source.getNumChannels() != 3) {
+        converted = source;
+        converted.setImageType(OF_IMAGE_COLOR);
+        frame = &converted;
+    }
+
+    // The same fit as the Syphon FBO in ofApp::draw() and the frame cache's
+    int drawWidth = width;
+    int drawHeight = height;
+    if (maintainAspectRatio) {
+        Resampler::getFitSize(frame->getWidth(), frame->getHeight(), width, height, true, drawWidth, drawHeight);
+    }
+
+    ofPixels scaled;
+    if ((int)frame->getWidth() == drawWidth && (int)frame->getHeight() == drawHeight) {
+        scaled = *frame;
+    } else {
+        scaled.allocate(drawWidth, drawHeight, OF_PIXELS_RGB);
+        Resampler::resize(frame->getData(), frame->getWidth(), frame->getHeight(), 3,
+                          scaled.getData(), drawWidth, drawHeight, Resampler::LANCZOS3);
+    }
+    if (drawWidth == width && drawHeight == height) {
+        output = std::move(scaled);
+        return;
+    }
+    output.allocate(width, height, OF_PIXELS_RGB);
+    output.setColor(ofColor(0));
+    scaled.pasteInto(output, (width - drawWidth) / 2, (height - drawHeight) / 2);
+}
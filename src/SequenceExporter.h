@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ofMain.h"
+#include <condition_variable>
+#include <deque>
+#include "ColorAdjust.h"
+
+// Offline render of a folder's frame range to a new image sequence or a raw RGB
+// video file, without opening a window: SequenceStreamer --export <folder> [options].
+//
+// Playback runs the same PlaybackCursor/PlaybackClock stepping ofApp::update() does,
+// but against a virtual clock at the output frame rate, and waits for the decoders
+// instead of dropping frames, so it goes as fast as FramePrefetcher can decode.
+// Frames are fitted (or stretched) to the output size like the Syphon output, color
+// adjusted on the CPU and encoded and written by a pool of writer threads.
+//
+// Progress goes to stderr; a JSON summary with frames per second goes to stdout.
+class SequenceExporter {
+public:
+	static bool isRequested(const vector<string>& arguments);
+	static void printUsage();
+	bool parseArguments(const vector<string>& arguments);
+	bool run();
+
+	// Scales source into width x height RGB, centered on black when keeping the aspect ratio
+	static void renderFrame(const ofPixels& source, ofPixels& output, int width, int height, bool maintainAspectRatio);
+
+private:
+	struct Job {
+		int index;
+		shared_ptr<const ofPixels> source;
+	};
+
+	void writeLoop();
+	bool writeFrame(const Job& job);
+	string getFramePath(int index) const;
+
+	string inputDirectory;
+	string output;
+	string format = "png";     // png, jpg, tif or raw
+	int rangeStart = 0;        // 0-based, inclusive; -1 = to the last frame
+	int rangeEnd = -1;
+	float speed = 1;           // multiple of baseFps, like the speed slider
+	bool reverse = false;
+	bool pingPong = false;
+	int width = 1920;          // matches ofApp's default Syphon size
+	int height = 1080;
+	bool maintainAspectRatio = true;
+	float outputFps = 30;
+	int numOutputFrames = 0;   // 0 = one pass through the range
+	int numThreads = 0;        // writers; 0 = one per core
+	ColorAdjust::Settings colorSettings;
+
+	float baseFps = 30;        // matches ofApp::BASE_FPS
+	int ringSize = 8;          // matches ofApp::PREFETCH_RING_SIZE
+
+	std::deque<Job> jobs;
+	bool finished = false;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::atomic<int> numWritten{0};
+	std::atomic<int> numFailed{0};
+	int rawFile = -1;
+};
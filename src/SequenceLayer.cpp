@@ -0,0 +1,159 @@
+#include "SequenceLayer.h"
+
+//--------------------------------------------------------------
+SequenceLayer::~SequenceLayer(){
+    close();
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::setup(const string& layerName, FrameCache& frameCache, DecodePool& pool, int ringSize, int uploadBuffers){
+    name = layerName;
+    cache = &frameCache;
+    prefetcher.setup(ringSize, frameCache, pool);
+    uploader.setup(uploadBuffers);
+    outputGraph.setup();
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::close(){
+    watcher.close();
+    prefetcher.close();
+    uploader.clear();
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::load(const string& path, float pollInterval){
+    directory = path;
+    frameList.reset();
+    prefetcher.setFrameList(frameList);
+    cursor.index = 0;
+    rangeSetByUser = false;
+    // Frames follow from update() once the watcher's first scan is published
+    watcher.watch(path, pollInterval);
+    ofLogNotice("SequenceLayer") << name << " plays " << path;
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::setPlaying(bool isPlaying){
+    playing = isPlaying;
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::setRange(int start, int end){
+    cursor.rangeStart = std::min(start, end);
+    cursor.rangeEnd = std::max(start, end);
+    rangeSetByUser = true;
+    clampRange();
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::setOutputSize(int width, int height, bool maintainAspectRatio){
+    outputGraph.setOutput(name, width, height, maintainAspectRatio);
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::update(double now, float baseFps){
+    shared_ptr<const FrameList> latest = watcher.getFrameList();
+    if (latest && latest != frameList) {
+        applyFrameList(latest);
+    }
+
+    if (playing && getNumFrames() > 0 && speed > 0) {
+        int owedFrames = clock.update(now, baseFps * speed);
+        if (owedFrames > 0) {
+            PlaybackCursor next = getCursor(baseFps);
+            next.step(owedFrames);
+            // Like the main player: only frames already decoded are shown, the rest stay owed.
+            // A frame that can't be decoded is stepped over rather than waited for forever.
+            shared_ptr<const ofPixels> frame;
+            bool ready = prefetcher.takeFrame(next.index, frame);
+            if (ready || prefetcher.isFailed(next.index)) {
+                if (frame) {
+                    uploader.upload(*frame);
+                }
+                clock.consume(owedFrames);
+                cursor.index = next.index;
+                cursor.direction = next.direction;
+            } else {
+                numLate++;
+            }
+        }
+    } else {
+        clock.reset(now);
+    }
+
+    prefetcher.setPlayhead(getCursor(baseFps));
+}
+
+//--------------------------------------------------------------
+bool SequenceLayer::render(bool black, const ofRectangle& previewArea){
+    if (uploader.update() || !texture.isAllocated()) {
+        texture = uploader.getTexture();
+        if (texture.isAllocated()) {
+            outputGraph.setSource(texture);
+        }
+    }
+    outputGraph.setBlack(black);
+    outputGraph.setPreviewArea(previewArea);
+    return outputGraph.update();
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::drawPreview(const ofRectangle& area) const {
+    outputGraph.drawPreview(area);
+}
+
+//--------------------------------------------------------------
+PlaybackCursor SequenceLayer::getCursor(float baseFps) const {
+    PlaybackCursor current = cursor;
+    current.stride = clock.getFramesPerRefresh(baseFps * speed);
+    current.phase = clock.getOwedFrames();
+    return current;
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::applyFrameList(shared_ptr<const FrameList> newFrameList){
+    bool first = !frameList;
+    frameList = newFrameList;
+    prefetcher.setFrameList(frameList);
+    if (!rangeSetByUser) {
+        // Grows with the folder until a range is picked
+        cursor.rangeStart = 0;
+        cursor.rangeEnd = std::max(0, getNumFrames() - 1);
+    }
+    clampRange();
+    if (first && getNumFrames() > 0) {
+        ofLogNotice("SequenceLayer") << name << ": " << getNumFrames() << " frames";
+        // While playing, the first frame comes from the prefetcher like all the others
+        if (!playing) {
+            showFrame(cursor.index);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::clampRange(){
+    int last = std::max(0, getNumFrames() - 1);
+    cursor.rangeStart = ofClamp(cursor.rangeStart, 0, last);
+    cursor.rangeEnd = ofClamp(cursor.rangeEnd, cursor.rangeStart, last);
+    int index = ofClamp(cursor.index, cursor.rangeStart, cursor.rangeEnd);
+    if (index != cursor.index) {
+        cursor.index = index;
+        if (!playing) {
+            // Otherwise the next frame played shows the new range
+            showFrame(index);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void SequenceLayer::showFrame(int index){
+    if (index < 0 || index >= getNumFrames()) {
+        return;
+    }
+    // Off the pool, like the main player's loadFrame(); only happens while the layer is paused
+    shared_ptr<const ofPixels> frame = cache->load(frameList->getPath(index));
+    if (frame) {
+        uploader.upload(*frame);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ofMain.h"
+#include "PlaybackCursor.h"
+#include "PlaybackClock.h"
+#include "FramePrefetcher.h"
+#include "DirectoryWatcher.h"
+#include "TextureUploader.h"
+#include "OutputGraph.h"
+
+// One more sequence playing next to the main one, with its own folder, range,
+// speed, direction, loop mode and output. Layers decode on the app's DecodePool
+// through its FrameCache, so all of them share the cores and the RAM budget, and
+// the pool takes their frames in turn (see DecodePool).
+//
+// A layer steps its own PlaybackClock the way ofApp::update() does for the main
+// sequence and renders into an OutputGraph with a single output named after the
+// layer, which the app publishes like its own outputs. Folders are watched, so
+// frames landing in a layer's folder are picked up too; packs, scrubbing and
+// proxies are main-sequence only.
+// Must be used from the thread that owns the GL context.
+class SequenceLayer {
+public:
+	~SequenceLayer();
+	
+	void setup(const string& name, FrameCache& cache, DecodePool& pool, int ringSize, int uploadBuffers);
+	void close();
+	
+	void load(const string& directory, float pollInterval = 2.0f);
+	const string& getName() const { return name; }
+	const string& getDirectory() const { return directory; }
+	int getNumFrames() const { return frameList ? frameList->size() : 0; }
+	int getCurrentFrame() const { return cursor.index; }
+	
+	void setPlaying(bool playing);
+	bool isPlaying() const { return playing; }
+	// Multiple of the base frame rate passed to update()
+	void setSpeed(float speed) { this->speed = speed; }
+	float getSpeed() const { return speed; }
+	void setDirection(Direction direction) { cursor.direction = direction; }
+	Direction getDirection() const { return cursor.direction; }
+	void setLoopMode(LoopMode loopMode) { cursor.loopMode = loopMode; }
+	LoopMode getLoopMode() const { return cursor.loopMode; }
+	// Frames start to end, inclusive; kept within the sequence as it grows or shrinks
+	void setRange(int start, int end);
+	int getRangeStart() const { return cursor.rangeStart; }
+	int getRangeEnd() const { return cursor.rangeEnd; }
+	
+	void setOutputSize(int width, int height, bool maintainAspectRatio);
+	OutputGraph& getOutputGraph() { return outputGraph; }
+	FramePrefetcher& getPrefetcher() { return prefetcher; }
+	// Frames that weren't decoded in time and were shown late
+	uint64_t getNumLate() const { return numLate; }
+	
+	// Picks up folder changes and steps playback; call from update()
+	void update(double now, float baseFps);
+	// Swaps in a frame whose upload landed and redraws the output if anything changed.
+	// Returns true if it was, so the output needs publishing.
+	bool render(bool black, const ofRectangle& previewArea);
+	void drawPreview(const ofRectangle& area) const;
+	
+private:
+	PlaybackCursor getCursor(float baseFps) const;
+	void applyFrameList(shared_ptr<const FrameList> newFrameList);
+	void clampRange();
+	void showFrame(int index);
+	
+	string name;
+	string directory;
+	FrameCache* cache = nullptr;
+	DirectoryWatcher watcher;
+	shared_ptr<const FrameList> frameList;
+	FramePrefetcher prefetcher;
+	TextureUploader uploader;
+	ofTexture texture;
+	OutputGraph outputGraph;
+	PlaybackClock clock;
+	PlaybackCursor cursor;
+	bool playing = false;
+	float speed = 1;
+	bool rangeSetByUser = false;
+	uint64_t numLate = 0;
+};
@@ -0,0 +1,295 @@
+#include "SequencePack.h"
+#include "Lz4Codec.h"
+#include "BlockCompression.h"
+#include "PixelConvert.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char SequencePack::MAGIC[8] = {'S', 'S', 'P', 'A', 'C', 'K', '\0', '\0'};
+
+namespace {
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+//--------------------------------------------------------------
+SequencePack::~SequencePack(){
+    close();
+}
+
+//--------------------------------------------------------------
+bool SequencePack::open(const string& packPath){
+    close();
+    
+    int fd = ::open(packPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        ofLogError("SequencePack") << "Could not open " << packPath;
+        return false;
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(Header)) {
+        ofLogError("SequencePack") << "Not a sequence pack: " << packPath;
+        ::close(fd);
+        return false;
+    }
+    
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // the mapping keeps the file alive
+    if (mapped == MAP_FAILED) {
+        ofLogError("SequencePack") << "Could not map " << packPath;
+        return false;
+    }
+    
+    mapping = (unsigned char*)mapped;
+    mappingSize = info.st_size;
+    header = (const Header*)mapping;
+    index = (const IndexEntry*)(mapping + sizeof(Header));
+    path = packPath;
+    
+    // Validate everything the frame lookups rely on before trusting the file
+    bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header->version == VERSION &&
+                 header->channels == 4 &&
+                 header->width > 0 && header->height > 0 &&
+                 sizeof(Header) + (uint64_t)header->frameCount * sizeof(IndexEntry) <= mappingSize;
+    for (uint32_t i = 0; valid && i < header->frameCount; i++) {
+        valid = index[i].offset + index[i].size <= mappingSize;
+    }
+    if (!valid) {
+        ofLogError("SequencePack") << "Corrupt or unsupported pack: " << packPath;
+        close();
+        return false;
+    }
+    
+    if (header->flags & FLAG_LZ4) {
+        frameBuffer.resize(getFrameSize());
+    }
+    
+    static const char* formatNames[] = {"RGBA", "BC1", "BC3"};
+    ofLogNotice("SequencePack") << "Opened " << packPath << ": " << header->frameCount << " frames at "
+                                << header->width << "x" << header->height << " " << formatNames[getFormat()]
+                                << ((header->flags & FLAG_LZ4) ? " (LZ4)" : "");
+    return true;
+}
+
+//--------------------------------------------------------------
+void SequencePack::close(){
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    index = nullptr;
+    path.clear();
+    frameBuffer.clear();
+    frameBuffer.shrink_to_fit();
+}
+
+//--------------------------------------------------------------
+const unsigned char* SequencePack::getFrame(int frame){
+    if (!isOpen() || frame < 0 || frame >= (int)header->frameCount) {
+        return nullptr;
+    }
+    
+    const IndexEntry& entry = index[frame];
+    size_t frameBytes = getFrameSize();
+    
+    if (header->flags & FLAG_LZ4) {
+        if (!Lz4Codec::decompress(mapping + entry.offset, entry.size, frameBuffer.data(), frameBytes)) {
+            ofLogWarning("SequencePack") << "Corrupt frame " << frame << " in " << path;
+            return nullptr;
+        }
+        return frameBuffer.data();
+    }
+    
+    if (entry.size < frameBytes) {
+        return nullptr;
+    }
+    return mapping + entry.offset;
+}
+
+//--------------------------------------------------------------
+SequencePack::Format SequencePack::getFormat() const {
+    if (header && (header->flags & FLAG_BC1)) {
+        return FORMAT_BC1;
+    }
+    if (header && (header->flags & FLAG_BC3)) {
+        return FORMAT_BC3;
+    }
+    return FORMAT_RGBA;
+}
+
+//--------------------------------------------------------------
+size_t SequencePack::getFrameSize() const {
+    if (!header) {
+        return 0;
+    }
+    switch (getFormat()) {
+        case FORMAT_BC1:
+            return BlockCompression::getCompressedSize(header->width, header->height, BlockCompression::BC1);
+        case FORMAT_BC3:
+            return BlockCompression::getCompressedSize(header->width, header->height, BlockCompression::BC3);
+        default:
+            return (size_t)header->width * header->height * header->channels;
+    }
+}
+
+//--------------------------------------------------------------
+void SequencePack::prefetch(int frame){
+    if (!isOpen() || frame < 0 || frame >= (int)header->frameCount) {
+        return;
+    }
+    // madvise wants a start aligned to the VM page size (16k on Apple silicon)
+    uint64_t pageSize = getpagesize();
+    uint64_t start = index[frame].offset / pageSize * pageSize;
+    uint64_t length = index[frame].offset + index[frame].size - start;
+    madvise(mapping + start, length, MADV_WILLNEED);
+}
+
+//--------------------------------------------------------------
+SequencePackWriter::~SequencePackWriter(){
+    // Abandons a pack still being written; write() sees the stop before the next frame
+    waitForThread(true);
+}
+
+//--------------------------------------------------------------
+bool SequencePackWriter::start(const string& path, const vector<string>& paths, bool useCompression, bool useBlockCompression){
+    if (isThreadRunning()) {
+        return false;
+    }
+    // Reap the previous run before reusing the thread
+    waitForThread(false);
+    
+    packPath = path;
+    framePaths = paths;
+    compress = useCompression;
+    blockCompress = useBlockCompression;
+    progress = 0;
+    succeeded = false;
+    startThread();
+    return true;
+}
+
+//--------------------------------------------------------------
+void SequencePackWriter::threadedFunction(){
+    succeeded = write();
+    if (succeeded) {
+        ofLogNotice("SequencePackWriter") << "Wrote " << framePaths.size() << " frames to " << packPath;
+    }
+}
+
+//--------------------------------------------------------------
+bool SequencePackWriter::write(){
+    if (framePaths.empty()) {
+        return false;
+    }
+    
+    // Write to a temp file and rename at the end so a half-written pack is never opened
+    string tempPath = packPath + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        ofLogError("SequencePackWriter") << "Could not create " << tempPath;
+        return false;
+    }
+    
+    SequencePack::Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SequencePack::MAGIC, sizeof(header.magic));
+    header.version = SequencePack::VERSION;
+    header.channels = 4;
+    header.frameCount = framePaths.size();
+    header.flags = compress ? SequencePack::FLAG_LZ4 : 0;
+    header.dataOffset = alignUp(sizeof(header) + framePaths.size() * sizeof(SequencePack::IndexEntry), SequencePack::PACK_ALIGNMENT);
+    
+    vector<SequencePack::IndexEntry> index(framePaths.size());
+    vector<unsigned char> compressed;
+    vector<unsigned char> blocks;
+    BlockCompression::Format blockFormat = BlockCompression::BC1;
+    uint64_t offset = header.dataOffset;
+    bool ok = true;
+    
+    for (size_t i = 0; i < framePaths.size() && ok && isThreadRunning(); i++) {
+        ofPixels decoded;
+        if (!ofLoadImage(decoded, framePaths[i])) {
+            ofLogError("SequencePackWriter") << "Could not decode " << framePaths[i];
+            ok = false;
+            break;
+        }
+        ofPixels pixels;
+        int channels = decoded.getNumChannels();
+        if (channels == 1 || channels == 3 || channels == 4) {
+            pixels.allocate(decoded.getWidth(), decoded.getHeight(), OF_PIXELS_RGBA);
+            PixelConvert::toFourChannels(decoded.getData(), channels, pixels.getData(),
+                                         decoded.getWidth() * decoded.getHeight(), PixelConvert::RGBA);
+        } else {
+            pixels = decoded;
+            pixels.setImageType(OF_IMAGE_COLOR_ALPHA);
+        }
+        
+        // The first frame fixes the pack's size and block format
+        if (i == 0) {
+            header.width = pixels.getWidth();
+            header.height = pixels.getHeight();
+            uint64_t frameSize = (uint64_t)header.width * header.height * 4;
+            if (blockCompress) {
+                bool alpha = BlockCompression::hasAlpha(pixels.getData(), header.width, header.height);
+                blockFormat = alpha ? BlockCompression::BC3 : BlockCompression::BC1;
+                header.flags |= alpha ? SequencePack::FLAG_BC3 : SequencePack::FLAG_BC1;
+                frameSize = BlockCompression::getCompressedSize(header.width, header.height, blockFormat);
+                blocks.resize(frameSize);
+            }
+            header.frameStride = alignUp(frameSize, SequencePack::PACK_ALIGNMENT);
+        } else if (pixels.getWidth() != header.width || pixels.getHeight() != header.height) {
+            ofLogWarning("SequencePackWriter") << "Resizing " << framePaths[i] << " to " << header.width << "x" << header.height;
+            pixels.resize(header.width, header.height, OF_INTERPOLATE_BICUBIC);
+        }
+        
+        const unsigned char* data = pixels.getData();
+        size_t size = pixels.getTotalBytes();
+        uint64_t slot = header.frameStride;
+        if (blockCompress) {
+            BlockCompression::encode(data, header.width, header.height, blockFormat, blocks.data());
+            data = blocks.data();
+            size = blocks.size();
+        }
+        if (compress) {
+            compressed.resize(Lz4Codec::compressBound(size));
+            size = Lz4Codec::compress(data, size, compressed.data(), compressed.size());
+            data = compressed.data();
+            slot = alignUp(size, 64);
+        }
+        
+        if (fseek(file, offset, SEEK_SET) != 0 || fwrite(data, 1, size, file) != size) {
+            ok = false;
+            break;
+        }
+        index[i].offset = offset;
+        index[i].size = size;
+        offset += slot;
+        progress = (i + 1) / (float)framePaths.size();
+    }
+    
+    // Pad the last frame out to its slot, then write the header and index up front
+    if (ok && offset > index.back().offset + index.back().size) {
+        const unsigned char zero = 0;
+        ok = fseek(file, offset - 1, SEEK_SET) == 0 && fwrite(&zero, 1, 1, file) == 1;
+    }
+    ok = ok && isThreadRunning() &&
+         fseek(file, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fwrite(index.data(), sizeof(SequencePack::IndexEntry), index.size(), file) == index.size();
+    ok = (fclose(file) == 0) && ok;
+    
+    if (!ok || std::rename(tempPath.c_str(), packPath.c_str()) != 0) {
+        ofLogError("SequencePackWriter") << "Failed to write " << packPath;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
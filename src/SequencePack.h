@@ -0,0 +1,109 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Single-file container for a whole image sequence (.sspack).
+//
+// Layout (little endian):
+//   Header, then one IndexEntry per frame, then the frame data starting on a
+//   page boundary. Frames are RGBA8, or BC1/BC3 blocks (see BlockCompression)
+//   that upload as compressed textures at 1/8 or 1/4 of the bandwidth.
+//   Uncompressed frames sit at a fixed page-aligned stride; LZ4 frames are
+//   stored back to back and located through the index.
+//
+// The player memory-maps the file, so an uncompressed frame is a pointer into
+// the mapping that goes straight to texture upload with no per-frame allocation.
+class SequencePack {
+public:
+	enum Flags {
+		FLAG_LZ4 = 1,
+		FLAG_BC1 = 2,
+		FLAG_BC3 = 4
+	};
+	
+	enum Format {
+		FORMAT_RGBA,
+		FORMAT_BC1,
+		FORMAT_BC3
+	};
+	
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t channels;
+		uint32_t frameCount;
+		uint32_t flags;
+		uint64_t frameStride;   // bytes between uncompressed frames
+		uint64_t dataOffset;    // first frame
+	};
+	
+	struct IndexEntry {
+		uint64_t offset;
+		uint64_t size;          // stored bytes (compressed size for LZ4 packs)
+	};
+	
+	static const char MAGIC[8];
+	static const uint32_t VERSION = 1;
+	static const uint64_t PACK_ALIGNMENT = 4096;
+	
+	~SequencePack();
+	
+	bool open(const string& path);
+	void close();
+	bool isOpen() const { return mapping != nullptr; }
+	
+	// Frame data (RGBA pixels or BC blocks, see getFormat()), valid until the next
+	// getFrame() call or close().
+	// Points into the mapping for uncompressed packs; LZ4 frames are expanded into
+	// a buffer allocated once at open(). Returns nullptr for a bad index or corrupt frame.
+	const unsigned char* getFrame(int index);
+	
+	// Ask the kernel to start reading a frame in ahead of use
+	void prefetch(int index);
+	
+	int getNumFrames() const { return header ? header->frameCount : 0; }
+	int getWidth() const { return header ? header->width : 0; }
+	int getHeight() const { return header ? header->height : 0; }
+	Format getFormat() const;
+	size_t getFrameSize() const;  // bytes returned by getFrame()
+	const string& getPath() const { return path; }
+	
+private:
+	string path;
+	unsigned char* mapping = nullptr;
+	size_t mappingSize = 0;
+	const Header* header = nullptr;
+	const IndexEntry* index = nullptr;
+	vector<unsigned char> frameBuffer;
+};
+
+// Writes a list of image files into a .sspack on a background thread.
+// Frames are decoded, converted to RGBA, resized to the first frame's size if needed
+// and optionally block-compressed and/or LZ4-compressed.
+class SequencePackWriter : public ofThread {
+public:
+	~SequencePackWriter();
+	
+	// Returns false if a pack is already being written. With blockCompress, frames
+	// are stored as BC1, or BC3 if the first frame has any transparency.
+	bool start(const string& packPath, const vector<string>& framePaths, bool compress, bool blockCompress);
+	
+	float getProgress() const { return progress; }
+	bool getSucceeded() const { return succeeded; }
+	const string& getPackPath() const { return packPath; }
+	
+protected:
+	void threadedFunction() override;
+	
+private:
+	bool write();
+	
+	string packPath;
+	vector<string> framePaths;
+	bool compress = false;
+	bool blockCompress = false;
+	std::atomic<float> progress{0};
+	std::atomic<bool> succeeded{false};
+};
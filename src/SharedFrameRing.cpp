@@ -0,0 +1,272 @@
+#include "SharedFrameRing.h"
+#include <algorithm>
+#include <climits>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "the ring shares its atomics between processes, so they must not need a lock");
+
+namespace {
+    const size_t PAGE_BYTES = 4096;
+
+    std::string getPosixName(const std::string& name) {
+        return name.empty() || name[0] != '/' ? "/" + name : name;
+    }
+
+    size_t getDataOffset() {
+        return (sizeof(SharedFrameHeader) + PAGE_BYTES - 1) / PAGE_BYTES * PAGE_BYTES;
+    }
+
+    void wakeAll(std::atomic<uint32_t>& signal) {
+#ifdef __linux__
+        // Not FUTEX_PRIVATE_FLAG: the waiters are in other processes
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&signal), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+        (void)signal;
+#endif
+    }
+
+    // Sleeps while signal still holds value, at most timeoutMicros
+    void waitForChange(const std::atomic<uint32_t>& signal, uint32_t value, uint64_t timeoutMicros) {
+#ifdef __linux__
+        timespec timeout;
+        timeout.tv_sec = timeoutMicros / 1000000;
+        timeout.tv_nsec = (timeoutMicros % 1000000) * 1000;
+        syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&signal), FUTEX_WAIT, value, &timeout, nullptr, 0);
+#else
+        if (signal.load(std::memory_order_acquire) == value) {
+            usleep(std::min<uint64_t>(timeoutMicros, 1000));
+        }
+#endif
+    }
+}
+
+//--------------------------------------------------------------
+uint64_t SharedFrameRing::getTimeMicros(){
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+//--------------------------------------------------------------
+SharedFrameWriter::~SharedFrameWriter(){
+    close();
+}
+
+//--------------------------------------------------------------
+bool SharedFrameWriter::open(const std::string& segmentName, size_t slotSize, int numSlots){
+    close();
+    name = getPosixName(segmentName);
+    numSlots = std::max(1, std::min(numSlots, SHARED_FRAME_MAX_SLOTS));
+    slotSize = (slotSize + PAGE_BYTES - 1) / PAGE_BYTES * PAGE_BYTES;
+    size_t size = getDataOffset() + slotSize * numSlots;
+
+    // Readers still mapping an old segment keep it alive until they see it closed
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    header = new (memory) SharedFrameHeader();
+    mappedSize = size;
+    header->version = SHARED_FRAME_VERSION;
+    header->numSlots = numSlots;
+    header->dataOffset = getDataOffset();
+    header->slotSize = slotSize;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SHARED_FRAME_MAGIC;
+    return true;
+}
+
+//--------------------------------------------------------------
+void SharedFrameWriter::close(){
+    if (!header) {
+        return;
+    }
+    header->closed.store(1, std::memory_order_release);
+    header->signal.fetch_add(1, std::memory_order_release);
+    wakeAll(header->signal);
+    munmap(header, mappedSize);
+    shm_unlink(name.c_str());
+    header = nullptr;
+    mappedSize = 0;
+}
+
+//--------------------------------------------------------------
+size_t SharedFrameWriter::getSlotSize() const {
+    return header ? header->slotSize : 0;
+}
+
+//--------------------------------------------------------------
+uint8_t* SharedFrameWriter::beginFrame(){
+    if (!header) {
+        return nullptr;
+    }
+    writing = header->published.load(std::memory_order_relaxed);
+    int index = writing % header->numSlots;
+    header->slots[index].sequence.store(writing * 2 + 1, std::memory_order_relaxed);
+    // Readers that see the pixels change must also see the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+    return reinterpret_cast<uint8_t*>(header) + header->dataOffset + index * header->slotSize;
+}
+
+//--------------------------------------------------------------
+void SharedFrameWriter::endFrame(uint32_t width, uint32_t height, uint32_t stride, uint32_t format, uint64_t timestampMicros){
+    if (!header) {
+        return;
+    }
+    SharedFrameSlot& slot = header->slots[writing % header->numSlots];
+    slot.timestampMicros = timestampMicros;
+    slot.width = width;
+    slot.height = height;
+    slot.stride = stride;
+    slot.format = format;
+    slot.size = (uint64_t)stride * height;
+    slot.sequence.store(writing * 2 + 2, std::memory_order_release);
+    header->published.store(writing + 1, std::memory_order_release);
+    header->signal.fetch_add(1, std::memory_order_release);
+    wakeAll(header->signal);
+}
+
+//--------------------------------------------------------------
+uint64_t SharedFrameWriter::getNumPublished() const {
+    return header ? header->published.load(std::memory_order_relaxed) : 0;
+}
+
+//--------------------------------------------------------------
+SharedFrameReader::~SharedFrameReader(){
+    close();
+}
+
+//--------------------------------------------------------------
+bool SharedFrameReader::open(const std::string& segmentName){
+    close();
+    int fd = shm_open(getPosixName(segmentName).c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    void* memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= getDataOffset()) {
+        memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    header = static_cast<SharedFrameHeader*>(memory);
+    mappedSize = info.st_size;
+    bool valid = header->magic == SHARED_FRAME_MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->version == SHARED_FRAME_VERSION &&
+            header->numSlots >= 1 && header->numSlots <= SHARED_FRAME_MAX_SLOTS &&
+            header->dataOffset + header->slotSize * header->numSlots <= mappedSize;
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    // Start at the newest frame; a paused writer may not publish another for a while
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    nextNumber = published > 0 ? published - 1 : 0;
+    numDropped = 0;
+    return true;
+}
+
+//--------------------------------------------------------------
+void SharedFrameReader::close(){
+    if (header) {
+        munmap(header, mappedSize);
+        header = nullptr;
+        mappedSize = 0;
+    }
+}
+
+//--------------------------------------------------------------
+bool SharedFrameReader::isClosed() const {
+    return !header || header->closed.load(std::memory_order_acquire) != 0;
+}
+
+//--------------------------------------------------------------
+bool SharedFrameReader::wait(int timeoutMillis){
+    uint64_t deadline = SharedFrameRing::getTimeMicros() + (uint64_t)std::max(0, timeoutMillis) * 1000;
+    while (!isClosed()) {
+        // Read the signal first, so a frame published after the check below still wakes us
+        uint32_t signal = header->signal.load(std::memory_order_acquire);
+        if (header->published.load(std::memory_order_acquire) > nextNumber) {
+            return true;
+        }
+        uint64_t now = SharedFrameRing::getTimeMicros();
+        if (now >= deadline) {
+            return false;
+        }
+        waitForChange(header->signal, signal, deadline - now);
+    }
+    return false;
+}
+
+//--------------------------------------------------------------
+bool SharedFrameReader::acquire(SharedFrame& frame){
+    if (!header) {
+        return false;
+    }
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    if (published == 0 || published <= nextNumber) {
+        return false;
+    }
+    uint64_t number = published - 1;
+    int index = number % header->numSlots;
+    const SharedFrameSlot& slot = header->slots[index];
+
+    uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != number * 2 + 2) {
+        return false;  // Already being overwritten by a writer far ahead; try again
+    }
+    frame.width = slot.width;
+    frame.height = slot.height;
+    frame.stride = slot.stride;
+    frame.format = slot.format;
+    frame.size = std::min<uint64_t>(slot.size, header->slotSize);
+    frame.timestampMicros = slot.timestampMicros;
+    frame.number = number;
+    frame.sequence = sequence;
+    frame.slot = index;
+    frame.pixels = reinterpret_cast<const uint8_t*>(header) + header->dataOffset + index * header->slotSize;
+    if (!isIntact(frame)) {
+        return false;
+    }
+
+    numDropped += number - nextNumber;
+    nextNumber = number + 1;
+    return true;
+}
+
+//--------------------------------------------------------------
+bool SharedFrameReader::isIntact(const SharedFrame& frame) const {
+    if (!header) {
+        return false;
+    }
+    // Orders the reads of the pixels before the sequence check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header->slots[frame.slot].sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A ring of frames in POSIX shared memory, for handing the output to processes on
+// machines without Syphon. One writer (SharedMemoryOutput in the app) and any number
+// of readers map the same segment, /dev/shm/<name> on Linux.
+//
+// The segment is a SharedFrameHeader followed by numSlots slots of slotSize bytes;
+// frame n goes into slot n % numSlots. Each slot's sequence works as a seqlock: odd
+// while the writer fills the slot, even once the frame is complete. Readers use the
+// pixels in place and check the sequence again afterwards to know whether they were
+// overwritten meanwhile. The writer never waits for readers; one that falls more than
+// numSlots - 1 frames behind skips to the newest and has the rest counted as dropped.
+//
+// Every frame bumps SharedFrameHeader::signal. On Linux readers sleep on it as a
+// futex (a shared one, so it works across processes without passing descriptors
+// around); elsewhere they poll it every millisecond.
+//
+// This file and SharedFrameRing.cpp only need the standard library and POSIX, so a
+// consumer can build them as they are; shmclient/ is an example.
+
+static const uint32_t SHARED_FRAME_MAGIC = 0x52465353;  // "SSFR"
+static const uint32_t SHARED_FRAME_VERSION = 1;
+static const int SHARED_FRAME_MAX_SLOTS = 8;
+
+enum SharedFrameFormat : uint32_t {
+	SHARED_FRAME_RGBA8 = 1,  // 4 bytes per pixel, rows top to bottom
+};
+
+struct SharedFrameSlot {
+	std::atomic<uint64_t> sequence;  // 2n + 1 while frame n is written, 2n + 2 once complete, 0 before the first
+	uint64_t timestampMicros;        // SharedFrameRing::getTimeMicros() when the frame was rendered
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;                 // Bytes per row
+	uint32_t format;                 // SharedFrameFormat
+	uint64_t size;                   // Bytes of pixels
+};
+
+struct SharedFrameHeader {
+	uint32_t magic;                   // Written last, once the rest is set up
+	uint32_t version;
+	uint32_t numSlots;
+	uint32_t dataOffset;              // Of slot 0's pixels, from the start of the segment
+	uint64_t slotSize;                // Bytes reserved per slot
+	std::atomic<uint64_t> published;  // Frames published so far; the newest is published - 1
+	std::atomic<uint32_t> signal;     // Bumped with every frame; the futex readers wait on
+	std::atomic<uint32_t> closed;     // The writer went away or replaced the segment; reopen it
+	SharedFrameSlot slots[SHARED_FRAME_MAX_SLOTS];
+};
+
+namespace SharedFrameRing {
+	// CLOCK_MONOTONIC in microseconds, the clock frame timestamps are in
+	uint64_t getTimeMicros();
+}
+
+class SharedFrameWriter {
+public:
+	~SharedFrameWriter();
+
+	// Creates /dev/shm/<name>, replacing a segment left behind by an earlier writer
+	bool open(const std::string& name, size_t slotSize, int numSlots = 3);
+	void close();
+	bool isOpen() const { return header != nullptr; }
+	size_t getSlotSize() const;
+
+	// Memory for the next frame, up to getSlotSize() bytes; readers skip the slot
+	// until endFrame()
+	uint8_t* beginFrame();
+	void endFrame(uint32_t width, uint32_t height, uint32_t stride, uint32_t format, uint64_t timestampMicros);
+	uint64_t getNumPublished() const;
+
+private:
+	std::string name;
+	SharedFrameHeader* header = nullptr;
+	size_t mappedSize = 0;
+	uint64_t writing = 0;  // Number of the frame between beginFrame() and endFrame()
+};
+
+struct SharedFrame {
+	const uint8_t* pixels = nullptr;  // In shared memory; valid while isIntact() says so
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t stride = 0;
+	uint32_t format = 0;
+	uint64_t size = 0;
+	uint64_t number = 0;              // Counted from 0 when the writer opened the segment
+	uint64_t timestampMicros = 0;
+	uint64_t sequence = 0;
+	int slot = 0;
+};
+
+class SharedFrameReader {
+public:
+	~SharedFrameReader();
+
+	// Maps an existing segment; the newest frame in it is the first acquire() returns
+	bool open(const std::string& name);
+	void close();
+	bool isOpen() const { return header != nullptr; }
+	// The writer closed or replaced the segment; close() and open() again
+	bool isClosed() const;
+
+	// Waits up to timeoutMillis for a frame acquire() hasn't returned yet
+	bool wait(int timeoutMillis);
+	// The newest complete frame, if it's one acquire() hasn't returned yet
+	bool acquire(SharedFrame& frame);
+	// Whether the writer has left frame's slot alone so far; check after using the pixels
+	bool isIntact(const SharedFrame& frame) const;
+
+	// Frames published since open() that acquire() skipped over
+	uint64_t getNumDropped() const { return numDropped; }
+
+private:
+	SharedFrameHeader* header = nullptr;
+	size_t mappedSize = 0;
+	uint64_t nextNumber = 0;  // Oldest frame not acquired yet
+	uint64_t numDropped = 0;
+};
@@ -0,0 +1,55 @@
+#include "SharedMemoryOutput.h"
+
+//--------------------------------------------------------------
+SharedMemoryOutput::~SharedMemoryOutput(){
+    close();
+}
+
+//--------------------------------------------------------------
+void SharedMemoryOutput::setup(const string& segmentName){
+    close();
+    name = segmentName;
+    // Two in flight cover a readback that takes the GPU up to a frame to finish
+    readback.setup(2);
+}
+
+//--------------------------------------------------------------
+void SharedMemoryOutput::close(){
+    readback.clear();
+    writer.close();
+}
+
+//--------------------------------------------------------------
+void SharedMemoryOutput::publish(const ofFbo& fbo){
+    // All buffers in flight: the oldest has to go out first, waiting for it if need be
+    FboReadback::Frame frame;
+    if (readback.isFull() && readback.map(frame, true)) {
+        write(frame);
+        readback.unmap();
+    }
+    readback.begin(fbo, SharedFrameRing::getTimeMicros());
+}
+
+//--------------------------------------------------------------
+void SharedMemoryOutput::update(){
+    FboReadback::Frame frame;
+    while (readback.map(frame)) {
+        write(frame);
+        readback.unmap();
+    }
+}
+
+//--------------------------------------------------------------
+void SharedMemoryOutput::write(const FboReadback::Frame& frame){
+    size_t bytes = (size_t)frame.width * frame.height * 4;
+    if (writer.getSlotSize() < bytes) {
+        // Readers notice the segment closing and open the new one
+        if (!writer.open(name, bytes)) {
+            ofLogError("SharedMemoryOutput") << "Could not create shared memory " << name << ": " << strerror(errno);
+            return;
+        }
+        ofLogNotice("SharedMemoryOutput") << "Publishing " << frame.width << "x" << frame.height << " frames to " << name;
+    }
+    memcpy(writer.beginFrame(), frame.pixels, bytes);
+    writer.endFrame(frame.width, frame.height, frame.width * 4, SHARED_FRAME_RGBA8, frame.timestampMicros);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ofMain.h"
+#include "FboReadback.h"
+#include "SharedFrameRing.h"
+
+// Publishes an output FBO into a SharedFrameWriter ring, the Syphon replacement for
+// consumers on Linux. publish() only starts an FboReadback; update() copies the ones
+// that completed into shared memory, so the render thread doesn't wait for the GPU.
+// Frames reach readers about a frame later than Syphon clients, timestamped with when
+// they were published.
+// Must be used from the thread that owns the GL context.
+class SharedMemoryOutput {
+public:
+	~SharedMemoryOutput();
+
+	// name is the shared memory segment, /dev/shm/<name> on Linux
+	void setup(const string& name);
+	void close();
+
+	void publish(const ofFbo& fbo);
+	// Call every frame; writes out readbacks that have completed
+	void update();
+
+	const string& getName() const { return name; }
+	uint64_t getNumPublished() const { return writer.getNumPublished(); }
+
+private:
+	void write(const FboReadback::Frame& frame);
+
+	string name;
+	SharedFrameWriter writer;
+	FboReadback readback;
+};
@@ -0,0 +1,207 @@
+#include "TextureUploader.h"
+#include "PixelConvert.h"
+
+//--------------------------------------------------------------
+TextureUploader::~TextureUploader() {
+    clear();
+}
+
+//--------------------------------------------------------------
+void TextureUploader::setup(int numBuffers) {
+    clear();
+    slots.resize(max(numBuffers, 2));
+}
+
+//--------------------------------------------------------------
+void TextureUploader::clear() {
+    for (auto& slot : slots) {
+        deleteFence(slot);
+    }
+    slots.clear();
+    current = -1;
+    pending = -1;
+    next = 0;
+}
+
+//--------------------------------------------------------------
+void TextureUploader::upload(const ofPixels& pixels) {
+    ofPixelFormat format = pixels.getPixelFormat();
+    if (format != OF_PIXELS_GRAY && format != OF_PIXELS_RGB && format != OF_PIXELS_RGBA) {
+        upload(pixels.getData(), pixels.getWidth(), pixels.getHeight(), ofGetGLInternalFormat(pixels),
+               ofGetGLFormat(pixels), ofGetGLType(pixels), pixels.size() * pixels.getBytesPerChannel());
+        return;
+    }
+
+    // Grey, RGB and RGBA are widened to BGRA on the way into the pixel buffer. That costs
+    // little more than the copy itself and is the layout drivers take without converting.
+    int width = pixels.getWidth();
+    int height = pixels.getHeight();
+    size_t numPixels = (size_t)width * height;
+    int index = beginUpload();
+    Slot& slot = slots[index];
+    if (!matches(slot.texture, width, height, GL_RGBA8)) {
+        slot.texture.allocate(width, height, GL_RGBA8, ofGetUsingArbTex(), GL_BGRA, GL_UNSIGNED_BYTE);
+    }
+
+    unsigned char* dst = beginWrite(slot, numPixels * 4);
+    PixelConvert::toFourChannels(pixels.getData(), pixels.getNumChannels(), dst, numPixels, PixelConvert::BGRA);
+    endWrite(slot, numPixels * 4);
+    slot.texture.loadData(slot.buffer, GL_BGRA, GL_UNSIGNED_BYTE);
+    endUpload(index);
+}
+
+//--------------------------------------------------------------
+void TextureUploader::upload(const unsigned char* data, int width, int height, int glInternalFormat, int glFormat, int glType, size_t bytes) {
+    int index = beginUpload();
+    Slot& slot = slots[index];
+    if (!matches(slot.texture, width, height, glInternalFormat)) {
+        slot.texture.allocate(width, height, glInternalFormat, ofGetUsingArbTex(), glFormat, glType);
+    }
+
+    fillBuffer(slot, data, bytes);
+    // With the buffer bound to GL_PIXEL_UNPACK_BUFFER this queues a copy from GPU-visible memory
+    slot.texture.loadData(slot.buffer, glFormat, glType);
+    endUpload(index);
+}
+
+//--------------------------------------------------------------
+void TextureUploader::uploadCompressed(const unsigned char* blocks, size_t size, int width, int height, GLenum glInternalFormat) {
+    int index = beginUpload();
+    Slot& slot = slots[index];
+    if (!matches(slot.texture, width, height, glInternalFormat)) {
+        ofTextureData textureData;
+        textureData.width = width;
+        textureData.height = height;
+        textureData.textureTarget = GL_TEXTURE_2D;
+        textureData.glInternalFormat = glInternalFormat;
+        slot.texture.allocate(textureData, GL_RGBA, GL_UNSIGNED_BYTE);
+    }
+
+    // Upload the blocks as they are; the GPU decompresses them when sampling
+    fillBuffer(slot, blocks, size);
+    const ofTextureData & textureData = slot.texture.getTextureData();
+    slot.buffer.bind(GL_PIXEL_UNPACK_BUFFER);
+    glBindTexture(textureData.textureTarget, textureData.textureID);
+    glCompressedTexSubImage2D(textureData.textureTarget, 0, 0, 0, width, height, glInternalFormat, size, nullptr);
+    glBindTexture(textureData.textureTarget, 0);
+    slot.buffer.unbind(GL_PIXEL_UNPACK_BUFFER);
+    endUpload(index);
+}
+
+//--------------------------------------------------------------
+int TextureUploader::beginUpload() {
+    if (slots.empty()) {
+        setup();
+    }
+
+    // A newer frame replaces one that hasn't landed yet, only the latest is worth showing
+    if (pending >= 0) {
+        deleteFence(slots[pending]);
+        return pending;
+    }
+
+    // Never write into the texture that is on screen
+    int index = next;
+    if (index == current) {
+        index = (index + 1) % slots.size();
+    }
+    next = (index + 1) % slots.size();
+    return index;
+}
+
+//--------------------------------------------------------------
+void TextureUploader::fillBuffer(Slot& slot, const void* data, size_t bytes) {
+    memcpy(beginWrite(slot, bytes), data, bytes);
+    endWrite(slot, bytes);
+}
+
+//--------------------------------------------------------------
+unsigned char* TextureUploader::beginWrite(Slot& slot, size_t bytes) {
+    // Reallocating orphans the old storage, so the driver hands out fresh memory instead of
+    // waiting for the GPU to finish reading the previous frame from this buffer
+    slot.buffer.allocate(bytes, GL_STREAM_DRAW);
+    void* mapped = slot.buffer.mapRange(0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        return (unsigned char*)mapped;
+    }
+    staging.resize(bytes);
+    return staging.data();
+}
+
+//--------------------------------------------------------------
+void TextureUploader::endWrite(Slot& slot, size_t bytes) {
+    if (staging.empty()) {
+        slot.buffer.unmap();
+    } else {
+        slot.buffer.setData(bytes, staging.data(), GL_STREAM_DRAW);
+        staging.clear();
+    }
+}
+
+//--------------------------------------------------------------
+void TextureUploader::endUpload(int index) {
+    Slot& slot = slots[index];
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Submit now so the fence can signal while the rest of the frame is being built
+    glFlush();
+    pending = index;
+
+    // Nothing on screen yet, don't show a blank frame while waiting
+    if (current < 0) {
+        finish();
+    }
+}
+
+//--------------------------------------------------------------
+bool TextureUploader::update() {
+    if (pending < 0) {
+        return false;
+    }
+
+    GLenum result = glClientWaitSync(slots[pending].fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+
+    deleteFence(slots[pending]);
+    current = pending;
+    pending = -1;
+    return true;
+}
+
+//--------------------------------------------------------------
+void TextureUploader::finish() {
+    if (pending < 0) {
+        return;
+    }
+
+    GLenum result;
+    do {
+        result = glClientWaitSync(slots[pending].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    } while (result == GL_TIMEOUT_EXPIRED);
+
+    deleteFence(slots[pending]);
+    current = pending;
+    pending = -1;
+}
+
+//--------------------------------------------------------------
+const ofTexture& TextureUploader::getTexture() const {
+    return current >= 0 ? slots[current].texture : empty;
+}
+
+//--------------------------------------------------------------
+void TextureUploader::deleteFence(Slot& slot) {
+    if (slot.fence) {
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+}
+
+//--------------------------------------------------------------
+bool TextureUploader::matches(const ofTexture& texture, int width, int height, int glInternalFormat) {
+    return texture.isAllocated() &&
+           texture.getWidth() == width &&
+           texture.getHeight() == height &&
+           texture.getTextureData().glInternalFormat == glInternalFormat;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Streams decoded frames to the GPU without stalling the render thread.
+// Each upload is copied into an orphaned pixel buffer object from a small ring
+// and handed to glTexSubImage2D, which returns as soon as the copy is queued.
+// A fence marks when the texture behind it is complete; update() swaps it in,
+// so the previous frame keeps drawing (and feeding Syphon) while the DMA runs.
+// 8-bit grey, RGB and RGBA frames are converted to BGRA while they are copied in.
+// Only GL 3.2 core calls are used, so it also runs on Mesa llvmpipe.
+// Must be used from the thread that owns the GL context.
+class TextureUploader {
+public:
+	~TextureUploader();
+
+	// numBuffers slots, at least 2: one shown while the others are uploading
+	void setup(int numBuffers = 2);
+
+	void upload(const ofPixels& pixels);
+	void upload(const unsigned char* data, int width, int height, int glInternalFormat, int glFormat, int glType, size_t bytes);
+	// Compressed blocks (BC1/BC3) go into a GL_TEXTURE_2D, rectangle textures can't hold them
+	void uploadCompressed(const unsigned char* blocks, size_t size, int width, int height, GLenum glInternalFormat);
+
+	// Polls the pending fence without blocking. Returns true when a newer texture became current.
+	bool update();
+	// Blocks until the pending upload is complete and makes it current
+	void finish();
+	void clear();
+
+	const ofTexture& getTexture() const;
+	bool isPending() const { return pending >= 0; }
+	int getNumBuffers() const { return (int)slots.size(); }
+
+private:
+	struct Slot {
+		ofBufferObject buffer;
+		ofTexture texture;
+		GLsync fence = nullptr;
+	};
+
+	int beginUpload();
+	void fillBuffer(Slot& slot, const void* data, size_t bytes);
+	// Memory to write the next upload into: the mapped buffer, or staging if mapping failed
+	unsigned char* beginWrite(Slot& slot, size_t bytes);
+	void endWrite(Slot& slot, size_t bytes);
+	void endUpload(int index);
+	static void deleteFence(Slot& slot);
+	static bool matches(const ofTexture& texture, int width, int height, int glInternalFormat);
+
+	vector<Slot> slots;
+	int current = -1;  // slot being drawn
+	int pending = -1;  // slot whose upload hasn't signalled yet
+	int next = 0;
+	ofTexture empty;
+	vector<unsigned char> staging;
+};
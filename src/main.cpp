@@ -1,8 +1,22 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "SequenceExporter.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char* argv[]){
+    // Offline export runs without a window: SequenceStreamer --export <folder> [options]
+    vector<string> arguments(argv + 1, argv + argc);
+    if (SequenceExporter::isRequested(arguments)) {
+        ofInit();
+        SequenceExporter exporter;
+        if (!exporter.parseArguments(arguments)) {
+            SequenceExporter::printUsage();
+            return 1;
+        }
+        ofSetLogLevel(OF_LOG_ERROR);
+        return exporter.run() ? 0 : 1;
+    }
+
     //Use ofGLFWWindowSettings for more options like multi-monitor fullscreen
     ofGLFWWindowSettings settings;
     settings.setSize(1612, 768);
@@ -11,6 +25,10 @@ int main( ){
 
     auto window = ofCreateWindow(settings);
 
-    ofRunApp(window, make_shared<ofApp>());
+    // SequenceStreamer --pipe <fifo or |command> [--pipe-fps N] [--pipe-block] starts the raw video pipe
+    auto app = make_shared<ofApp>();
+    PipeOutput::Settings pipeSettings;
+    app->setPipeSettings(pipeSettings, PipeOutput::parseArguments(arguments, pipeSettings));
+    ofRunApp(window, app);
     ofRunMainLoop();
 } 
@@ -5,6 +5,7 @@
 const float ofApp::SLIDER_MIDPOINT = 0.5f;
 const float ofApp::BASE_FPS = 30.0f;
 const float ofApp::MAX_SPEED = 4.0f;
+const string ofApp::MAIN_OUTPUT = "Main";
 
 //--------------------------------------------------------------
 void ofApp::setup(){
@@ -22,12 +23,10 @@ void ofApp::setup(){
     // Initialize variables
     currentImageIndex = 0;
     playbackSpeed = 1.0;
-    lastImageTime = 0;
     isPlaying = false;
     showBlackScreen = false;
     rangeStart = 0;
     rangeEnd = 0;
-    lastCheckTime = 0;
     checkInterval = 2.0;
     playDirection = FORWARD;
     loopMode = LOOP;
@@ -39,9 +38,18 @@ void ofApp::setup(){
     syphonHeight = 1080;
     maintainAspectRatio = true;
     
-    // Setup Syphon and FBO
-    syphonFbo.allocate(syphonWidth, syphonHeight, GL_RGBA);
-    syphonServer.setName("Frame Player Output");
+    // Setup the outputs; each gets its Syphon server when first published
+    outputGraph.setup();
+    allocateSyphonOutput();
+    
+    // Start decoding frames in the background, on threads the layers share
+    decodePool.setup();
+    prefetcher.setup(PREFETCH_RING_SIZE, frameCache, decodePool);
+    uploader.setup(UPLOAD_BUFFER_COUNT);
+    proxyCache.setup();
+    scrubLoader.setup(frameCache, proxyCache);
+    scrubLoader.setScrubWidth(scrubbingQuality);
+    liveTail.setup(frameCache);
     
     // Setup UI layout with fixed width
     uiPanel = ofRectangle(0, 0, UI_PANEL_WIDTH, ofGetHeight());
@@ -139,6 +147,14 @@ void ofApp::setup(){
     last100FramesGui.addListener(this, &ofApp::onLast100FramesEvent);
     lastFramesGroupGui.add(&last100FramesGui);
     
+    // For a folder a camera is writing into: pick up each frame as soon as it is complete
+    liveTailToggleGui.setup("Live Tail", false);
+    liveTailToggleGui.addListener(this, &ofApp::onLiveTailEvent);
+    lastFramesGroupGui.add(&liveTailToggleGui);
+    
+    liveLatencyLabelGui.setup("Capture to Out", "-");
+    lastFramesGroupGui.add(&liveLatencyLabelGui);
+    
     gui.add(&lastFramesGroupGui);
     
     // Custom input for last frames (ofxGui doesn't have text input, using slider instead)
@@ -150,11 +166,36 @@ void ofApp::setup(){
     currentFrameLabelGui.setup("Frame", "0/0");
     gui.add(&currentFrameLabelGui);
     
+    // What playback has to give up to keep up, and the switch that forbids it
+    qualityLabelGui.setup("Quality", QualityGovernor::getLevelName(QualityGovernor::FULL));
+    gui.add(&qualityLabelGui);
+    
+    neverDegradeToggleGui.setup("Never Degrade", false);
+    neverDegradeToggleGui.addListener(this, &ofApp::onNeverDegradeEvent);
+    gui.add(&neverDegradeToggleGui);
+    
     // Black screen toggle
     blackScreenToggleGui.setup("Black Screen", false);
     blackScreenToggleGui.addListener(this, &ofApp::onBlackScreenToggleEvent);
     gui.add(&blackScreenToggleGui);
     
+    // Add color controls
+    colorGroupGui.setup("Color");
+    brightnessSliderGui.setup("Brightness", 0, -1, 1);
+    colorGroupGui.add(&brightnessSliderGui);
+    
+    contrastSliderGui.setup("Contrast", 1, 0, 2);
+    colorGroupGui.add(&contrastSliderGui);
+    
+    saturationSliderGui.setup("Saturation", 1, 0, 2);
+    colorGroupGui.add(&saturationSliderGui);
+    
+    resetColorButtonGui.setup("Reset Color");
+    resetColorButtonGui.addListener(this, &ofApp::onResetColorEvent);
+    colorGroupGui.add(&resetColorButtonGui);
+    
+    gui.add(&colorGroupGui);
+    
     // Add scrubbing quality control
     scrubbingGroupGui.setup("Scrubbing Performance");
     scrubbingQualitySliderGui.setup("Quality", scrubbingQuality, 64, 640);
@@ -165,10 +206,111 @@ void ofApp::setup(){
     ultraLowQualityToggleGui.addListener(this, &ofApp::onUltraLowQualityEvent);
     scrubbingGroupGui.add(&ultraLowQualityToggleGui);
     
+    proxyProgressLabelGui.setup("Proxies", "0%");
+    scrubbingGroupGui.add(&proxyProgressLabelGui);
+    
+    proxyBudgetSliderGui.setup("Proxy Disk (MB)", 4096, 256, 65536);
+    proxyBudgetSliderGui.addListener(this, &ofApp::onProxyBudgetEvent);
+    scrubbingGroupGui.add(&proxyBudgetSliderGui);
+    proxyCache.setDiskBudget((uint64_t)proxyBudgetSliderGui * 1024 * 1024);
+    
+    scrubStatsLabelGui.setup("Scrub Ready", "");
+    scrubbingGroupGui.add(&scrubStatsLabelGui);
+    
     gui.add(&scrubbingGroupGui);
     
+    // Add frame cache controls
+    cacheGroupGui.setup("Frame Cache");
+    cacheBudgetSliderGui.setup("RAM Budget (MB)", 2048, 256, 32768);
+    cacheBudgetSliderGui.addListener(this, &ofApp::onCacheBudgetEvent);
+    cacheGroupGui.add(&cacheBudgetSliderGui);
+    
+    cacheStatsLabelGui.setup("Hits/Misses", "0/0");
+    cacheGroupGui.add(&cacheStatsLabelGui);
+    
+    decodeStatsLabelGui.setup("Decode", "");
+    cacheGroupGui.add(&decodeStatsLabelGui);
+    
+    gui.add(&cacheGroupGui);
+    frameCache.setBudget((uint64_t)cacheBudgetSliderGui * 1024 * 1024);
+    
+    // Add pack controls
+    packGroupGui.setup("Sequence Pack");
+    packRangeButtonGui.setup("Pack Range");
+    packRangeButtonGui.addListener(this, &ofApp::onPackRangeEvent);
+    packGroupGui.add(&packRangeButtonGui);
+    
+    packCompressToggleGui.setup("LZ4 Compress", false);
+    packGroupGui.add(&packCompressToggleGui);
+    
+    packBlockCompressToggleGui.setup("GPU Compressed (BC1/BC3)", false);
+    packGroupGui.add(&packBlockCompressToggleGui);
+    
+    packStatusLabelGui.setup("Status", "Idle");
+    packGroupGui.add(&packStatusLabelGui);
+    
+    gui.add(&packGroupGui);
+    
+    // Add layer controls; they act on the layer picked with the Layer slider
+    layersGroupGui.setup("Layers");
+    addLayerButtonGui.setup("Add Layer");
+    addLayerButtonGui.addListener(this, &ofApp::onAddLayerEvent);
+    layersGroupGui.add(&addLayerButtonGui);
+    
+    layerSelectSliderGui.setup("Layer", 1, 1, 1);
+    layerSelectSliderGui.addListener(this, &ofApp::onLayerSelectEvent);
+    layersGroupGui.add(&layerSelectSliderGui);
+    
+    layerPlayToggleGui.setup("Layer Playing", true);
+    layerPlayToggleGui.addListener(this, &ofApp::onLayerPlayEvent);
+    layersGroupGui.add(&layerPlayToggleGui);
+    
+    layerSpeedSliderGui.setup("Layer Speed", convertSpeedToSlider(1.0f), 0.0f, MAX_SPEED);
+    layerSpeedSliderGui.addListener(this, &ofApp::onLayerSpeedEvent);
+    layersGroupGui.add(&layerSpeedSliderGui);
+    
+    layerBackwardToggleGui.setup("Layer Backward", false);
+    layerBackwardToggleGui.addListener(this, &ofApp::onLayerBackwardEvent);
+    layersGroupGui.add(&layerBackwardToggleGui);
+    
+    layerPingPongToggleGui.setup("Layer Ping Pong", false);
+    layerPingPongToggleGui.addListener(this, &ofApp::onLayerPingPongEvent);
+    layersGroupGui.add(&layerPingPongToggleGui);
+    
+    layerStartSliderGui.setup("Layer Start", 0, 0, 0);
+    layerStartSliderGui.addListener(this, &ofApp::onLayerRangeEvent);
+    layersGroupGui.add(&layerStartSliderGui);
+    
+    layerEndSliderGui.setup("Layer End", 0, 0, 0);
+    layerEndSliderGui.addListener(this, &ofApp::onLayerRangeEvent);
+    layersGroupGui.add(&layerEndSliderGui);
+    
+    removeLayerButtonGui.setup("Remove Layer");
+    removeLayerButtonGui.addListener(this, &ofApp::onRemoveLayerEvent);
+    layersGroupGui.add(&removeLayerButtonGui);
+    
+    layerStatusLabelGui.setup("Layers", "None");
+    layersGroupGui.add(&layerStatusLabelGui);
+    
+    gui.add(&layersGroupGui);
+    
+    // Add diagnostics controls
+    diagnosticsGroupGui.setup("Diagnostics");
+    statsOverlayToggleGui.setup("Show Stats", false);
+    diagnosticsGroupGui.add(&statsOverlayToggleGui);
+    
+    exportStatsButtonGui.setup("Export Trace");
+    exportStatsButtonGui.addListener(this, &ofApp::onExportStatsEvent);
+    diagnosticsGroupGui.add(&exportStatsButtonGui);
+    
+    resetStatsButtonGui.setup("Reset Stats");
+    resetStatsButtonGui.addListener(this, &ofApp::onResetStatsEvent);
+    diagnosticsGroupGui.add(&resetStatsButtonGui);
+    
+    gui.add(&diagnosticsGroupGui);
+    
     // Add Syphon controls
-    syphonGroupGui.setup("Syphon Settings");
+    syphonGroupGui.setup("Output Settings");
     
     // ofxGui doesn't have text input, using sliders instead
     syphonWidthSliderGui.setup("Width", 1920, 320, 3840);
@@ -207,6 +349,41 @@ void ofApp::setup(){
     applySyphonSizeButtonGui.addListener(this, &ofApp::onApplySyphonSizeEvent);
     syphonGroupGui.add(&applySyphonSizeButtonGui);
     
+    // Extra outputs scaled from the same frame, published as their own Syphon servers
+    extra1080pToggleGui.setup("Extra 1080p Output", false);
+    extra1080pToggleGui.addListener(this, &ofApp::onExtraOutputEvent);
+    syphonGroupGui.add(&extra1080pToggleGui);
+    
+    extra720pToggleGui.setup("Extra 720p Output", false);
+    extra720pToggleGui.addListener(this, &ofApp::onExtraOutputEvent);
+    syphonGroupGui.add(&extra720pToggleGui);
+    
+    // Every output as a POSIX shared memory ring as well; the only output where Syphon isn't available
+#ifdef TARGET_OSX
+    sharedMemoryToggleGui.setup("Shared Memory Output", false);
+#else
+    sharedMemoryToggleGui.setup("Shared Memory Output", true);
+#endif
+    sharedMemoryToggleGui.addListener(this, &ofApp::onSharedMemoryEvent);
+    syphonGroupGui.add(&sharedMemoryToggleGui);
+    
+    // The main output as raw RGBA video into a FIFO, for ffmpeg and other encoders
+    pipeToggleGui.setup("Pipe Output", false);
+    pipeToggleGui.addListener(this, &ofApp::onPipeEvent);
+    syphonGroupGui.add(&pipeToggleGui);
+    
+    pipeBlockToggleGui.setup("Pipe Never Drops", pipeSettings.policy == PipeOutput::BLOCK);
+    pipeBlockToggleGui.addListener(this, &ofApp::onPipeBlockEvent);
+    syphonGroupGui.add(&pipeBlockToggleGui);
+    
+    pipeStatusLabelGui.setup("Pipe", "off");
+    syphonGroupGui.add(&pipeStatusLabelGui);
+    
+    // Started from the command line; setting the toggle opens it
+    if (pipeRequested) {
+        pipeToggleGui = true;
+    }
+    
     
     gui.add(&syphonGroupGui);
     
@@ -229,56 +406,139 @@ void ofApp::setup(){
 void ofApp::update(){    
     // Check for directory changes
     checkDirectoryForChanges();
-
-    if (isPlaying && !showBlackScreen && !imagePaths.empty() && speedSliderGui > 0.0f) {
-        float frameTime = 1.0f / (BASE_FPS * convertSliderToSpeed(speedSliderGui));
-        float currentTime = ofGetElapsedTimef();
+    
+    // Measure whether decoding keeps up with folder playback, and trade quality for it if not
+    if (isPlaying && !showBlackScreen && !pack.isOpen() && getNumFrames() > 0 && speedSliderGui > 0.0f) {
+        if (governor.update(ofGetElapsedTimef(), prefetcher.getNumThreads(), playbackClock.getRefreshPeriod())) {
+            applyQuality();
+        }
+    } else {
+        governor.pause();
+    }
+    qualityLabelGui = string(QualityGovernor::getLevelName(governor.getLevel())) +
+                      (governor.getLoad() > 0 ? " " + ofToString((int)(governor.getLoad() * 100)) + "%" : "");
+    // Proxies are only for scrubbing; they wait while playback is short of decode time
+    proxyCache.setPaused(isPlaying && governor.isBehind());
+
+    if (isPlaying && !showBlackScreen && getNumFrames() > 0 && speedSliderGui > 0.0f) {
+        // The clock says how many frames are due this refresh; frames in between are
+        // skipped without ever being decoded. While the governor skips frames, only
+        // whole steps of them are shown, so frames drop evenly instead of whenever
+        // decoding runs late.
+        int owedFrames = playbackClock.update(ofGetElapsedTimef(), BASE_FPS * convertSliderToSpeed(speedSliderGui));
+        int frameStep = getPlaybackCursor().frameStep;
+        int shownFrames = owedFrames - owedFrames % frameStep;
         
-        if (currentTime - lastImageTime >= frameTime) {
-            // Update frame index based on playback direction
-            if (playDirection == FORWARD) {
-                currentImageIndex++;
-                
-                // Handle reaching the end based on loop mode
-                if (currentImageIndex > rangeEnd) {
-                    if (loopMode == LOOP) {
-                        currentImageIndex = rangeStart;
-                    } else if (loopMode == PING_PONG) {
-                        currentImageIndex = rangeEnd - 1;
-                        if (currentImageIndex < rangeStart) currentImageIndex = rangeStart;
-                        playDirection = BACKWARD;
-                        directionForwardGui = false;
-                        directionBackwardGui = true;
-                    }
-                }
-            } else { // BACKWARD
-                currentImageIndex--;
-                
-                // Handle reaching the start based on loop mode
-                if (currentImageIndex < rangeStart) {
-                    if (loopMode == LOOP) {
-                        currentImageIndex = rangeEnd;
-                    } else if (loopMode == PING_PONG) {
-                        currentImageIndex = rangeStart + 1;
-                        if (currentImageIndex > rangeEnd) currentImageIndex = rangeEnd;
-                        playDirection = FORWARD;
-                        directionForwardGui = true;
-                        directionBackwardGui = false;
+        if (shownFrames > 0) {
+            // Work out the next frame; the prefetcher walks the same wrap rules
+            PlaybackCursor next = getPlaybackCursor();
+            next.step(shownFrames);
+            
+            // Only swap in a frame that is ready without waiting on the disk: packs are
+            // memory-mapped, folders come from the prefetcher. If the prefetcher hasn't
+            // got the frame yet, hold the current one and try again next update; the
+            // frames stay owed, so playback catches up instead of falling behind.
+            bool frameReady = false;
+            if (pack.isOpen()) {
+                frameReady = loadFrame(next.index);
+            } else {
+                // The newest frames of a live folder are in the tail before the prefetcher gets to them.
+                // A frame that can't be decoded is stepped over rather than waited for forever.
+                shared_ptr<const ofPixels> frame;
+                bool ready = prefetcher.takeFrame(next.index, frame) || (liveTailToggleGui && liveTail.getFrame(next.index, frame));
+                if (ready || prefetcher.isFailed(next.index)) {
+                    if (frame) {
+                        presentFrame(*frame);
+                        showingReduced = governor.getLevel() != QualityGovernor::FULL;
                     }
+                    frameReady = true;
                 }
             }
             
-            if (currentImageIndex >= 0 && currentImageIndex < imagePaths.size()) {
-                // Load the image with normal quality during playback
-                currentImage.load(imagePaths[currentImageIndex]);
+            if (frameReady) {
+                // Skipping more than the speed asks for means we fell behind and caught up
+                int plannedFrames = std::max(frameStep, (int)ceil(getPlaybackCursor().stride / frameStep) * frameStep);
+                if (shownFrames > plannedFrames) {
+                    FrameStats::get().countDropped(shownFrames - plannedFrames);
+                }
+                playbackClock.consume(shownFrames);
+                currentImageIndex = next.index;
+                if (next.direction != playDirection) {
+                    playDirection = next.direction;
+                    directionForwardGui = (playDirection == FORWARD);
+                    directionBackwardGui = (playDirection == BACKWARD);
+                }
                 updateFrameInfo();
+            } else {
+                FrameStats::get().countLate();
             }
-            lastImageTime = currentTime;
         }
+    } else {
+        playbackClock.reset(ofGetElapsedTimef());
+    }
+    
+    // Paused on a frame played at reduced quality: bring in the full one
+    if (!isPlaying && showingReduced) {
+        showingReduced = false;
+        if (!pack.isOpen() && currentImageIndex < getNumFrames()) {
+            scrubLoader.settle(currentImageIndex);
+        }
+    }
+    
+    // Paused on the newest frame of a live folder: the one that just arrived goes out
+    // as soon as the tail has decoded it
+    shared_ptr<const ofPixels> liveFrame;
+    if (liveTailPending && liveTail.getFrame(currentImageIndex, liveFrame)) {
+        presentFrame(*liveFrame);
+        showingProxy = false;
+        liveTailPending = false;
+    }
+    
+    // Show what the scrub loader has for the slider. While playing, only during the
+    // drag; playback moves on from where it let go, and the request is dropped so a
+    // later pause doesn't bring the frame back.
+    ScrubLoader::Frame scrubFrame;
+    if (isPlaying && ofGetElapsedTimef() >= scrubEndTime) {
+        scrubLoader.cancel();
+    } else if (scrubLoader.take(scrubFrame)) {
+        presentFrame(*scrubFrame.pixels);
+        showingProxy = !scrubFrame.full;
+    }
+    
+    // Keep the prefetcher decoding ahead of wherever the playhead is now
+    if (pack.isOpen()) {
+        // Packs need no decoding; just have the kernel page in the next frames
+        PlaybackCursor ahead = getPlaybackCursor();
+        for (int i = 0; i < PREFETCH_RING_SIZE; i++) {
+            ahead.stepShown();
+            pack.prefetch(ahead.index);
+        }
+    } else {
+        prefetcher.setPlayhead(getPlaybackCursor());
+    }
+    if (liveTailToggleGui) {
+        // Pin as much of the last frames range as is worth holding outside the cache
+        liveTail.setNumFrames(ofClamp(rangeEnd - rangeStart + 1, 4, 32));
+        float latency = liveTail.getLastLatency();
+        liveLatencyLabelGui = latency > 0 ? ofToString(latency, 1) + " ms (p50 " +
+                              ofToString(FrameStats::get().getSummary(FrameStats::TAIL_OUTPUT).p50Millis, 1) + ")" : "-";
+    }
+    
+    // Layers keep their own clocks; their prefetchers queue on the same decode pool
+    for (shared_ptr<SequenceLayer>& layer : layers) {
+        layer->update(ofGetElapsedTimef(), BASE_FPS);
+    }
+    updateCacheInfo();
+    
+    if (packWriter.isThreadRunning()) {
+        packStatusLabelGui = ofToString((int)(packWriter.getProgress() * 100)) + "%";
+    } else if (packWriting) {
+        packWriting = false;
+        packStatusLabelGui = packWriter.getSucceeded() ? "Done" : "Failed";
     }
 
     // Update scrubber position when playing
-    if (isPlaying && !showBlackScreen && !imagePaths.empty()) {
+    if (isPlaying && !showBlackScreen && getNumFrames() > 0) {
         // Update scrubber to reflect current position in the range
         float scrubberPos = 0;
         if (rangeEnd > rangeStart) {
@@ -288,6 +548,94 @@ void ofApp::update(){
     }
 }
 
+PlaybackCursor ofApp::getPlaybackCursor() {
+    PlaybackCursor cursor;
+    cursor.index = currentImageIndex;
+    cursor.direction = playDirection;
+    cursor.loopMode = loopMode;
+    cursor.rangeStart = rangeStart;
+    cursor.rangeEnd = rangeEnd;
+    cursor.stride = playbackClock.getFramesPerRefresh(BASE_FPS * convertSliderToSpeed(speedSliderGui));
+    cursor.phase = playbackClock.getOwedFrames();
+    // Packs need no decoding, so the governor leaves them alone
+    cursor.frameStep = pack.isOpen() ? 1 : governor.getFrameStep();
+    return cursor;
+}
+
+int ofApp::getNumFrames() {
+    return pack.isOpen() ? pack.getNumFrames() : (frameList ? frameList->size() : 0);
+}
+
+bool ofApp::loadFrame(int index) {
+    if (index < 0 || index >= getNumFrames()) {
+        return false;
+    }
+    if (pack.isOpen()) {
+        const unsigned char * data;
+        {
+            // Page-ins from the mapping (and LZ4 decompression) happen here
+            FrameStats::Scope timer(FrameStats::FILE_READ);
+            data = pack.getFrame(index);
+        }
+        if (!data) {
+            return false;
+        }
+        switch (pack.getFormat()) {
+            case SequencePack::FORMAT_BC1:
+                presentCompressedFrame(data, pack.getFrameSize(), pack.getWidth(), pack.getHeight(), GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+                break;
+            case SequencePack::FORMAT_BC3:
+                presentCompressedFrame(data, pack.getFrameSize(), pack.getWidth(), pack.getHeight(), GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+                break;
+            default:
+                presentFrame(data, pack.getWidth(), pack.getHeight());
+                break;
+        }
+        showingProxy = false;
+        return true;
+    }
+    // Every image load goes through the cache, so revisited frames cost no disk I/O
+    string path = frameList->getPath(index);
+    shared_ptr<const ofPixels> frame = frameCache.load(path);
+    if (!frame) {
+        ofLogWarning("ofApp") << "Could not load image: " << path;
+        return false;
+    }
+    presentFrame(*frame);
+    showingProxy = false;
+    return true;
+}
+
+void ofApp::presentFrame(const ofPixels & pixels) {
+    FrameStats::Scope timer(FrameStats::UPLOAD);
+    // Queued through a pixel buffer; frameTexture switches over once the upload's fence signals
+    uploader.upload(pixels);
+    swapUploadedTexture();
+}
+
+void ofApp::presentFrame(const unsigned char * rgba, int width, int height) {
+    FrameStats::Scope timer(FrameStats::UPLOAD);
+    // Copied straight from the caller's memory (the pack mapping) into the pixel buffer
+    uploader.upload(rgba, width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, (size_t)width * height * 4);
+    swapUploadedTexture();
+}
+
+void ofApp::presentCompressedFrame(const unsigned char * blocks, size_t size, int width, int height, GLenum internalFormat) {
+    FrameStats::Scope timer(FrameStats::UPLOAD);
+    uploader.uploadCompressed(blocks, size, width, height, internalFormat);
+    swapUploadedTexture();
+}
+
+void ofApp::swapUploadedTexture() {
+    // Keep drawing the previous frame until the new texture is complete on the GPU
+    if (uploader.update() || !frameTexture.isAllocated()) {
+        frameTexture = uploader.getTexture();
+        if (frameTexture.isAllocated()) {
+            outputGraph.setSource(frameTexture);
+        }
+    }
+}
+
 float ofApp::convertSliderToSpeed(float sliderValue) {
     if(sliderValue <= 0) return 0;
     
@@ -320,6 +668,7 @@ float ofApp::convertSpeedToSlider(float speed) {
 //--------------------------------------------------------------
 void ofApp::draw(){
     ofBackground(0);
+    swapUploadedTexture();
     
     // Draw UI Panel background
     ofPushStyle();
@@ -327,49 +676,55 @@ void ofApp::draw(){
     ofDrawRectangle(uiPanel);
     ofPopStyle();
     
-    // First render to FBO for Syphon output
-    syphonFbo.begin();
-    ofClear(0, 0, 0, 255);
-    
-    if (!showBlackScreen && currentImage.isAllocated()) {
-        if (maintainAspectRatio) {
-            // Calculate scaling to maintain aspect ratio
-            float scale = min(syphonWidth / (float)currentImage.getWidth(),
-                            syphonHeight / (float)currentImage.getHeight());
-            
-            float newWidth = currentImage.getWidth() * scale;
-            float newHeight = currentImage.getHeight() * scale;
-            
-            // Center the image in the FBO
-            float x = (syphonWidth - newWidth) / 2;
-            float y = (syphonHeight - newHeight) / 2;
-            
-            currentImage.draw(x, y, newWidth, newHeight);
-        } else {
-            // Stretch to fill entire FBO
-            currentImage.draw(0, 0, syphonWidth, syphonHeight);
+    // Redraw the outputs only when the frame or a setting changed; Syphon clients and
+    // shared memory readers keep showing the last frame published
+    ColorAdjust::Settings color;
+    color.brightness = brightnessSliderGui;
+    color.contrast = contrastSliderGui;
+    color.saturation = saturationSliderGui;
+    outputGraph.setColor(color);
+    outputGraph.setBlack(showBlackScreen);
+    outputGraph.setPreviewArea(previewPanel);
+    
+    uint64_t renderStart = ofGetElapsedTimeMicros();
+    if (outputGraph.update()) {
+        FrameStats::get().record(FrameStats::RENDER, renderStart, ofGetElapsedTimeMicros() - renderStart);
+        publishOutputs(outputGraph);
+        if (liveTailToggleGui && !liveTailPending) {
+            liveTail.recordShown(currentImageIndex);
         }
     }
-    // We don't need to draw anything else when showBlackScreen is true
-    // as we already cleared the FBO to black
-    
-    syphonFbo.end();
-    
-    // Send FBO to Syphon (always, even for black screen)
-    syphonServer.publishTexture(&syphonFbo.getTexture());
+    for (size_t i = 0; i < layers.size(); i++) {
+        if (layers[i]->render(showBlackScreen, getLayerPreviewArea(i))) {
+            publishOutputs(layers[i]->getOutputGraph());
+        }
+    }
+    for (auto& entry : sharedMemoryOutputs) {
+        entry.second->update();
+    }
+    pipeOutput.update();
+    
+    // Draw preview in window, from the output chain so it matches what is published
+    outputGraph.drawPreview(previewPanel);
+    
+    // Layers along the bottom of the preview, the selected one outlined
+    for (size_t i = 0; i < layers.size(); i++) {
+        ofRectangle area = getLayerPreviewArea(i);
+        ofPushStyle();
+        ofSetColor(0);
+        ofDrawRectangle(area);
+        ofSetColor(255);
+        layers[i]->drawPreview(area);
+        ofNoFill();
+        ofSetColor(i + 1 == (size_t)layerSelectSliderGui ? ofColor(255, 200, 0) : ofColor(120));
+        ofDrawRectangle(area);
+        ofSetColor(255);
+        ofDrawBitmapStringHighlight(layers[i]->getName(), area.x + 4, area.y + 14);
+        ofPopStyle();
+    }
     
-    // Draw preview in window
-    if (!showBlackScreen && currentImage.isAllocated()) {
-        float scale = min(previewPanel.width / (float)currentImage.getWidth(),
-                         previewPanel.height / (float)currentImage.getHeight());
-        
-        float newWidth = currentImage.getWidth() * scale;
-        float newHeight = currentImage.getHeight() * scale;
-        
-        float x = previewPanel.x + (previewPanel.width - newWidth) / 2;
-        float y = previewPanel.y + (previewPanel.height - newHeight) / 2;
-        
-        currentImage.draw(x, y, newWidth, newHeight);
+    if (statsOverlayToggleGui) {
+        drawStatsOverlay();
     }
     
     // Draw GUI
@@ -400,6 +755,19 @@ void ofApp::draw(){
 //--------------------------------------------------------------
 void ofApp::exit(){
     // Remove the syphonServer.close() call since it's not needed
+    watcher.close();
+    prefetcher.close();
+    scrubLoader.close();
+    liveTail.close();
+    layers.clear();
+    decodePool.close();
+    proxyCache.close();
+    // A half-written pack stays a .tmp file and is removed
+    packWriter.waitForThread(true);
+    uploader.clear();
+    // Unlinks the shared memory segments, readers see them closed
+    sharedMemoryOutputs.clear();
+    pipeOutput.close();
 }
 
 //--------------------------------------------------------------
@@ -509,6 +877,12 @@ void ofApp::mouseScrolled(int x, int y, float scrollX, float scrollY){
 //--------------------------------------------------------------
 void ofApp::dragEvent(ofDragInfo dragInfo){ 
     if(dragInfo.files.size() > 0) {
+        // A dropped .sspack plays straight from the pack
+        if(ofToLower(ofFilePath::getFileExt(dragInfo.files[0])) == "sspack") {
+            openPack(dragInfo.files[0]);
+            return;
+        }
+        
         // Check if it's a directory
         ofDirectory dir(dragInfo.files[0]);
         if(dir.isDirectory()) {
@@ -525,63 +899,42 @@ void ofApp::folderSelected(ofFileDialogResult result) {
     loadImagesFromDirectory(directoryPath);
 }
 
-// Helper function to set up directory with image filters
-ofDirectory ofApp::getImageDirectory(const string& path) {
-    ofDirectory dir(path);
-    dir.allowExt("jpg");
-    dir.allowExt("jpeg");
-    dir.allowExt("png");
-    dir.allowExt("tif");
-    dir.allowExt("tiff");
-    dir.listDir();
-    dir.sort(); // Sort files by name
-    return dir;
+void ofApp::loadImagesFromDirectory(string path) {
+    pack.close();
+    
+    // The watcher scans the folder in the background; update() picks up the
+    // list in applyFrameList() as soon as it is published
+    frameList.reset();
+    prefetcher.setFrameList(frameList);
+    scrubLoader.setFrameList(frameList);
+    liveTail.setFrameList(frameList);
+    liveTailPending = false;
+    watcher.watch(path, checkInterval);
 }
 
-void ofApp::loadImagesFromDirectory(string path) {
-    imagePaths.clear();
-    
-    ofDirectory dir = getImageDirectory(path);
+void ofApp::applyFrameList(shared_ptr<const FrameList> newFrameList) {
+    // The current frame is reloaded only if the file at its index changed, so a camera
+    // appending frames doesn't cost a decode on this thread per frame. The frame cache
+    // notices if the file was rewritten and decodes it again.
+    string shownName = frameList && currentImageIndex < (int)frameList->size() ? frameList->getName(currentImageIndex) : "";
+    uint64_t shownReplacedCount = frameList ? frameList->getReplacedCount() : 0;
+    // In live tail mode a player paused on the newest frame moves on to each new one
+    bool followTail = liveTailToggleGui && !isPlaying && frameList && currentImageIndex == (int)frameList->size() - 1;
+    frameList = newFrameList;
     ofLogNotice("ofApp") << "rangeSetByUser " << rangeSetByUser;
     
-    // Store all image paths
-    for(int i = 0; i < dir.size(); i++) {
-        string filePath = dir.getPath(i);
-        imagePaths.push_back(filePath);
-        // ofLogVerbose("ofApp") << "Added image: " << filePath;  // Only log in verbose mode
-    }
-    
-    if (!imagePaths.empty()) {
+    if (!frameList->empty()) {
         // see if the range was already set by folder
         if (!rangeSetByUser || (rangeStart == 0 && rangeEnd == previousDirSize - 1)) {  
             // Set the maximum range for the sliders (1-based for display)
             ofLogNotice("ofApp") << "Range never set before";
-
-            lastFrame = imagePaths.size();
-            
-            // Update slider ranges and values
-            startFrameSliderGui.setMax(lastFrame);
-            endFrameSliderGui.setMax(lastFrame);
-            
-            startFrameSliderGui = 1;
-            endFrameSliderGui = lastFrame;
-            
-            // Update internal range variables (0-based for program)
-            rangeStart = 0;
-            rangeEnd = lastFrame - 1;
-            
-            // Set current frame within the range
-            currentImageIndex = ofClamp(currentImageIndex, rangeStart, rangeEnd);
-            ofLogNotice("ofApp") << "currentImageIndex: " << currentImageIndex;
-
-            currentImage.load(imagePaths[currentImageIndex]);
-            updateFrameInfo();
+            resetImageRange(false);
         } else {
-            int imageIndexOffset = imagePaths.size() - previousDirSize;
+            int imageIndexOffset = frameList->size() - previousDirSize;
             ofLogNotice("ofApp") << "imageIndexOffset: " << imageIndexOffset;
             ofLogNotice("ofApp") << "Range set by user";
             
-            lastFrame = imagePaths.size();
+            lastFrame = frameList->size();
             
             // int rangeFromEnd = (rangeEnd - rangeStart) + 1;
 
@@ -592,8 +945,8 @@ void ofApp::loadImagesFromDirectory(string path) {
             endFrameSliderGui.setMax(lastFrame);
 
             // Make sure we're within bounds (using 0-based indices)
-            rangeStart = ofClamp(rangeStart + imageIndexOffset, 0, imagePaths.size() - 1);
-            rangeEnd = ofClamp(rangeEnd + imageIndexOffset, rangeStart, imagePaths.size() - 1);
+            rangeStart = ofClamp(rangeStart + imageIndexOffset, 0, frameList->size() - 1);
+            rangeEnd = ofClamp(rangeEnd + imageIndexOffset, rangeStart, frameList->size() - 1);
 
             // Update current index if it's out of range
             if (currentImageIndex < rangeStart || currentImageIndex > rangeEnd) {
@@ -604,13 +957,72 @@ void ofApp::loadImagesFromDirectory(string path) {
             startFrameSliderGui = rangeStart + 1; // Convert to 1-based for display
             endFrameSliderGui = rangeEnd + 1;     // Convert to 1-based for display
 
-            currentImage.load(imagePaths[currentImageIndex]);
             updateFrameInfo();
         }
+        
+        if (followTail && currentImageIndex < rangeEnd) {
+            // update() shows it once the live tail has decoded it
+            currentImageIndex = rangeEnd;
+            liveTailPending = true;
+            updateFrameInfo();
+        } else if (frameList->getName(currentImageIndex) != shownName || frameList->getReplacedCount() != shownReplacedCount) {
+            loadFrame(currentImageIndex);
+        }
     } else {
-        ofLogWarning("ofApp") << "No images found in directory: " << path;
+        ofLogWarning("ofApp") << "No images found in directory: " << frameList->getDirectory();
+    }
+    previousDirSize = frameList->size();
+    prefetcher.setFrameList(frameList);
+    scrubLoader.setFrameList(frameList);
+    proxyCache.setFrameList(frameList->getDirectory(), frameList);
+    if (liveTailToggleGui) {
+        liveTail.setFrameList(frameList);
     }
-    previousDirSize = imagePaths.size();
+}
+
+void ofApp::resetImageRange(bool reloadFrame) {
+    lastFrame = getNumFrames();
+    
+    // Update slider ranges and values
+    startFrameSliderGui.setMax(lastFrame);
+    endFrameSliderGui.setMax(lastFrame);
+    
+    startFrameSliderGui = 1;
+    endFrameSliderGui = lastFrame;
+    
+    // Update internal range variables (0-based for program)
+    rangeStart = 0;
+    rangeEnd = lastFrame - 1;
+    
+    // Set current frame within the range
+    currentImageIndex = ofClamp(currentImageIndex, rangeStart, rangeEnd);
+    ofLogNotice("ofApp") << "currentImageIndex: " << currentImageIndex;
+
+    if (reloadFrame) {
+        loadFrame(currentImageIndex);
+    }
+    updateFrameInfo();
+}
+
+void ofApp::openPack(const string& path) {
+    if (!pack.open(path)) {
+        return;
+    }
+    
+    // A pack replaces the folder: stop watching it and drop its decoded frames
+    watcher.close();
+    proxyCache.setFrameList(directoryPath, nullptr);
+    directoryPath = "";
+    displayPath = path;
+    frameList.reset();
+    prefetcher.setFrameList(frameList);
+    scrubLoader.setFrameList(frameList);
+    liveTail.setFrameList(frameList);
+    liveTailPending = false;
+    rangeSetByUser = false;
+    previousDirSize = 0;
+    
+    resetImageRange();
 }
 
 void ofApp::updateImageRange() {
@@ -619,21 +1031,55 @@ void ofApp::updateImageRange() {
     rangeEnd = endFrameSliderGui - 1;
     
     // Make sure we're within bounds (using 0-based indices)
-    rangeStart = ofClamp(rangeStart, 0, imagePaths.size() - 1);
-    rangeEnd = ofClamp(rangeEnd, rangeStart, imagePaths.size() - 1);
+    rangeStart = ofClamp(rangeStart, 0, getNumFrames() - 1);
+    rangeEnd = ofClamp(rangeEnd, rangeStart, getNumFrames() - 1);
     
     // Update current index if it's out of range
     if (currentImageIndex < rangeStart || currentImageIndex > rangeEnd) {
         currentImageIndex = rangeStart;
-        if (!imagePaths.empty()) {
-            currentImage.load(imagePaths[currentImageIndex]);
+        if (getNumFrames() > 0) {
+            loadFrame(currentImageIndex);
         }
     }
 }
 
+void ofApp::updateCacheInfo() {
+    string info = ofToString(frameCache.getHits()) + "/" + ofToString(frameCache.getMisses()) +
+                  " " + ofToString(frameCache.getBytesUsed() / (1024 * 1024)) + "MB";
+    cacheStatsLabelGui = info;
+    // The pool's throughput across the main sequence and every layer
+    float throughput = prefetcher.getThroughput();
+    for (shared_ptr<SequenceLayer>& layer : layers) {
+        throughput += layer->getPrefetcher().getThroughput();
+    }
+    decodeStatsLabelGui = ofToString(throughput, 1) + " fps, " + ofToString(decodePool.getNumThreads()) + " threads";
+    proxyProgressLabelGui = ofToString((int)(proxyCache.getProgress() * 100)) + "%";
+    scrubStatsLabelGui = ofToString((int)(scrubLoader.getHitRate() * 100)) + "%, " + ofToString((int)scrubLoader.getVelocity()) + " f/s";
+    if (!pipeOutput.isOpen()) {
+        pipeStatusLabelGui = "off";
+    } else if (!pipeOutput.isConnected()) {
+        pipeStatusLabelGui = "waiting for reader";
+    } else {
+        pipeStatusLabelGui = ofToString(pipeOutput.getNumWritten()) + " sent, " + ofToString(pipeOutput.getNumDropped()) + " dropped";
+    }
+    
+    shared_ptr<SequenceLayer> layer = getSelectedLayer();
+    if (!layer) {
+        layerStatusLabelGui = "None";
+        return;
+    }
+    // The range sliders follow the layer's folder as it fills up
+    if (layerEndSliderGui.getMax() != std::max(0, layer->getNumFrames() - 1)) {
+        syncLayerControls();
+    }
+    layerStatusLabelGui = ofToString(layer->getCurrentFrame() + 1) + "/" + ofToString(layer->getNumFrames()) +
+                          ", " + ofToString(layer->getPrefetcher().getThroughput(), 1) + " fps, " +
+                          ofToString(layer->getNumLate()) + " late";
+}
+
 void ofApp::updateFrameInfo() {
     // Display frame numbers as 1-based
-    string info = ofToString(currentImageIndex + 1) + "/" + ofToString(imagePaths.size());
+    string info = ofToString(currentImageIndex + 1) + "/" + ofToString(getNumFrames());
     currentFrameLabelGui = info;
 }
 
@@ -646,7 +1092,6 @@ void ofApp::onPlayButtonEvent(){
 void ofApp::onSpeedSliderEvent(float & value){
     float actualSpeed = convertSliderToSpeed(value);
     playbackSpeed = (actualSpeed > 0.0f) ? (1.0f / (BASE_FPS * actualSpeed)) : 0.0f;
-    lastImageTime = ofGetElapsedTimef();
 }
 
 void ofApp::onSpeed02xEvent(){
@@ -706,30 +1151,14 @@ void ofApp::onPingPongModeEvent(bool & value){
 }
 
 void ofApp::onScrubberEvent(float & value){
-    // Debounce rapid scrubbing events
-    float currentTime = ofGetElapsedTimef();
-    static float lastScrubTime = 0;
-    static float scrubDebounceTime = 0.1; // Increased to 100ms for better performance
-    
-    // Skip processing if events are coming too quickly
-    if(currentTime - lastScrubTime < scrubDebounceTime && !imagePaths.empty()) {
-        return;
-    }
-    
-    lastScrubTime = currentTime;
-    
     // Calculate frame index based on scrubber value
     int frameIndex = rangeStart + round(value * (rangeEnd - rangeStart));
     frameIndex = ofClamp(frameIndex, rangeStart, rangeEnd);
     
-    if(frameIndex != currentImageIndex) {
+    if(frameIndex != currentImageIndex && getNumFrames() > 0) {
         currentImageIndex = frameIndex;
         updateFrameInfo(); // Update frame info immediately for responsive UI
         
-        // Remember playback state
-        bool wasPlaying = isPlaying;
-        isPlaying = false;
-        
         if (ultraLowQualityScrubbing) {
             // Ultra-low quality mode - just use a colored placeholder
             // This is extremely fast but doesn't show image content
@@ -742,22 +1171,21 @@ void ofApp::onScrubberEvent(float & value){
             color.setHsb(hue, 200, 200);
             pixels.setColor(color);
             
-            currentImage.clear();
-            currentImage.allocate(64, 64, OF_IMAGE_COLOR);
-            currentImage.setFromPixels(pixels);
-            currentImage.update();
+            presentFrame(pixels);
+            showingProxy = true;
+        } else if (pack.isOpen()) {
+            // Packs are fast enough to scrub at full resolution
+            loadFrame(currentImageIndex);
         } else {
-            // Very simple approach - just load the image directly
-            // This is actually faster in many cases than trying to optimize too much
-            currentImage.load(imagePaths[currentImageIndex]);
+            // Every event counts; update() shows the frame as soon as it, or the nearest
+            // one to it, is loaded. Build this frame's proxy next as well.
+            proxyCache.request(currentImageIndex);
+            scrubLoader.request(currentImageIndex, rangeStart, rangeEnd);
         }
         
         // Schedule a higher quality reload when scrubbing stops
-        scrubEndTime = currentTime + 0.3; // 300ms after last scrub
+        scrubEndTime = ofGetElapsedTimef() + 0.3; // 300ms after last scrub
         ofAddListener(ofEvents().update, this, &ofApp::checkScrubEnd);
-        
-        // Restore playback state
-        isPlaying = wasPlaying;
     }
 }
 
@@ -766,11 +1194,15 @@ void ofApp::checkScrubEnd(ofEventArgs &args) {
     float currentTime = ofGetElapsedTimef();
     
     if(currentTime > scrubEndTime) {
-        // We're already loading full quality during scrubbing in the normal mode,
-        // so we only need to reload if we were in ultra-low quality mode
-        if(ultraLowQualityScrubbing && currentImageIndex >= 0 && currentImageIndex < imagePaths.size()) {
+        // Replace the placeholder or proxy shown while scrubbing with the full frame.
+        // Playback shows full frames by itself.
+        if((ultraLowQualityScrubbing || showingProxy) && !isPlaying && currentImageIndex >= 0 && currentImageIndex < getNumFrames()) {
             ofLogVerbose("ofApp") << "Scrubbing ended, loading full quality image";
-            currentImage.load(imagePaths[currentImageIndex]);
+            if (pack.isOpen()) {
+                loadFrame(currentImageIndex);
+            } else {
+                scrubLoader.settle(currentImageIndex);
+            }
         }
         ofRemoveListener(ofEvents().update, this, &ofApp::checkScrubEnd);
     }
@@ -800,10 +1232,55 @@ void ofApp::onSyphonHeightEvent(int & value){
 
 void ofApp::onAspectRatioEvent(bool & value){
     maintainAspectRatio = value;
+    // Takes effect straight away, at the size last applied
+    OutputGraph::Output* output = outputGraph.getOutput(MAIN_OUTPUT);
+    if (output) {
+        outputGraph.setOutput(MAIN_OUTPUT, output->width, output->height, maintainAspectRatio);
+        for (shared_ptr<SequenceLayer>& layer : layers) {
+            layer->setOutputSize(output->width, output->height, maintainAspectRatio);
+        }
+    }
+}
+
+void ofApp::onExtraOutputEvent(bool & value){
+    updateExtraOutputs();
+}
+
+void ofApp::onPipeEvent(bool & value){
+    if (!value) {
+        pipeOutput.close();
+        return;
+    }
+    pipeSettings.policy = pipeBlockToggleGui ? PipeOutput::BLOCK : PipeOutput::DROP;
+    if (!pipeOutput.setup(pipeSettings)) {
+        pipeToggleGui = false;
+        return;
+    }
+    // The stream starts with the current picture rather than the next change
+    outputGraph.invalidate();
+}
+
+void ofApp::onPipeBlockEvent(bool & value){
+    pipeSettings.policy = value ? PipeOutput::BLOCK : PipeOutput::DROP;
+    pipeOutput.setPolicy(pipeSettings.policy);
+}
+
+void ofApp::setPipeSettings(const PipeOutput::Settings & settings, bool start){
+    pipeSettings = settings;
+    pipeRequested = start;
+}
+
+void ofApp::onSharedMemoryEvent(bool & value){
+    // New rings start with the current picture rather than waiting for the next frame
+    sharedMemoryOutputs.clear();
+    outputGraph.invalidate();
+    for (shared_ptr<SequenceLayer>& layer : layers) {
+        layer->getOutputGraph().invalidate();
+    }
 }
 
 void ofApp::onApplySyphonSizeEvent(){
-    syphonFbo.allocate(syphonWidth, syphonHeight, GL_RGBA);
+    allocateSyphonOutput();
 }
 
 void ofApp::onLast5FramesEvent(){
@@ -825,9 +1302,27 @@ void ofApp::onCustomLastFramesEvent(int & value){
     setLastXFrames(value);
 }
 
+void ofApp::onNeverDegradeEvent(bool & value){
+    governor.setNeverDegrade(value);
+    applyQuality();
+    ofLogNotice("ofApp") << "Never degrade: " << (value ? "ON" : "OFF");
+}
+
+void ofApp::onLiveTailEvent(bool & value){
+    // Without it the tail's pinned frames are let go and the watcher settles bursts again
+    watcher.setLiveTail(value);
+    liveTail.setFrameList(value ? frameList : nullptr);
+    if (!value && liveTailPending) {
+        liveTailPending = false;
+        loadFrame(currentImageIndex);
+    }
+    liveLatencyLabelGui = "-";
+    ofLogNotice("ofApp") << "Live tail: " << (value ? "ON" : "OFF");
+}
+
 void ofApp::setLastXFrames(int numFrames){
-    if (!imagePaths.empty()) {
-        int totalFrames = imagePaths.size();
+    if (getNumFrames() > 0) {
+        int totalFrames = getNumFrames();
 
         rangeSetByUser = true;
         
@@ -845,8 +1340,8 @@ void ofApp::setLastXFrames(int numFrames){
         
         // Set current frame to start of range
         currentImageIndex = rangeStart;
-        if (currentImageIndex < imagePaths.size()) {
-            currentImage.load(imagePaths[currentImageIndex]);
+        if (currentImageIndex < getNumFrames()) {
+            loadFrame(currentImageIndex);
             updateFrameInfo();
         }
     }
@@ -868,56 +1363,192 @@ void ofApp::onOpenFolderEvent(){
 void ofApp::onSyphon1080pEvent() {
     syphonWidthSliderGui = 1920;
     syphonHeightSliderGui = 1080;
-    syphonFbo.allocate(syphonWidth, syphonHeight, GL_RGBA);
+    allocateSyphonOutput();
 }
 
 void ofApp::onSyphon720pEvent() {
     syphonWidthSliderGui = 1280;
     syphonHeightSliderGui = 720;
-    syphonFbo.allocate(syphonWidth, syphonHeight, GL_RGBA);
+    allocateSyphonOutput();
 }
 
 void ofApp::onSyphonImageResEvent() {
-    if (!imagePaths.empty() && currentImage.isAllocated()) {
-        syphonWidthSliderGui = currentImage.getWidth();
-        syphonHeightSliderGui = currentImage.getHeight();
-        syphonFbo.allocate(syphonWidth, syphonHeight, GL_RGBA);
+    int width, height;
+    if (getSourceSize(width, height)) {
+        syphonWidthSliderGui = width;
+        syphonHeightSliderGui = height;
+        allocateSyphonOutput();
     }
 }
 
 void ofApp::onSyphonHalfResEvent() {
-    if (!imagePaths.empty() && currentImage.isAllocated()) {
-        syphonWidthSliderGui = currentImage.getWidth() / 2;
-        syphonHeightSliderGui = currentImage.getHeight() / 2;
-        syphonFbo.allocate(syphonWidth, syphonHeight, GL_RGBA);
+    int width, height;
+    if (getSourceSize(width, height)) {
+        syphonWidthSliderGui = width / 2;
+        syphonHeightSliderGui = height / 2;
+        allocateSyphonOutput();
+    }
+}
+
+void ofApp::allocateSyphonOutput() {
+    outputGraph.setOutput(MAIN_OUTPUT, syphonWidth, syphonHeight, maintainAspectRatio);
+    // Layer outputs are the same size as the main one
+    for (shared_ptr<SequenceLayer>& layer : layers) {
+        layer->setOutputSize(syphonWidth, syphonHeight, maintainAspectRatio);
+    }
+    updateExtraOutputs();
+}
+
+void ofApp::updateExtraOutputs() {
+    if (extra1080pToggleGui) {
+        outputGraph.setOutput("1080p", 1920, 1080, true);
+    } else {
+        outputGraph.removeOutput("1080p");
+    }
+    if (extra720pToggleGui) {
+        outputGraph.setOutput("720p", 1280, 720, true);
+    } else {
+        outputGraph.removeOutput("720p");
+    }
+    removeUnusedPublishers();
+    
+    // Frames only need decoding as large as the largest output; a 4K source feeding
+    // a 720p output comes out of the JPEG decoder at 1/2 size and is resampled the rest
+    // of the way, letterboxed if the outputs keep the aspect ratio. Layer outputs are
+    // never larger than the main one, so the cache's decode size covers them too.
+    int width, height;
+    outputGraph.getLargestOutputSize(width, height);
+    frameCache.setDecodeSize(width, height, outputGraph.keepsAspectRatio());
+    applyQuality();
+}
+
+void ofApp::applyQuality() {
+    // Reduced levels decode against a fraction of the largest output
+    int width, height;
+    outputGraph.getLargestOutputSize(width, height);
+    switch (governor.getLevel()) {
+        case QualityGovernor::FULL:
+            prefetcher.setDecodeSize(0, 0);
+            break;
+        case QualityGovernor::HALF:
+            prefetcher.setDecodeSize(width / 2, height / 2);
+            break;
+        default:
+            prefetcher.setDecodeSize(width / 4, height / 4, &proxyCache);
+            break;
+    }
+}
+
+void ofApp::removeUnusedPublishers() {
+    // Servers and rings of removed outputs and layers go away with them
+#ifdef TARGET_OSX
+    for (auto it = syphonServers.begin(); it != syphonServers.end();) {
+        if (!hasOutput(it->first)) {
+            it = syphonServers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#endif
+    for (auto it = sharedMemoryOutputs.begin(); it != sharedMemoryOutputs.end();) {
+        if (!hasOutput(it->first)) {
+            it = sharedMemoryOutputs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool ofApp::hasOutput(const string& name) {
+    if (outputGraph.getOutput(name)) {
+        return true;
+    }
+    for (shared_ptr<SequenceLayer>& layer : layers) {
+        if (layer->getOutputGraph().getOutput(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ofApp::publishOutputs(OutputGraph& graph) {
+    FrameStats::Scope timer(FrameStats::PUBLISH);
+    for (auto& entry : graph.getOutputs()) {
+        OutputGraph::Output& output = entry.second;
+        if (!output.updated) {
+            continue;
+        }
+#ifdef TARGET_OSX
+        shared_ptr<ofxSyphonServer>& server = syphonServers[output.name];
+        if (!server) {
+            server = make_shared<ofxSyphonServer>();
+            server->setName(output.name == MAIN_OUTPUT ? "Frame Player Output" : "Frame Player Output " + output.name);
+        }
+        server->publishTexture(&output.fbo.getTexture());
+#endif
+        if (sharedMemoryToggleGui) {
+            // /dev/shm/sequencestreamer-main, -1080p, -720p, -layer-1
+            shared_ptr<SharedMemoryOutput>& ring = sharedMemoryOutputs[output.name];
+            if (!ring) {
+                ring = make_shared<SharedMemoryOutput>();
+                string segment = ofToLower(output.name);
+                ofStringReplace(segment, " ", "-");
+                ring->setup("sequencestreamer-" + segment);
+            }
+            ring->publish(output.fbo);
+        }
+        if (output.name == MAIN_OUTPUT && pipeOutput.isOpen()) {
+            pipeOutput.publish(output.fbo);
+        }
     }
 }
 
-// New function to handle directory watching
+bool ofApp::getSourceSize(int & width, int & height) {
+    // The texture may hold a reduced decode, so ask the file itself
+    if (getNumFrames() == 0) {
+        return false;
+    }
+    if (pack.isOpen()) {
+        width = pack.getWidth();
+        height = pack.getHeight();
+        return true;
+    }
+    uint32_t fileWidth, fileHeight;
+    int index = ofClamp(currentImageIndex, 0, getNumFrames() - 1);
+    if (FolderScanner::readImageSize(frameList->getPath(index), fileWidth, fileHeight)) {
+        width = fileWidth;
+        height = fileHeight;
+        return true;
+    }
+    if (frameTexture.isAllocated()) {
+        width = frameTexture.getWidth();
+        height = frameTexture.getHeight();
+        return true;
+    }
+    return false;
+}
+
+// Pick up the watcher's latest snapshot of the folder
 void ofApp::checkDirectoryForChanges() {
-    float currentTime = ofGetElapsedTimef();
-    
-    // Only check at the specified interval and if we have a directory path
-    if (directoryPath.empty() || currentTime - lastCheckTime < checkInterval) {
+    if (directoryPath.empty()) {
         return;
     }
     
-    // Quick check for file count changes
-    ofDirectory dir = getImageDirectory(directoryPath);
-    int currentFileCount = dir.size();
-    
-    // Only log and reload if the count changed
-    if (currentFileCount != previousDirSize) {
-        ofLogNotice("ofApp") << "Directory changed: " << currentFileCount << " files (was " << imagePaths.size() << ")";
-        loadImagesFromDirectory(directoryPath);
+    // A pointer compare; the folder itself is only touched on the watcher thread
+    shared_ptr<const FrameList> latest = watcher.getFrameList();
+    if (!latest || latest == frameList) {
+        return;
     }
-    
-    lastCheckTime = currentTime;
+    if (frameList) {
+        ofLogNotice("ofApp") << "Directory changed: " << latest->size() << " files (was " << frameList->size() << ")";
+    }
+    applyFrameList(latest);
 }
 
 // Add the scrubbing quality event handler
 void ofApp::onScrubbingQualityEvent(int & value) {
     scrubbingQuality = value;
+    scrubLoader.setScrubWidth(scrubbingQuality);
     ofLogNotice("ofApp") << "Scrubbing quality set to: " << scrubbingQuality << " pixels width";
 }
 
@@ -938,3 +1569,181 @@ void ofApp::onUltraLowQualityEvent(bool & value) {
         scrubbingQualitySliderGui = 320;
     }
 }
+
+// Add the frame cache budget event handler
+void ofApp::onCacheBudgetEvent(int & value) {
+    frameCache.setBudget((uint64_t)value * 1024 * 1024);
+    ofLogNotice("ofApp") << "Frame cache budget set to: " << value << " MB";
+}
+
+void ofApp::onProxyBudgetEvent(int & value) {
+    proxyCache.setDiskBudget((uint64_t)value * 1024 * 1024);
+    ofLogNotice("ofApp") << "Proxy disk budget set to: " << value << " MB";
+}
+
+// Timing overlay in the top left of the preview
+void ofApp::drawStatsOverlay() {
+    FrameStats& stats = FrameStats::get();
+    std::stringstream text;
+    text << std::fixed << std::setprecision(2);
+    text << "stage        p50     p99     max  (ms)\n";
+    for (int i = 0; i < FrameStats::NUM_STAGES; i++) {
+        FrameStats::Summary summary = stats.getSummary((FrameStats::Stage)i);
+        text << std::left << std::setw(8) << FrameStats::getStageName((FrameStats::Stage)i) << std::right
+             << std::setw(8) << summary.p50Millis << std::setw(8) << summary.p99Millis << std::setw(8) << summary.maxMillis << "\n";
+    }
+    text << "late " << stats.getLate() << "  dropped " << stats.getDropped()
+         << "  refresh " << std::setprecision(1) << playbackClock.getRefreshPeriod() * 1000 << " ms";
+    ofDrawBitmapStringHighlight(text.str(), previewPanel.x + 10, previewPanel.y + 20);
+}
+
+// Add the stats export event handler
+void ofApp::onExportStatsEvent() {
+    string base = ofToDataPath("traces/trace-" + ofGetTimestampString("%Y%m%d-%H%M%S"), true);
+    ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(base, false), false, true);
+    if (FrameStats::get().exportTrace(base + ".json") && FrameStats::get().exportCsv(base + ".csv")) {
+        ofLogNotice("ofApp") << "Stats exported to " << base << ".json/.csv";
+    }
+}
+
+// Add the stats reset event handler
+void ofApp::onResetStatsEvent() {
+    FrameStats::get().reset();
+}
+
+// Add the color reset event handler
+void ofApp::onResetColorEvent() {
+    brightnessSliderGui = 0;
+    contrastSliderGui = 1;
+    saturationSliderGui = 1;
+}
+
+// Add the pack range event handler
+void ofApp::onPackRangeEvent() {
+    if (!frameList || frameList->empty() || directoryPath.empty()) {
+        ofLogWarning("ofApp") << "Open a folder before packing";
+        return;
+    }
+    
+    // Write the pack next to the folder, named after the range it holds
+    string packPath = ofFilePath::removeTrailingSlash(directoryPath) + "_" +
+                      ofToString(rangeStart + 1) + "-" + ofToString(rangeEnd + 1) + ".sspack";
+    vector<string> rangePaths;
+    for (int i = rangeStart; i <= rangeEnd; i++) {
+        rangePaths.push_back(frameList->getPath(i));
+    }
+    
+    if (packWriter.start(packPath, rangePaths, packCompressToggleGui, packBlockCompressToggleGui)) {
+        ofLogNotice("ofApp") << "Packing " << rangePaths.size() << " frames into " << packPath;
+        packStatusLabelGui = "0%";
+        packWriting = true;
+    }
+}
+
+// Layer handlers
+void ofApp::addLayer(const string& directory) {
+    shared_ptr<SequenceLayer> layer = make_shared<SequenceLayer>();
+    layer->setup("Layer " + ofToString(nextLayerNumber++), frameCache, decodePool, PREFETCH_RING_SIZE, UPLOAD_BUFFER_COUNT);
+    layer->setOutputSize(syphonWidth, syphonHeight, maintainAspectRatio);
+    layer->setPlaying(true);
+    layer->load(directory, checkInterval);
+    layers.push_back(layer);
+    
+    layerSelectSliderGui.setMax(layers.size());
+    layerSelectSliderGui = layers.size();
+    syncLayerControls();
+}
+
+shared_ptr<SequenceLayer> ofApp::getSelectedLayer() {
+    int index = layerSelectSliderGui - 1;
+    if (index < 0 || index >= (int)layers.size()) {
+        return nullptr;
+    }
+    return layers[index];
+}
+
+void ofApp::syncLayerControls() {
+    shared_ptr<SequenceLayer> layer = getSelectedLayer();
+    if (!layer) {
+        return;
+    }
+    // Setting the controls fires their listeners; they have nothing to change meanwhile
+    syncingLayerControls = true;
+    layerPlayToggleGui = layer->isPlaying();
+    layerSpeedSliderGui = convertSpeedToSlider(layer->getSpeed());
+    layerBackwardToggleGui = layer->getDirection() == BACKWARD;
+    layerPingPongToggleGui = layer->getLoopMode() == PING_PONG;
+    int last = std::max(0, layer->getNumFrames() - 1);
+    layerStartSliderGui.setMax(last);
+    layerEndSliderGui.setMax(last);
+    layerStartSliderGui = layer->getRangeStart();
+    layerEndSliderGui = layer->getRangeEnd();
+    syncingLayerControls = false;
+}
+
+ofRectangle ofApp::getLayerPreviewArea(int layer) {
+    // A row of 16:9 thumbnails along the bottom of the preview
+    float width = std::min(240.0f, (previewPanel.width - 10) / 4 - 10);
+    float height = width * 9 / 16;
+    return ofRectangle(previewPanel.x + 10 + layer * (width + 10), previewPanel.getBottom() - height - 10, width, height);
+}
+
+void ofApp::onAddLayerEvent() {
+    ofFileDialogResult result = ofSystemLoadDialog("Select folder for the new layer", true);
+    if (result.bSuccess) {
+        addLayer(result.getPath());
+    }
+}
+
+void ofApp::onRemoveLayerEvent() {
+    int index = layerSelectSliderGui - 1;
+    if (index < 0 || index >= (int)layers.size()) {
+        return;
+    }
+    ofLogNotice("ofApp") << "Removing " << layers[index]->getName();
+    layers.erase(layers.begin() + index);
+    removeUnusedPublishers();
+    
+    layerSelectSliderGui.setMax(std::max<size_t>(1, layers.size()));
+    layerSelectSliderGui = ofClamp(layerSelectSliderGui, 1, std::max<size_t>(1, layers.size()));
+    syncLayerControls();
+}
+
+void ofApp::onLayerSelectEvent(int & value) {
+    syncLayerControls();
+}
+
+void ofApp::onLayerPlayEvent(bool & value) {
+    shared_ptr<SequenceLayer> layer = getSelectedLayer();
+    if (layer && !syncingLayerControls) {
+        layer->setPlaying(value);
+    }
+}
+
+void ofApp::onLayerSpeedEvent(float & value) {
+    shared_ptr<SequenceLayer> layer = getSelectedLayer();
+    if (layer && !syncingLayerControls) {
+        layer->setSpeed(convertSliderToSpeed(value));
+    }
+}
+
+void ofApp::onLayerBackwardEvent(bool & value) {
+    shared_ptr<SequenceLayer> layer = getSelectedLayer();
+    if (layer && !syncingLayerControls) {
+        layer->setDirection(value ? BACKWARD : FORWARD);
+    }
+}
+
+void ofApp::onLayerPingPongEvent(bool & value) {
+    shared_ptr<SequenceLayer> layer = getSelectedLayer();
+    if (layer && !syncingLayerControls) {
+        layer->setLoopMode(value ? PING_PONG : LOOP);
+    }
+}
+
+void ofApp::onLayerRangeEvent(int & value) {
+    shared_ptr<SequenceLayer> layer = getSelectedLayer();
+    if (layer && !syncingLayerControls) {
+        layer->setRange(layerStartSliderGui, layerEndSliderGui);
+    }
+}
@@ -2,7 +2,26 @@
 
 #include "ofMain.h"
 #include "ofxGui.h"
+#ifdef TARGET_OSX
 #include "ofxSyphon.h"
+#endif
+#include "PlaybackCursor.h"
+#include "PlaybackClock.h"
+#include "FramePrefetcher.h"
+#include "FrameCache.h"
+#include "ProxyCache.h"
+#include "ScrubLoader.h"
+#include "SequencePack.h"
+#include "DirectoryWatcher.h"
+#include "LiveTail.h"
+#include "QualityGovernor.h"
+#include "FrameStats.h"
+#include "TextureUploader.h"
+#include "OutputGraph.h"
+#include "SharedMemoryOutput.h"
+#include "PipeOutput.h"
+#include "DecodePool.h"
+#include "SequenceLayer.h"
 
 class ofApp : public ofBaseApp {
 public:
@@ -24,14 +43,40 @@ public:
 	void gotMessage(ofMessage msg);
 	void mouseScrolled(int x, int y, float scrollX, float scrollY);
 	
+	// Raw video pipe from the command line (--pipe); call before setup() to start it with the app
+	void setPipeSettings(const PipeOutput::Settings & settings, bool start);
+	
 	// Helper methods
 	void folderSelected(ofFileDialogResult result);
 	void loadImagesFromDirectory(string path);
+	void applyFrameList(shared_ptr<const FrameList> newFrameList);
+	void openPack(const string& path);
+	void resetImageRange(bool reloadFrame = true);
 	void updateImageRange();
 	void updateFrameInfo();
 	void setLastXFrames(int numFrames);
 	float convertSliderToSpeed(float sliderValue);
 	float convertSpeedToSlider(float speed);
+	PlaybackCursor getPlaybackCursor();
+	int getNumFrames();
+	bool loadFrame(int index);
+	void presentFrame(const ofPixels & pixels);
+	void presentFrame(const unsigned char * rgba, int width, int height);
+	void presentCompressedFrame(const unsigned char * blocks, size_t size, int width, int height, GLenum internalFormat);
+	void swapUploadedTexture();
+	void updateCacheInfo();
+	void allocateSyphonOutput();
+	bool getSourceSize(int & width, int & height);
+	void drawStatsOverlay();
+	void applyQuality();
+	void updateExtraOutputs();
+	void removeUnusedPublishers();
+	bool hasOutput(const string& name);
+	void publishOutputs(OutputGraph& graph);
+	void addLayer(const string& directory);
+	shared_ptr<SequenceLayer> getSelectedLayer();
+	void syncLayerControls();
+	ofRectangle getLayerPreviewArea(int layer);
 	
 	// Event handlers for ofxGui
 	void onPlayButtonEvent();
@@ -56,31 +101,42 @@ public:
 	void onLast10FramesEvent();
 	void onLast100FramesEvent();
 	void onCustomLastFramesEvent(int & value);
+	void onLiveTailEvent(bool & value);
+	void onNeverDegradeEvent(bool & value);
 	void onOpenFolderEvent();
 	void onSyphon1080pEvent();
 	void onSyphon720pEvent();
 	void onSyphonImageResEvent();
 	void onSyphonHalfResEvent();
+	void onExtraOutputEvent(bool & value);
+	void onSharedMemoryEvent(bool & value);
+	void onPipeEvent(bool & value);
+	void onPipeBlockEvent(bool & value);
 	void onScrubbingQualityEvent(int & value);
 	void onUltraLowQualityEvent(bool & value);
+	void onCacheBudgetEvent(int & value);
+	void onProxyBudgetEvent(int & value);
+	void onPackRangeEvent();
+	void onExportStatsEvent();
+	void onResetStatsEvent();
+	void onResetColorEvent();
+	void onAddLayerEvent();
+	void onRemoveLayerEvent();
+	void onLayerSelectEvent(int & value);
+	void onLayerPlayEvent(bool & value);
+	void onLayerSpeedEvent(float & value);
+	void onLayerBackwardEvent(bool & value);
+	void onLayerPingPongEvent(bool & value);
+	void onLayerRangeEvent(int & value);
 	
 	// Constants
 	static const float BASE_FPS;
 	static const float MAX_SPEED;
 	static const float SLIDER_MIDPOINT;
+	static const string MAIN_OUTPUT;  // Name of the output sized by the Syphon settings
 	static const int UI_PANEL_WIDTH = 300;
-	
-	// Playback direction enum
-	enum Direction {
-		FORWARD,
-		BACKWARD
-	};
-	
-	// Loop mode enum
-	enum LoopMode {
-		LOOP,
-		PING_PONG
-	};
+	static const int PREFETCH_RING_SIZE = 8;  // Decoded frames kept ready ahead of the playhead
+	static const int UPLOAD_BUFFER_COUNT = 3;  // Textures the uploader rotates: one shown, one landing, one just released
 	
 	// UI layout
 	ofRectangle uiPanel;
@@ -122,11 +178,22 @@ public:
 	ofxButton last10FramesGui;
 	ofxButton last100FramesGui;
 	ofxIntSlider customLastFramesGui;
+	ofxToggle liveTailToggleGui;     // Show frames from a capture folder as soon as they are written
+	ofxLabel liveLatencyLabelGui;    // Capture to output latency of the newest live frame
 	
 	// Display and toggles
 	ofxLabel currentFrameLabelGui;
+	ofxLabel qualityLabelGui;          // Level the quality governor plays at, and how busy decoding is
+	ofxToggle neverDegradeToggleGui;   // Full quality even if playback falls behind, for a final output
 	ofxToggle blackScreenToggleGui;
 	
+	// Color controls, applied by a shader while the frame is drawn into the outputs
+	ofxPanel colorGroupGui;
+	ofxFloatSlider brightnessSliderGui;
+	ofxFloatSlider contrastSliderGui;
+	ofxFloatSlider saturationSliderGui;
+	ofxButton resetColorButtonGui;
+	
 	// Syphon controls
 	ofxPanel syphonGroupGui;
 	ofxIntSlider syphonWidthSliderGui;
@@ -138,28 +205,82 @@ public:
 	ofxButton syphon720pGui;
 	ofxButton syphonImageResGui;
 	ofxButton syphonHalfResGui;
+	ofxToggle extra1080pToggleGui;
+	ofxToggle extra720pToggleGui;
+	ofxToggle sharedMemoryToggleGui;
+	ofxToggle pipeToggleGui;
+	ofxToggle pipeBlockToggleGui;
+	ofxLabel pipeStatusLabelGui;
 	
 	// Scrubbing quality control
 	ofxPanel scrubbingGroupGui;
 	ofxIntSlider scrubbingQualitySliderGui;
 	ofxToggle ultraLowQualityToggleGui;
+	ofxLabel proxyProgressLabelGui;
+	ofxIntSlider proxyBudgetSliderGui;  // Proxy folders of the least recently opened sequences go beyond this
+	ofxLabel scrubStatsLabelGui;  // How often the scrubbed frame was loaded before the slider got there
+	
+	// Frame cache controls
+	ofxPanel cacheGroupGui;
+	ofxIntSlider cacheBudgetSliderGui;
+	ofxLabel cacheStatsLabelGui;
+	ofxLabel decodeStatsLabelGui;
+	
+	// Pack controls
+	ofxPanel packGroupGui;
+	ofxButton packRangeButtonGui;
+	ofxToggle packCompressToggleGui;
+	ofxToggle packBlockCompressToggleGui;
+	ofxLabel packStatusLabelGui;
+	
+	// Layers: more sequences playing at once, each with its own output
+	ofxPanel layersGroupGui;
+	ofxButton addLayerButtonGui;
+	ofxIntSlider layerSelectSliderGui;
+	ofxToggle layerPlayToggleGui;
+	ofxFloatSlider layerSpeedSliderGui;
+	ofxToggle layerBackwardToggleGui;
+	ofxToggle layerPingPongToggleGui;
+	ofxIntSlider layerStartSliderGui;
+	ofxIntSlider layerEndSliderGui;
+	ofxButton removeLayerButtonGui;
+	ofxLabel layerStatusLabelGui;
+	
+	// Diagnostics controls
+	ofxPanel diagnosticsGroupGui;
+	ofxToggle statsOverlayToggleGui;
+	ofxButton exportStatsButtonGui;
+	ofxButton resetStatsButtonGui;
 	
 	// Image and playback variables
-	ofImage currentImage;
-	vector<string> imagePaths;
-	ofDirectory imageDir;
+	ofTexture frameTexture;  // The frame being shown; the source of outputGraph
+	TextureUploader uploader;  // Streams new frames to the GPU; frameTexture follows it once an upload lands
+	FrameCache frameCache;
+	DecodePool decodePool;  // Decode threads shared by the main sequence and the layers
+	FramePrefetcher prefetcher;
+	ProxyCache proxyCache;
+	ScrubLoader scrubLoader;  // Loads scrubbed frames off the render thread, predicting where the slider goes
+	bool showingProxy = false;  // frameTexture holds a scrubbing proxy or reduced decode, not the full frame
+	QualityGovernor governor;   // Lowers decode quality while playback can't keep up
+	bool showingReduced = false;  // frameTexture was played at a reduced quality level
+	SequencePack pack;          // Open .sspack; when open it replaces frameList as the frame source
+	SequencePackWriter packWriter;
+	bool packWriting = false;
+	DirectoryWatcher watcher;
+	LiveTail liveTail;  // Newest frames of the folder, decoded as they arrive while liveTailToggleGui is on
+	bool liveTailPending = false;  // Paused on the newest frame: show the one that just arrived once it is decoded
+	shared_ptr<const FrameList> frameList;  // Latest snapshot taken from the watcher
 	string directoryPath;
 	string displayPath;
 	int currentImageIndex;
 	float playbackSpeed;
-	float lastImageTime;
+	PlaybackClock playbackClock;
 	bool isPlaying = false;
 	bool showBlackScreen;
 	int rangeStart;
 	int rangeEnd;
 	bool rangeSetByUser = false;
 	int lastFrame = 0;
-	float lastCheckTime;
 	float checkInterval;
 	Direction playDirection;
 	LoopMode loopMode;
@@ -173,8 +294,17 @@ public:
 	int previousDirSize;
 	
 	// Syphon variables
-	ofxSyphonServer syphonServer;
-	ofFbo syphonFbo;
+	OutputGraph outputGraph;  // The main output at syphonWidth x syphonHeight plus the extra monitor outputs
+#ifdef TARGET_OSX
+	std::map<string, shared_ptr<ofxSyphonServer>> syphonServers;  // One per output, by output name
+#endif
+	std::map<string, shared_ptr<SharedMemoryOutput>> sharedMemoryOutputs;  // Likewise, while sharedMemoryToggleGui is on
+	vector<shared_ptr<SequenceLayer>> layers;  // Published as "Layer 1", "Layer 2"... next to the main outputs
+	int nextLayerNumber = 1;
+	bool syncingLayerControls = false;  // The layer controls are being set from the selected layer
+	PipeOutput pipeOutput;  // The main output as raw video, while pipeToggleGui is on
+	PipeOutput::Settings pipeSettings;
+	bool pipeRequested = false;
 	int syphonWidth;
 	int syphonHeight;
 	bool maintainAspectRatio;
@@ -186,7 +316,4 @@ public:
 	// Add this to your class declaration
 	void checkDirectoryForChanges();
 	void checkScrubEnd(ofEventArgs &args);
-
-private:
-	ofDirectory getImageDirectory(const string& path);
 };
\ No newline at end of file